@@ -1,2 +1,7 @@
 %~dp0..\..\..\Libraries\VulkanSDK\Bin32\glslangValidator.exe -V shader.vert
-%~dp0..\..\..\Libraries\VulkanSDK\Bin32\glslangValidator.exe -V shader.frag
\ No newline at end of file
+%~dp0..\..\..\Libraries\VulkanSDK\Bin32\glslangValidator.exe -V shader.frag
+%~dp0..\..\..\Libraries\VulkanSDK\Bin32\glslangValidator.exe -V sprite.vert -o sprite_vert.spv
+%~dp0..\..\..\Libraries\VulkanSDK\Bin32\glslangValidator.exe -V hud.vert -o hud_vert.spv
+%~dp0..\..\..\Libraries\VulkanSDK\Bin32\glslangValidator.exe -V hud.frag -o hud_frag.spv
+%~dp0..\..\..\Libraries\VulkanSDK\Bin32\glslangValidator.exe -V particle.vert -o particle_vert.spv
+%~dp0..\..\..\Libraries\VulkanSDK\Bin32\glslangValidator.exe -V particle.comp -o particle_comp.spv
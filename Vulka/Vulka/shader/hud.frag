@@ -0,0 +1,20 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// one channel: lit texels are 1, the rest 0. sampled with nearest filtering.
+layout(binding = 2) uniform sampler2D atlas;
+
+layout(location = 0) in vec2 fragUv;
+layout(location = 1) in vec3 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    // no blending in the hud pass, so unlit texels are dropped rather than drawn transparent.
+    if (texture(atlas, fragUv).r < 0.5)
+    {
+        discard;
+    }
+    outColor = vec4(fragColor, 1.0);
+}
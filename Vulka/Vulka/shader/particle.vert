@@ -0,0 +1,23 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// one instance per particle, read straight from the buffer the simulation compacted into.
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in float inLife;
+
+layout(location = 0) out vec3 fragColor;
+
+const float PARTICLE_SIZE = 0.004;
+
+const vec2 CORNERS[6] = vec2[](
+    vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(1.0, 1.0), vec2(-1.0, 1.0), vec2(-1.0, -1.0)
+);
+
+void main()
+{
+    gl_Position = vec4(inPosition + CORNERS[gl_VertexIndex] * PARTICLE_SIZE, 0.0, 1.0);
+    // fade out over the last second.
+    fragColor = inColor * clamp(inLife, 0.0, 1.0);
+}
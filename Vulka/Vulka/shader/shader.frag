@@ -1,11 +1,21 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+// pipeline variant switches, see PipelineVariants. each variant gets this compiled for its values.
+layout(constant_id = 0) const bool VERTEX_COLOR = true;
+// 0 leaves the color alone, otherwise every channel is snapped to this many steps.
+layout(constant_id = 1) const int COLOR_LEVELS = 0;
+
 layout(location = 0) in vec3 fragColor;
 
 layout(location = 0) out vec4 outColor;
 
 void main()
 {
-    outColor = vec4(fragColor, 1.0);
-}
\ No newline at end of file
+    vec3 color = VERTEX_COLOR ? fragColor : vec3(1.0);
+    if (COLOR_LEVELS > 0)
+    {
+        color = floor(color * float(COLOR_LEVELS) + 0.5) / float(COLOR_LEVELS);
+    }
+    outColor = vec4(color, 1.0);
+}
@@ -1,13 +1,27 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+layout(set = 0, binding = 0) uniform FrameUniforms {
+    mat4 viewProj;
+    vec4 time;
+} frame;
+
+// one world matrix per instance, see Game::writeInstanceData().
+layout(std430, set = 0, binding = 1) readonly buffer Instances {
+    mat4 world[];
+} instances;
+
 layout(location = 0) in vec2 inPosition;
 layout(location = 1) in vec3 inColor;
 
 layout(location = 0) out vec3 fragColor;
 
+// the depth pre-pass and the shading pass are separate pipelines over the same geometry,
+// and the shading pass tests depth with EQUAL. both have to produce bit-identical positions.
+invariant gl_Position;
+
 void main()
 {
-    gl_Position = vec4(inPosition, 0.0, 1.0);
+    gl_Position = frame.viewProj * (instances.world[gl_InstanceIndex] * vec4(inPosition, 0.0, 1.0));
     fragColor = inColor;
-}
\ No newline at end of file
+}
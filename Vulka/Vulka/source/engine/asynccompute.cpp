@@ -0,0 +1,207 @@
+#include "asynccompute.h"
+#include "logger.h"
+
+#include <limits>
+
+void AsyncCompute::Initialize(AsyncComputeInfo* asyncComputeInfo)
+{
+    mDevice = asyncComputeInfo->device;
+    mQueue = asyncComputeInfo->computeQueue;
+    mComputeFamily = asyncComputeInfo->computeFamily;
+    mGraphicsFamily = asyncComputeInfo->graphicsFamily;
+    mQueueFamilies[0] = mGraphicsFamily;
+    mQueueFamilies[1] = mComputeFamily;
+    mUseTimeline = asyncComputeInfo->useTimelineSemaphore;
+
+    uint32_t frameCount = asyncComputeInfo->frameCount;
+
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = mComputeFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    if (vkCreateCommandPool(mDevice, &poolInfo, nullptr, &mCommandPool) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to create compute command pool!");
+    }
+
+    mCommandBuffers.resize(frameCount);
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = mCommandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = frameCount;
+
+    if (vkAllocateCommandBuffers(mDevice, &allocInfo, mCommandBuffers.data()) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to allocate compute command buffers.");
+    }
+
+    mFrameValues.assign(frameCount, 0);
+
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    if (mUseTimeline)
+    {
+        VkSemaphoreTypeCreateInfo typeInfo = {};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = 0;
+        semaphoreInfo.pNext = &typeInfo;
+
+        if (vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &mTimeline) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create compute timeline semaphore.");
+        }
+    }
+    else
+    {
+        VkFenceCreateInfo fenceInfo = {};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+        mFences.resize(frameCount);
+        mBinarySemaphores.resize(frameCount);
+        for (uint32_t i = 0; i < frameCount; ++i)
+        {
+            if (vkCreateFence(mDevice, &fenceInfo, nullptr, &mFences[i]) != VK_SUCCESS ||
+                vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &mBinarySemaphores[i]) != VK_SUCCESS)
+            {
+                logger.throw_error("failed to create compute sync objects.");
+            }
+        }
+    }
+
+    logger.debug("Async compute initialized. Dedicated family: %s.", IsDedicated() ? "yes" : "no");
+}
+
+void AsyncCompute::Shutdown()
+{
+    vkQueueWaitIdle(mQueue);
+
+    for (auto fence : mFences)
+    {
+        vkDestroyFence(mDevice, fence, nullptr);
+    }
+    for (auto semaphore : mBinarySemaphores)
+    {
+        vkDestroySemaphore(mDevice, semaphore, nullptr);
+    }
+    mFences.clear();
+    mBinarySemaphores.clear();
+    if (mTimeline != VK_NULL_HANDLE)
+    {
+        vkDestroySemaphore(mDevice, mTimeline, nullptr);
+        mTimeline = VK_NULL_HANDLE;
+    }
+    vkDestroyCommandPool(mDevice, mCommandPool, nullptr);
+    mCommandPool = VK_NULL_HANDLE;
+    mCommandBuffers.clear();
+}
+
+VkCommandBuffer AsyncCompute::BeginFrame(uint32_t frameIndex)
+{
+    mFrameIndex = frameIndex % static_cast<uint32_t>(mCommandBuffers.size());
+
+    if (mUseTimeline)
+    {
+        if (mFrameValues[mFrameIndex] > 0)
+        {
+            VkSemaphoreWaitInfo waitInfo = {};
+            waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores = &mTimeline;
+            waitInfo.pValues = &mFrameValues[mFrameIndex];
+            vkWaitSemaphores(mDevice, &waitInfo, (std::numeric_limits<uint64_t>::max)());
+        }
+    }
+    else
+    {
+        vkWaitForFences(mDevice, 1, &mFences[mFrameIndex], VK_TRUE, (std::numeric_limits<uint64_t>::max)());
+    }
+
+    VkCommandBuffer commandBuffer = mCommandBuffers[mFrameIndex];
+    vkResetCommandBuffer(commandBuffer, 0);
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to begin a compute command buffer.");
+    }
+    mRecording = true;
+    return commandBuffer;
+}
+
+uint64_t AsyncCompute::Submit(const std::vector<ComputeWait>& waits)
+{
+    if (!mRecording)
+    {
+        logger.throw_error("AsyncCompute::Submit called without BeginFrame.");
+    }
+    mRecording = false;
+
+    VkCommandBuffer commandBuffer = mCommandBuffers[mFrameIndex];
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to record a compute command buffer.");
+    }
+
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<VkPipelineStageFlags> waitStages;
+    std::vector<uint64_t> waitValues;
+    for (const auto& wait : waits)
+    {
+        waitSemaphores.push_back(wait.semaphore);
+        waitStages.push_back(wait.stage);
+        waitValues.push_back(wait.value);
+    }
+
+    uint64_t signalValue = mUseTimeline ? mNextValue++ : 0;
+    VkSemaphore signalSemaphore = GetSignalSemaphore();
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &signalSemaphore;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues = waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &signalValue;
+    if (mUseTimeline)
+    {
+        submitInfo.pNext = &timelineInfo;
+    }
+
+    VkFence fence = VK_NULL_HANDLE;
+    if (!mUseTimeline)
+    {
+        fence = mFences[mFrameIndex];
+        vkResetFences(mDevice, 1, &fence);
+    }
+
+    if (vkQueueSubmit(mQueue, 1, &submitInfo, fence) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to submit compute command buffer!");
+    }
+
+    mFrameValues[mFrameIndex] = signalValue;
+    mPendingSignal = true;
+    return signalValue;
+}
+
+VkSemaphore AsyncCompute::GetSignalSemaphore() const
+{
+    return mUseTimeline ? mTimeline : mBinarySemaphores[mFrameIndex];
+}
@@ -0,0 +1,89 @@
+#ifndef _ASYNC_COMPUTE_H_
+#define _ASYNC_COMPUTE_H_
+
+#include "vulkanloader.h"
+#include <vector>
+
+typedef struct AsyncComputeInfo {
+    VkDevice device;
+    VkQueue computeQueue;
+    uint32_t computeFamily;         // may equal graphicsFamily when there's no separate compute family
+    uint32_t graphicsFamily;
+    uint32_t frameCount;            // one command buffer per frame in flight
+    bool useTimelineSemaphore;
+} AsyncComputeInfo;
+
+typedef struct ComputeWait {
+    VkSemaphore semaphore;
+    uint64_t value;                 // ignored for binary semaphores
+    VkPipelineStageFlags stage;
+} ComputeWait;
+
+/*
+Submits compute work on its own queue so it can overlap the graphics queue's raster work.
+
+Usage per frame:
+    VkCommandBuffer cmd = compute.BeginFrame(frameIndex);
+    ...record dispatches...
+    uint64_t value = compute.Submit(waits);
+then have the graphics submit wait on GetSignalSemaphore() (at value when it's a timeline)
+at whatever stage first consumes the results.
+
+Buffers written here and read by graphics (or the other way around) are either created
+with VK_SHARING_MODE_CONCURRENT over GetQueueFamilies(), or stay exclusive and are released
+and acquired between the two families every frame when IsDedicated() (see ParticleSystem).
+Concurrent trades a little bandwidth on some hardware for not doing the transfers.
+*/
+class AsyncCompute
+{
+public:
+    void Initialize(AsyncComputeInfo* asyncComputeInfo);
+    void Shutdown();
+
+    /*
+    Wait until the gpu is done with this frame slot's previous compute work,
+    then reset and begin its command buffer.
+    */
+    VkCommandBuffer BeginFrame(uint32_t frameIndex);
+
+    /*
+    End the command buffer from BeginFrame() and submit it, waiting on waits first.
+    Returns the timeline value the work signals (0 without timeline semaphores).
+    */
+    uint64_t Submit(const std::vector<ComputeWait>& waits);
+
+    /*
+    Semaphore the graphics queue waits on to consume this frame's compute results.
+    A timeline semaphore when supported, otherwise the frame slot's binary semaphore
+    (which then has to be waited on exactly once).
+    */
+    VkSemaphore GetSignalSemaphore() const;
+    bool HasPendingSignal() const { return mPendingSignal; }
+    void ConsumePendingSignal() { mPendingSignal = false; }
+
+    const uint32_t* GetQueueFamilies() const { return mQueueFamilies; }
+    uint32_t GetQueueFamilyCount() const { return IsDedicated() ? 2 : 1; }
+    bool IsDedicated() const { return mComputeFamily != mGraphicsFamily; }
+
+private:
+    VkDevice mDevice;
+    VkQueue mQueue;
+    uint32_t mComputeFamily;
+    uint32_t mGraphicsFamily;
+    uint32_t mQueueFamilies[2];
+    bool mUseTimeline;
+
+    VkCommandPool mCommandPool = VK_NULL_HANDLE;
+    std::vector<VkCommandBuffer> mCommandBuffers;
+    std::vector<uint64_t> mFrameValues;         // timeline value each slot last signalled
+    std::vector<VkFence> mFences;               // only without timeline semaphores
+    std::vector<VkSemaphore> mBinarySemaphores; // only without timeline semaphores
+    VkSemaphore mTimeline = VK_NULL_HANDLE;
+    uint64_t mNextValue = 1;
+
+    uint32_t mFrameIndex = 0;
+    bool mRecording = false;
+    bool mPendingSignal = false;
+};
+
+#endif _ASYNC_COMPUTE_H_
@@ -0,0 +1,160 @@
+#include "benchmark.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cstdio>
+
+static std::string EscapeJson(const std::string& text)
+{
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '"':  escaped += "\\\""; break;
+        case '\\': escaped += "\\\\"; break;
+        case '\n': escaped += "\\n"; break;
+        case '\t': escaped += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) >= 0x20)
+            {
+                escaped += c;
+            }
+            break;
+        }
+    }
+    return escaped;
+}
+
+// nearest rank on an already sorted list.
+static double Percentile(const std::vector<double>& sorted, double percentile)
+{
+    if (sorted.empty())
+    {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(percentile / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[(std::min)(rank, sorted.size() - 1)];
+}
+
+static void WriteStats(FILE* file, const char* name, const std::vector<double>& sorted, bool last)
+{
+    if (sorted.empty())
+    {
+        fprintf(file, "      \"%s\": null%s\n", name, last ? "" : ",");
+        return;
+    }
+
+    double sum = 0.0;
+    for (double value : sorted)
+    {
+        sum += value;
+    }
+
+    fprintf(file, "      \"%s\": { \"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n",
+        name, sum / sorted.size(), sorted.front(), Percentile(sorted, 50.0), Percentile(sorted, 90.0),
+        Percentile(sorted, 95.0), Percentile(sorted, 99.0), sorted.back(), last ? "" : ",");
+}
+
+void Benchmark::Initialize(BenchmarkInfo* benchmarkInfo)
+{
+    mOutputPath = benchmarkInfo->outputPath;
+    mConfig = benchmarkInfo->config;
+    mScenes.clear();
+    mInScene = false;
+
+    logger.debug("Benchmark initialized. Results go to %s.", mOutputPath.c_str());
+}
+
+void Benchmark::Shutdown()
+{
+    if (mInScene)
+    {
+        EndScene({});
+    }
+
+    FILE* file = nullptr;
+    if (fopen_s(&file, mOutputPath.c_str(), "w") != 0 || file == nullptr)
+    {
+        logger.error("Couldn't write benchmark results to %s.", mOutputPath.c_str());
+        return;
+    }
+
+    fprintf(file, "{\n  \"config\": {\n");
+    for (size_t i = 0, count = mConfig.size(); i < count; ++i)
+    {
+        fprintf(file, "    \"%s\": \"%s\"%s\n", EscapeJson(mConfig[i].first).c_str(), EscapeJson(mConfig[i].second).c_str(), i + 1 < count ? "," : "");
+    }
+    fprintf(file, "  },\n  \"scenes\": [\n");
+
+    for (size_t s = 0, sceneCount = mScenes.size(); s < sceneCount; ++s)
+    {
+        const Scene& scene = mScenes[s];
+        std::vector<double> frameMs, cpuMs, gpuMs;
+        for (const auto& frame : scene.frames)
+        {
+            frameMs.push_back(frame.frameMs);
+            cpuMs.push_back(frame.cpuMs);
+            if (frame.gpuMs >= 0.0)
+            {
+                gpuMs.push_back(frame.gpuMs);
+            }
+        }
+        // sorted once here; the json and the log line below both read percentiles off them.
+        std::sort(frameMs.begin(), frameMs.end());
+        std::sort(cpuMs.begin(), cpuMs.end());
+        std::sort(gpuMs.begin(), gpuMs.end());
+
+        fprintf(file, "    {\n      \"name\": \"%s\",\n      \"frames\": %zu,\n", EscapeJson(scene.name).c_str(), scene.frames.size());
+        WriteStats(file, "frameMs", frameMs, false);
+        WriteStats(file, "cpuMs", cpuMs, false);
+        WriteStats(file, "gpuMs", gpuMs, false);
+        fprintf(file, "      \"counters\": {");
+        for (size_t i = 0, count = scene.counters.size(); i < count; ++i)
+        {
+            fprintf(file, "%s\"%s\": %llu", i > 0 ? ", " : " ", EscapeJson(scene.counters[i].first).c_str(), (unsigned long long)scene.counters[i].second);
+        }
+        fprintf(file, " }\n    }%s\n", s + 1 < sceneCount ? "," : "");
+
+        logger.debug("Benchmark '%s': %zu frames, p50 %.2f ms, p99 %.2f ms.", scene.name.c_str(), scene.frames.size(),
+            Percentile(frameMs, 50.0), Percentile(frameMs, 99.0));
+    }
+
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+
+    logger.debug("Benchmark results written to %s.", mOutputPath.c_str());
+    mScenes.clear();
+}
+
+void Benchmark::BeginScene(const char* name)
+{
+    if (mInScene)
+    {
+        EndScene({});
+    }
+    Scene scene;
+    scene.name = name;
+    mScenes.push_back(scene);
+    mInScene = true;
+}
+
+void Benchmark::AddFrame(const BenchmarkFrame& frame)
+{
+    if (!mInScene)
+    {
+        return;
+    }
+    mScenes.back().frames.push_back(frame);
+}
+
+void Benchmark::EndScene(const std::vector<std::pair<std::string, uint64_t>>& counters)
+{
+    if (!mInScene)
+    {
+        return;
+    }
+    mScenes.back().counters = counters;
+    mInScene = false;
+}
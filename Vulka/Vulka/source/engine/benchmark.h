@@ -0,0 +1,56 @@
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+typedef struct BenchmarkInfo {
+    std::string outputPath;
+    // written out as-is under "config" so runs on different machines/settings can be told apart.
+    std::vector<std::pair<std::string, std::string>> config;
+} BenchmarkInfo;
+
+typedef struct BenchmarkFrame {
+    double frameMs;     // wall time since the previous frame started
+    double cpuMs;       // time the cpu spent building and submitting the frame (waits excluded)
+    double gpuMs;       // gpu time from timestamps, negative when not available
+} BenchmarkFrame;
+
+/*
+Collects per-frame timings for a sequence of named scenes and writes them to JSON
+when shut down. Every scene reports mean/min/max and p50/p90/p95/p99 for frame,
+cpu and gpu time, plus whatever counters the caller hands to EndScene().
+
+Knows nothing about what a scene draws; Game drives that.
+*/
+class Benchmark
+{
+public:
+    void Initialize(BenchmarkInfo* benchmarkInfo);
+
+    /*
+    Write the results file.
+    */
+    void Shutdown();
+
+    void BeginScene(const char* name);
+    void AddFrame(const BenchmarkFrame& frame);
+    void EndScene(const std::vector<std::pair<std::string, uint64_t>>& counters);
+
+private:
+    struct Scene
+    {
+        std::string name;
+        std::vector<BenchmarkFrame> frames;
+        std::vector<std::pair<std::string, uint64_t>> counters;
+    };
+
+    std::string mOutputPath;
+    std::vector<std::pair<std::string, std::string>> mConfig;
+    std::vector<Scene> mScenes;
+    bool mInScene = false;
+};
+
+#endif _BENCHMARK_H_
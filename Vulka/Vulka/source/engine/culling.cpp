@@ -0,0 +1,375 @@
+#include "culling.h"
+#include "logger.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <immintrin.h>
+#include <intrin.h>
+
+// below this many spheres a chunk isn't worth waking a thread for.
+const uint32_t CULL_MIN_JOB_SIZE = 16384;
+
+/*
+AVX2 left-pack table. For every 8-bit visibility mask, the lanes to keep as 3-bit indices
+(one per nibble), in ascending sphere order. Built once in Initialize().
+*/
+static uint32_t avx2PackTable[256];
+
+// the AVX2 transpose leaves sphere j in lane avx2LaneOfSphere[j].
+static const uint32_t avx2LaneOfSphere[8] = { 0, 4, 1, 5, 2, 6, 3, 7 };
+
+Frustum ExtractFrustum(const glm::mat4& viewProj)
+{
+    // rows of the matrix; glm is column major.
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        rows[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+    }
+
+    Frustum frustum;
+    frustum.planes[0] = rows[3] + rows[0];  // left
+    frustum.planes[1] = rows[3] - rows[0];  // right
+    frustum.planes[2] = rows[3] + rows[1];  // top (y points down in vulkan clip space)
+    frustum.planes[3] = rows[3] - rows[1];  // bottom
+    frustum.planes[4] = rows[2];            // near, z >= 0
+    frustum.planes[5] = rows[3] - rows[2];  // far
+    for (auto& plane : frustum.planes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+static uint32_t CullScalar(const Frustum& frustum, const glm::vec4* pSpheres, uint32_t begin, uint32_t end, uint32_t* pVisible)
+{
+    uint32_t visible = 0;
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        const glm::vec4& sphere = pSpheres[i];
+        bool inside = true;
+        for (const auto& plane : frustum.planes)
+        {
+            // written like the simd paths so all of them agree on the edge cases.
+            if (!(plane.x * sphere.x + plane.y * sphere.y + plane.z * sphere.z + plane.w + sphere.w >= 0.0f))
+            {
+                inside = false;
+                break;
+            }
+        }
+        // branch free compaction: always write, only advance when visible.
+        pVisible[visible] = i;
+        visible += inside ? 1 : 0;
+    }
+    return visible;
+}
+
+static uint32_t CullSse(const Frustum& frustum, const glm::vec4* pSpheres, uint32_t begin, uint32_t end, uint32_t* pVisible)
+{
+    __m128 planes[6][4];
+    for (int p = 0; p < 6; ++p)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+        }
+    }
+    const __m128 zero = _mm_setzero_ps();
+
+    uint32_t visible = 0;
+    uint32_t i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        const float* pData = reinterpret_cast<const float*>(pSpheres + i);
+        __m128 x = _mm_loadu_ps(pData);
+        __m128 y = _mm_loadu_ps(pData + 4);
+        __m128 z = _mm_loadu_ps(pData + 8);
+        __m128 r = _mm_loadu_ps(pData + 12);
+        // four xyzr spheres in, one register per component out.
+        _MM_TRANSPOSE4_PS(x, y, z, r);
+
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+        for (int p = 0; p < 6; ++p)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, planes[p][0]), _mm_mul_ps(y, planes[p][1])),
+                _mm_add_ps(_mm_mul_ps(z, planes[p][2]), planes[p][3]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, r), zero));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        pVisible[visible] = i;
+        visible += mask & 1;
+        pVisible[visible] = i + 1;
+        visible += (mask >> 1) & 1;
+        pVisible[visible] = i + 2;
+        visible += (mask >> 2) & 1;
+        pVisible[visible] = i + 3;
+        visible += (mask >> 3) & 1;
+    }
+
+    return visible + CullScalar(frustum, pSpheres, i, end, pVisible + visible);
+}
+
+/*
+MSVC emits VEX code for these intrinsics wherever they appear, so this only needs to be kept
+from running on cpus without AVX2 (see Initialize()), not compiled separately.
+*/
+static uint32_t CullAvx2(const Frustum& frustum, const glm::vec4* pSpheres, uint32_t begin, uint32_t end, uint32_t* pVisible)
+{
+    __m256 planes[6][4];
+    for (int p = 0; p < 6; ++p)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            planes[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+        }
+    }
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256i shifts = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+    const __m256i laneMask = _mm256_set1_epi32(7);
+    // sphere offset held by each lane after the transpose.
+    const __m256i laneSphere = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+    uint32_t visible = 0;
+    uint32_t i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        const float* pData = reinterpret_cast<const float*>(pSpheres + i);
+        __m256 s01 = _mm256_loadu_ps(pData);
+        __m256 s23 = _mm256_loadu_ps(pData + 8);
+        __m256 s45 = _mm256_loadu_ps(pData + 16);
+        __m256 s67 = _mm256_loadu_ps(pData + 24);
+
+        // 8 xyzr spheres in, one register per component out (lanes hold spheres 0 2 4 6 1 3 5 7).
+        __m256 t0 = _mm256_unpacklo_ps(s01, s23);
+        __m256 t1 = _mm256_unpackhi_ps(s01, s23);
+        __m256 t2 = _mm256_unpacklo_ps(s45, s67);
+        __m256 t3 = _mm256_unpackhi_ps(s45, s67);
+        __m256 x = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 y = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 z = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 r = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; ++p)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, planes[p][0]), _mm256_mul_ps(y, planes[p][1])),
+                _mm256_add_ps(_mm256_mul_ps(z, planes[p][2]), planes[p][3]));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, r), zero, _CMP_GE_OQ));
+        }
+
+        // left-pack the visible lanes' indices with one permute and store all 8; only the first popcount count.
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+        __m256i permutation = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(avx2PackTable[mask])), shifts), laneMask);
+        __m256i indices = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(i)), laneSphere);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pVisible + visible), _mm256_permutevar8x32_epi32(indices, permutation));
+        visible += _mm_popcnt_u32(mask);
+    }
+
+    return visible + CullScalar(frustum, pSpheres, i, end, pVisible + visible);
+}
+
+static bool CpuSupportsSse2()
+{
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+}
+
+static bool CpuSupportsAvx2()
+{
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+
+    // the os has to save the ymm registers on context switches (osxsave + xcr0), or avx can't be used at all.
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    bool popcnt = (info[2] & (1 << 23)) != 0;
+    if (!osxsave || !avx || !popcnt || (_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+}
+
+void Culler::Initialize(CullingInfo* cullingInfo)
+{
+    for (uint32_t mask = 0; mask < 256; ++mask)
+    {
+        uint32_t packed = 0;
+        uint32_t slot = 0;
+        for (uint32_t sphere = 0; sphere < 8; ++sphere)
+        {
+            uint32_t lane = avx2LaneOfSphere[sphere];
+            if (mask & (1u << lane))
+            {
+                packed |= lane << (slot++ * 4);
+            }
+        }
+        avx2PackTable[mask] = packed;
+    }
+
+    mBestPath = CpuSupportsAvx2() ? CULLING_PATH_AVX2 : (CpuSupportsSse2() ? CULLING_PATH_SSE : CULLING_PATH_SCALAR);
+    mPath = mBestPath;
+
+    uint32_t workerCount = cullingInfo->workerCount;
+    if (workerCount == 0)
+    {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+    mQuit = false;
+    for (uint32_t i = 0; i < workerCount; ++i)
+    {
+        mWorkers.emplace_back(&Culler::WorkerMain, this);
+    }
+
+    logger.debug("Culling uses the %s path and %u worker threads.", GetPathName(mPath), workerCount);
+}
+
+void Culler::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mWake.notify_all();
+    for (auto& worker : mWorkers)
+    {
+        worker.join();
+    }
+    mWorkers.clear();
+}
+
+bool Culler::IsPathSupported(CullingPath path) const
+{
+    return path <= mBestPath;
+}
+
+void Culler::SetPath(CullingPath path)
+{
+    if (IsPathSupported(path))
+    {
+        mPath = path;
+    }
+}
+
+const char* Culler::GetPathName(CullingPath path)
+{
+    switch (path)
+    {
+    case CULLING_PATH_SCALAR:
+        return "scalar";
+    case CULLING_PATH_SSE:
+        return "SSE";
+    case CULLING_PATH_AVX2:
+        return "AVX2";
+    default:
+        return "unknown";
+    }
+}
+
+uint32_t Culler::Cull(const Frustum& frustum, const glm::vec4* pSphereData, uint32_t count, uint32_t* pVisible)
+{
+    PROFILE_FUNCTION();
+    pFrustum = &frustum;
+    pSpheres = pSphereData;
+    pOutput = pVisible;
+
+    uint32_t jobCount = mParallel ? (std::min)(static_cast<uint32_t>(mWorkers.size()) + 1, count / CULL_MIN_JOB_SIZE) : 0;
+    if (jobCount <= 1)
+    {
+        return CullRange(0, count, pVisible);
+    }
+
+    // chunk edges on multiples of 8 keep every chunk but the last on the wide loop.
+    uint32_t jobSize = ((count + jobCount - 1) / jobCount + 7) & ~7u;
+    mJobs.clear();
+    for (uint32_t begin = 0; begin < count; begin += jobSize)
+    {
+        mJobs.push_back({ begin, (std::min)(begin + jobSize, count), 0 });
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mNextJob.store(0);
+        mWorkersFinished = 0;
+        ++mGeneration;
+    }
+    mWake.notify_all();
+    RunJobs();
+    {
+        // every worker checks in, even ones that found nothing left to do, so none can still be looking at mJobs next call.
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDone.wait(lock, [this] { return mWorkersFinished == mWorkers.size(); });
+    }
+
+    // each chunk wrote at its own offset; close the gaps.
+    uint32_t visible = 0;
+    for (const auto& job : mJobs)
+    {
+        if (job.begin != visible)
+        {
+            memmove(pVisible + visible, pVisible + job.begin, job.visible * sizeof(uint32_t));
+        }
+        visible += job.visible;
+    }
+    return visible;
+}
+
+uint32_t Culler::CullRange(uint32_t begin, uint32_t end, uint32_t* pVisible)
+{
+    switch (mPath)
+    {
+    case CULLING_PATH_AVX2:
+        return CullAvx2(*pFrustum, pSpheres, begin, end, pVisible);
+    case CULLING_PATH_SSE:
+        return CullSse(*pFrustum, pSpheres, begin, end, pVisible);
+    default:
+        return CullScalar(*pFrustum, pSpheres, begin, end, pVisible);
+    }
+}
+
+void Culler::RunJobs()
+{
+    uint32_t jobCount = static_cast<uint32_t>(mJobs.size());
+    for (uint32_t index = mNextJob.fetch_add(1); index < jobCount; index = mNextJob.fetch_add(1))
+    {
+        Job& job = mJobs[index];
+        job.visible = CullRange(job.begin, job.end, pOutput + job.begin);
+    }
+}
+
+void Culler::WorkerMain()
+{
+    profiler.SetThreadName("cull worker");
+    uint64_t generation = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [&] { return mQuit || mGeneration != generation; });
+            if (mQuit)
+            {
+                return;
+            }
+            generation = mGeneration;
+        }
+
+        RunJobs();
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            ++mWorkersFinished;
+        }
+        mDone.notify_one();
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef _CULLING_H_
+#define _CULLING_H_
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef struct Frustum {
+    glm::vec4 planes[6];    // xyz inward normal, w distance: a point is inside a plane when dot(xyz, p) + w >= 0
+} Frustum;
+
+/*
+Planes of viewProj's view volume, for Vulkan clip space (depth 0 to 1).
+*/
+Frustum ExtractFrustum(const glm::mat4& viewProj);
+
+enum CullingPath
+{
+    CULLING_PATH_SCALAR,
+    CULLING_PATH_SSE,       // 4 spheres per iteration
+    CULLING_PATH_AVX2,      // 8 spheres per iteration
+    CULLING_PATH_COUNT
+};
+
+typedef struct CullingInfo {
+    uint32_t workerCount;   // threads besides the caller. 0 means one less than the hardware threads
+} CullingInfo;
+
+/*
+Sphere vs frustum culling. Spheres are read as packed xyz + radius vec4s (WorldBoundsComponent)
+and transposed in registers, so one iteration tests 4 (SSE) or 8 (AVX2) of them against each
+plane at once. The widest path the cpu and os support is picked in Initialize().
+
+Large inputs are split into chunks culled in parallel by the worker threads and the caller.
+Each chunk writes its visible indices to its own part of the output, and the parts are closed
+up afterwards, so the result is in ascending order whatever the path or thread count.
+*/
+class Culler
+{
+public:
+    void Initialize(CullingInfo* cullingInfo);
+    void Shutdown();
+
+    /*
+    Write the indices of the spheres that touch the frustum to pVisible, which must have room for
+    count entries. Returns how many were written.
+    */
+    uint32_t Cull(const Frustum& frustum, const glm::vec4* pSpheres, uint32_t count, uint32_t* pVisible);
+
+    CullingPath GetPath() const { return mPath; }
+    bool IsPathSupported(CullingPath path) const;
+    // for comparing paths. ignored if the cpu doesn't support it.
+    void SetPath(CullingPath path);
+    // false keeps everything on the calling thread.
+    void SetParallel(bool parallel) { mParallel = parallel; }
+    uint32_t GetWorkerCount() const { return static_cast<uint32_t>(mWorkers.size()); }
+
+    static const char* GetPathName(CullingPath path);
+
+private:
+    struct Job
+    {
+        uint32_t begin;
+        uint32_t end;
+        uint32_t visible;
+    };
+
+    uint32_t CullRange(uint32_t begin, uint32_t end, uint32_t* pVisible);
+    void RunJobs();
+    void WorkerMain();
+
+    CullingPath mPath = CULLING_PATH_SCALAR;
+    CullingPath mBestPath = CULLING_PATH_SCALAR;
+    bool mParallel = true;
+
+    // the current Cull() call, shared with the workers.
+    const Frustum* pFrustum = nullptr;
+    const glm::vec4* pSpheres = nullptr;
+    uint32_t* pOutput = nullptr;
+    std::vector<Job> mJobs;
+    std::atomic<uint32_t> mNextJob{ 0 };
+
+    std::vector<std::thread> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mDone;
+    uint64_t mGeneration = 0;
+    uint32_t mWorkersFinished = 0;
+    bool mQuit = false;
+};
+
+#endif _CULLING_H_
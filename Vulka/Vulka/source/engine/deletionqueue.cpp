@@ -0,0 +1,129 @@
+#include "deletionqueue.h"
+#include "logger.h"
+#include "memorybudget.h"
+#include "profiler.h"
+
+void DeletionQueue::Initialize(DeletionQueueInfo* deletionQueueInfo)
+{
+    mDevice = deletionQueueInfo->device;
+    mFrameValue = 0;
+
+    logger.debug("Deletion queue initialized.");
+}
+
+void DeletionQueue::Shutdown()
+{
+    for (const auto& entry : mEntries)
+    {
+        Destroy(entry);
+    }
+    mEntries.clear();
+}
+
+void DeletionQueue::SetFrameValue(uint64_t value)
+{
+    mFrameValue = value;
+}
+
+void DeletionQueue::Collect(uint64_t completedValue)
+{
+    PROFILE_FUNCTION();
+    // entries are pushed with a non-decreasing value, so everything retirable is at the front.
+    while (!mEntries.empty() && mEntries.front().value <= completedValue)
+    {
+        Destroy(mEntries.front());
+        mEntries.pop_front();
+    }
+}
+
+void DeletionQueue::DestroyBuffer(VkBuffer buffer)
+{
+    Push(VK_OBJECT_TYPE_BUFFER, (uint64_t)buffer);
+}
+
+void DeletionQueue::DestroyImage(VkImage image)
+{
+    Push(VK_OBJECT_TYPE_IMAGE, (uint64_t)image);
+}
+
+void DeletionQueue::DestroyImageView(VkImageView imageView)
+{
+    Push(VK_OBJECT_TYPE_IMAGE_VIEW, (uint64_t)imageView);
+}
+
+void DeletionQueue::DestroyFramebuffer(VkFramebuffer framebuffer)
+{
+    Push(VK_OBJECT_TYPE_FRAMEBUFFER, (uint64_t)framebuffer);
+}
+
+void DeletionQueue::DestroyPipeline(VkPipeline pipeline)
+{
+    Push(VK_OBJECT_TYPE_PIPELINE, (uint64_t)pipeline);
+}
+
+void DeletionQueue::DestroyPipelineLayout(VkPipelineLayout pipelineLayout)
+{
+    Push(VK_OBJECT_TYPE_PIPELINE_LAYOUT, (uint64_t)pipelineLayout);
+}
+
+void DeletionQueue::DestroyRenderPass(VkRenderPass renderPass)
+{
+    Push(VK_OBJECT_TYPE_RENDER_PASS, (uint64_t)renderPass);
+}
+
+void DeletionQueue::DestroySwapchain(VkSwapchainKHR swapchain)
+{
+    Push(VK_OBJECT_TYPE_SWAPCHAIN_KHR, (uint64_t)swapchain);
+}
+
+void DeletionQueue::FreeMemory(VkDeviceMemory memory)
+{
+    Push(VK_OBJECT_TYPE_DEVICE_MEMORY, (uint64_t)memory);
+}
+
+void DeletionQueue::Push(VkObjectType type, uint64_t handle)
+{
+    if (handle == 0)
+    {
+        return;
+    }
+    mEntries.push_back({ mFrameValue, type, handle });
+}
+
+void DeletionQueue::Destroy(const Entry& entry)
+{
+    switch (entry.type)
+    {
+    case VK_OBJECT_TYPE_BUFFER:
+        vkDestroyBuffer(mDevice, (VkBuffer)entry.handle, nullptr);
+        break;
+    case VK_OBJECT_TYPE_IMAGE:
+        vkDestroyImage(mDevice, (VkImage)entry.handle, nullptr);
+        break;
+    case VK_OBJECT_TYPE_IMAGE_VIEW:
+        vkDestroyImageView(mDevice, (VkImageView)entry.handle, nullptr);
+        break;
+    case VK_OBJECT_TYPE_FRAMEBUFFER:
+        vkDestroyFramebuffer(mDevice, (VkFramebuffer)entry.handle, nullptr);
+        break;
+    case VK_OBJECT_TYPE_PIPELINE:
+        vkDestroyPipeline(mDevice, (VkPipeline)entry.handle, nullptr);
+        break;
+    case VK_OBJECT_TYPE_PIPELINE_LAYOUT:
+        vkDestroyPipelineLayout(mDevice, (VkPipelineLayout)entry.handle, nullptr);
+        break;
+    case VK_OBJECT_TYPE_RENDER_PASS:
+        vkDestroyRenderPass(mDevice, (VkRenderPass)entry.handle, nullptr);
+        break;
+    case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+        vkDestroySwapchainKHR(mDevice, (VkSwapchainKHR)entry.handle, nullptr);
+        break;
+    case VK_OBJECT_TYPE_DEVICE_MEMORY:
+        memoryBudget.TrackFree((VkDeviceMemory)entry.handle);
+        vkFreeMemory(mDevice, (VkDeviceMemory)entry.handle, nullptr);
+        break;
+    default:
+        logger.warn("Deletion queue doesn't know how to destroy object type %d.", entry.type);
+        break;
+    }
+}
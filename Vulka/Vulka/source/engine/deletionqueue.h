@@ -0,0 +1,62 @@
+#ifndef _DELETION_QUEUE_H_
+#define _DELETION_QUEUE_H_
+
+#include "vulkanloader.h"
+#include <deque>
+
+typedef struct DeletionQueueInfo {
+    VkDevice device;
+} DeletionQueueInfo;
+
+/*
+Destroys GPU objects once the gpu is guaranteed to be done with them, instead of
+stalling everything with vkDeviceWaitIdle.
+
+Work is tracked with a single increasing value: the frame being built signals
+SetFrameValue()'s value when it completes (a timeline value, or a frame count derived
+from fences). Anything handed to the queue is tagged with the current frame value, and
+Collect(completedValue) destroys everything tagged at or below what has completed.
+Objects are destroyed in the order they were queued.
+*/
+class DeletionQueue
+{
+public:
+    void Initialize(DeletionQueueInfo* deletionQueueInfo);
+
+    /*
+    Destroy everything still queued. The device must be idle.
+    */
+    void Shutdown();
+
+    void SetFrameValue(uint64_t value);
+    void Collect(uint64_t completedValue);
+
+    void DestroyBuffer(VkBuffer buffer);
+    void DestroyImage(VkImage image);
+    void DestroyImageView(VkImageView imageView);
+    void DestroyFramebuffer(VkFramebuffer framebuffer);
+    void DestroyPipeline(VkPipeline pipeline);
+    void DestroyPipelineLayout(VkPipelineLayout pipelineLayout);
+    void DestroyRenderPass(VkRenderPass renderPass);
+    void DestroySwapchain(VkSwapchainKHR swapchain);
+    void FreeMemory(VkDeviceMemory memory);
+
+    size_t GetPendingCount() const { return mEntries.size(); }
+
+private:
+    struct Entry
+    {
+        uint64_t value;
+        VkObjectType type;
+        uint64_t handle;    // non-dispatchable handles are 64 bits on every platform
+    };
+
+    void Push(VkObjectType type, uint64_t handle);
+    void Destroy(const Entry& entry);
+
+    VkDevice mDevice = VK_NULL_HANDLE;
+    uint64_t mFrameValue = 0;
+    std::deque<Entry> mEntries;
+};
+
+#endif _DELETION_QUEUE_H_
@@ -0,0 +1,214 @@
+#include "entitystore.h"
+#include "logger.h"
+
+#include <cstring>
+#include <type_traits>
+
+static const uint32_t componentSizes[COMPONENT_TYPE_COUNT] = {
+    sizeof(TransformComponent),
+    sizeof(WorldMatrixComponent),
+    sizeof(BoundsComponent),
+    sizeof(WorldBoundsComponent),
+    sizeof(MeshComponent),
+    sizeof(MaterialComponent)
+};
+
+static_assert(std::is_trivially_copyable<TransformComponent>::value && std::is_trivially_copyable<WorldMatrixComponent>::value &&
+    std::is_trivially_copyable<BoundsComponent>::value && std::is_trivially_copyable<WorldBoundsComponent>::value &&
+    std::is_trivially_copyable<MeshComponent>::value && std::is_trivially_copyable<MaterialComponent>::value,
+    "components are moved with memcpy");
+
+// marks a slot whose entity was destroyed.
+const uint32_t DEAD_ARCHETYPE = 0xffffffff;
+
+void EntityStore::Initialize(EntityStoreInfo* entityStoreInfo)
+{
+    mSlots.reserve(entityStoreInfo->initialCapacity);
+    mEntityCount = 0;
+}
+
+void EntityStore::Shutdown()
+{
+    mArchetypes.clear();
+    mSlots.clear();
+    mFreeSlots.clear();
+    mEntityCount = 0;
+}
+
+Entity EntityStore::Create(ComponentMask mask)
+{
+    Entity entity;
+    if (!mFreeSlots.empty())
+    {
+        entity.index = mFreeSlots.back();
+        mFreeSlots.pop_back();
+    }
+    else
+    {
+        entity.index = static_cast<uint32_t>(mSlots.size());
+        mSlots.push_back({ DEAD_ARCHETYPE, 0, 0 });
+    }
+
+    Slot& slot = mSlots[entity.index];
+    entity.generation = slot.generation;
+    slot.archetype = GetOrCreateArchetype(mask);
+    slot.row = AppendRow(slot.archetype, entity);
+    ++mEntityCount;
+    return entity;
+}
+
+void EntityStore::Destroy(Entity entity)
+{
+    if (!IsAlive(entity))
+    {
+        return;
+    }
+
+    Slot& slot = mSlots[entity.index];
+    RemoveRow(slot.archetype, slot.row);
+    slot.archetype = DEAD_ARCHETYPE;
+    // anything still holding the old handle now fails IsAlive().
+    ++slot.generation;
+    mFreeSlots.push_back(entity.index);
+    --mEntityCount;
+}
+
+bool EntityStore::IsAlive(Entity entity) const
+{
+    return entity.index < mSlots.size() && mSlots[entity.index].generation == entity.generation && mSlots[entity.index].archetype != DEAD_ARCHETYPE;
+}
+
+void EntityStore::SetComponents(Entity entity, ComponentMask mask)
+{
+    if (!IsAlive(entity))
+    {
+        return;
+    }
+
+    Slot& slot = mSlots[entity.index];
+    uint32_t from = slot.archetype;
+    uint32_t to = GetOrCreateArchetype(mask);
+    if (from == to)
+    {
+        return;
+    }
+
+    uint32_t oldRow = slot.row;
+    uint32_t newRow = AppendRow(to, entity);
+    Archetype& source = *mArchetypes[from];
+    Archetype& destination = *mArchetypes[to];
+    for (uint32_t type = 0; type < COMPONENT_TYPE_COUNT; ++type)
+    {
+        const Archetype::Column& sourceColumn = source.mColumns[type];
+        Archetype::Column& destinationColumn = destination.mColumns[type];
+        if (sourceColumn.stride != 0 && destinationColumn.stride != 0)
+        {
+            memcpy(destinationColumn.data.data() + newRow * destinationColumn.stride, sourceColumn.data.data() + oldRow * sourceColumn.stride, sourceColumn.stride);
+        }
+    }
+
+    RemoveRow(from, oldRow);
+    slot.archetype = to;
+    slot.row = newRow;
+}
+
+ComponentMask EntityStore::GetComponents(Entity entity) const
+{
+    return IsAlive(entity) ? mArchetypes[mSlots[entity.index].archetype]->mMask : 0;
+}
+
+void EntityStore::Reserve(ComponentMask mask, uint32_t count)
+{
+    Archetype& archetype = *mArchetypes[GetOrCreateArchetype(mask)];
+    uint32_t rows = archetype.mCount + count;
+    archetype.mEntities.reserve(rows);
+    for (auto& column : archetype.mColumns)
+    {
+        column.data.reserve(static_cast<size_t>(rows) * column.stride);
+    }
+    mSlots.reserve(mSlots.size() + count);
+}
+
+uint32_t EntityStore::GetOrCreateArchetype(ComponentMask mask)
+{
+    // a handful of archetypes in practice, so a linear search beats a map.
+    for (uint32_t i = 0, count = static_cast<uint32_t>(mArchetypes.size()); i < count; ++i)
+    {
+        if (mArchetypes[i]->mMask == mask)
+        {
+            return i;
+        }
+    }
+
+    std::unique_ptr<Archetype> archetype(new Archetype());
+    archetype->mMask = mask;
+    for (uint32_t type = 0; type < COMPONENT_TYPE_COUNT; ++type)
+    {
+        if (mask & ComponentBit(static_cast<ComponentType>(type)))
+        {
+            archetype->mColumns[type].stride = componentSizes[type];
+        }
+    }
+    mArchetypes.push_back(std::move(archetype));
+    logger.debug("Entity archetype %u created (component mask 0x%x).", static_cast<uint32_t>(mArchetypes.size() - 1), mask);
+    return static_cast<uint32_t>(mArchetypes.size() - 1);
+}
+
+uint32_t EntityStore::AppendRow(uint32_t archetypeIndex, Entity entity)
+{
+    Archetype& archetype = *mArchetypes[archetypeIndex];
+    uint32_t row = archetype.mCount++;
+    archetype.mEntities.push_back(entity);
+
+    for (auto& column : archetype.mColumns)
+    {
+        if (column.stride != 0)
+        {
+            column.data.resize(column.data.size() + column.stride);
+            memset(column.data.data() + row * column.stride, 0, column.stride);
+        }
+    }
+
+    if (TransformComponent* transforms = archetype.Get<TransformComponent>())
+    {
+        transforms[row].position = glm::vec3(0.0f);
+        transforms[row].scale = glm::vec3(1.0f);
+        transforms[row].rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    }
+    if (WorldMatrixComponent* worldMatrices = archetype.Get<WorldMatrixComponent>())
+    {
+        worldMatrices[row].matrix = glm::mat4(1.0f);
+    }
+    return row;
+}
+
+void EntityStore::RemoveRow(uint32_t archetypeIndex, uint32_t row)
+{
+    Archetype& archetype = *mArchetypes[archetypeIndex];
+    uint32_t last = archetype.mCount - 1;
+
+    // keep the rows dense: the last one fills the hole.
+    if (row != last)
+    {
+        for (auto& column : archetype.mColumns)
+        {
+            if (column.stride != 0)
+            {
+                memcpy(column.data.data() + row * column.stride, column.data.data() + last * column.stride, column.stride);
+            }
+        }
+        Entity moved = archetype.mEntities[last];
+        archetype.mEntities[row] = moved;
+        mSlots[moved.index].row = row;
+    }
+
+    for (auto& column : archetype.mColumns)
+    {
+        if (column.stride != 0)
+        {
+            column.data.resize(column.data.size() - column.stride);
+        }
+    }
+    archetype.mEntities.pop_back();
+    archetype.mCount = last;
+}
@@ -0,0 +1,182 @@
+#ifndef _ENTITY_STORE_H_
+#define _ENTITY_STORE_H_
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+enum ComponentType
+{
+    COMPONENT_TRANSFORM,        // TransformComponent
+    COMPONENT_WORLD_MATRIX,     // WorldMatrixComponent, written by UpdateTransforms() or UpdateHierarchy()
+    COMPONENT_BOUNDS,           // BoundsComponent
+    COMPONENT_WORLD_BOUNDS,     // WorldBoundsComponent, written by UpdateTransforms() or UpdateHierarchy()
+    COMPONENT_MESH,             // MeshComponent
+    COMPONENT_MATERIAL,         // MaterialComponent
+    COMPONENT_TYPE_COUNT
+};
+
+typedef uint32_t ComponentMask;
+
+inline ComponentMask ComponentBit(ComponentType type)
+{
+    return 1u << type;
+}
+
+// components are plain data: rows are moved around with memcpy.
+typedef struct TransformComponent {
+    glm::vec3 position;
+    glm::vec3 scale;
+    glm::quat rotation;
+} TransformComponent;
+
+typedef struct WorldMatrixComponent {
+    glm::mat4 matrix;
+} WorldMatrixComponent;
+
+typedef struct BoundsComponent {
+    glm::vec4 sphere;   // xyz center in local space, w radius
+} BoundsComponent;
+
+typedef struct WorldBoundsComponent {
+    glm::vec4 sphere;   // xyz center in world space, w radius
+} WorldBoundsComponent;
+
+typedef struct MeshComponent {
+    uint32_t mesh;      // index into the renderer's mesh table
+} MeshComponent;
+
+typedef struct MaterialComponent {
+    uint32_t material;
+} MaterialComponent;
+
+template <typename T> struct ComponentTraits;
+template <> struct ComponentTraits<TransformComponent> { static const ComponentType type = COMPONENT_TRANSFORM; };
+template <> struct ComponentTraits<WorldMatrixComponent> { static const ComponentType type = COMPONENT_WORLD_MATRIX; };
+template <> struct ComponentTraits<BoundsComponent> { static const ComponentType type = COMPONENT_BOUNDS; };
+template <> struct ComponentTraits<WorldBoundsComponent> { static const ComponentType type = COMPONENT_WORLD_BOUNDS; };
+template <> struct ComponentTraits<MeshComponent> { static const ComponentType type = COMPONENT_MESH; };
+template <> struct ComponentTraits<MaterialComponent> { static const ComponentType type = COMPONENT_MATERIAL; };
+
+/*
+Stable handle. The index picks a slot, the generation tells a live entity from a destroyed one
+whose slot was reused.
+*/
+typedef struct Entity {
+    uint32_t index;
+    uint32_t generation;
+} Entity;
+
+const Entity NULL_ENTITY = { 0xffffffff, 0 };
+
+/*
+Every entity with the same set of components. Each component is its own tightly packed array,
+so a system that only needs world bounds walks nothing but world bounds.
+Rows are dense: destroying an entity moves the last row into its place.
+*/
+class Archetype
+{
+public:
+    ComponentMask GetMask() const { return mMask; }
+    bool Has(ComponentMask mask) const { return (mMask & mask) == mask; }
+    uint32_t GetCount() const { return mCount; }
+    const Entity* GetEntities() const { return mEntities.data(); }
+
+    /*
+    The whole column, GetCount() long. nullptr if this archetype doesn't have T.
+    Invalidated by anything that adds rows to this archetype.
+    */
+    template <typename T>
+    T* Get()
+    {
+        Column& column = mColumns[ComponentTraits<T>::type];
+        return column.data.empty() ? nullptr : reinterpret_cast<T*>(column.data.data());
+    }
+
+private:
+    friend class EntityStore;
+
+    struct Column
+    {
+        std::vector<char> data;
+        uint32_t stride = 0;
+    };
+
+    ComponentMask mMask = 0;
+    uint32_t mCount = 0;
+    std::vector<Entity> mEntities;
+    Column mColumns[COMPONENT_TYPE_COUNT];
+};
+
+typedef struct EntityStoreInfo {
+    uint32_t initialCapacity;   // entity slots reserved up front
+} EntityStoreInfo;
+
+/*
+Archetype entity store. Entities live in the archetype matching their component mask; systems
+iterate archetypes (GetArchetypeCount/GetArchetype) and work on whole columns at a time.
+Not thread safe: create, destroy and change components from one thread, between the systems.
+*/
+class EntityStore
+{
+public:
+    void Initialize(EntityStoreInfo* entityStoreInfo);
+    void Shutdown();
+
+    /*
+    New entity with zeroed components, except transforms (identity) and world matrices (identity).
+    */
+    Entity Create(ComponentMask mask);
+    void Destroy(Entity entity);
+    bool IsAlive(Entity entity) const;
+
+    /*
+    Move the entity to the archetype for mask. Components it keeps are copied over, new ones start
+    out as in Create().
+    */
+    void SetComponents(Entity entity, ComponentMask mask);
+    ComponentMask GetComponents(Entity entity) const;
+
+    template <typename T>
+    T* Get(Entity entity)
+    {
+        if (!IsAlive(entity))
+        {
+            return nullptr;
+        }
+        const Slot& slot = mSlots[entity.index];
+        T* column = mArchetypes[slot.archetype]->Get<T>();
+        return column != nullptr ? column + slot.row : nullptr;
+    }
+
+    /*
+    Make room for count more entities with this mask, so a bulk spawn doesn't grow the columns one row at a time.
+    */
+    void Reserve(ComponentMask mask, uint32_t count);
+
+    uint32_t GetEntityCount() const { return mEntityCount; }
+    uint32_t GetArchetypeCount() const { return static_cast<uint32_t>(mArchetypes.size()); }
+    Archetype& GetArchetype(uint32_t index) { return *mArchetypes[index]; }
+
+private:
+    struct Slot
+    {
+        uint32_t archetype;
+        uint32_t row;
+        uint32_t generation;
+    };
+
+    uint32_t GetOrCreateArchetype(ComponentMask mask);
+    uint32_t AppendRow(uint32_t archetypeIndex, Entity entity);
+    void RemoveRow(uint32_t archetypeIndex, uint32_t row);
+
+    // archetypes never move or go away, so their indices are stable.
+    std::vector<std::unique_ptr<Archetype>> mArchetypes;
+    std::vector<Slot> mSlots;
+    std::vector<uint32_t> mFreeSlots;
+    uint32_t mEntityCount = 0;
+};
+
+#endif _ENTITY_STORE_H_
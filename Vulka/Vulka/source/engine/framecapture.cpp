@@ -0,0 +1,322 @@
+#include "framecapture.h"
+#include "logger.h"
+
+#include <fstream>
+
+void FrameCapture::Initialize(FrameCaptureInfo* frameCaptureInfo)
+{
+    mPath = frameCaptureInfo->path;
+    mFrameCount = frameCaptureInfo->frameCount;
+    mFramesRecorded = 0;
+    mRecordCount = 0;
+
+    if (fopen_s(&mFile, mPath.c_str(), "wb") != 0 || mFile == nullptr)
+    {
+        mFile = nullptr;
+        logger.error("Couldn't open %s for frame capture.", mPath.c_str());
+        return;
+    }
+
+    // frame and record counts are patched in when the capture closes.
+    FrameCaptureHeader header = {};
+    header.magic = FRAME_CAPTURE_MAGIC;
+    header.version = FRAME_CAPTURE_VERSION;
+    fwrite(&header, sizeof(header), 1, mFile);
+
+    logger.debug("Frame capture started. Recording %u frames to %s.", mFrameCount, mPath.c_str());
+}
+
+void FrameCapture::Shutdown()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFile != nullptr)
+    {
+        logger.warn("Frame capture stopped after %u of %u frames.", mFramesRecorded, mFrameCount);
+        Close();
+    }
+    mIds.clear();
+}
+
+void FrameCapture::Close()
+{
+    FrameCaptureHeader header = {};
+    header.magic = FRAME_CAPTURE_MAGIC;
+    header.version = FRAME_CAPTURE_VERSION;
+    header.frameCount = mFramesRecorded;
+    header.recordCount = mRecordCount;
+    fseek(mFile, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, mFile);
+
+    long size = 0;
+    fseek(mFile, 0, SEEK_END);
+    size = ftell(mFile);
+    fclose(mFile);
+    mFile = nullptr;
+
+    logger.debug("Frame capture written to %s (%u frames, %u records, %.1f MB).", mPath.c_str(), mFramesRecorded, mRecordCount, size / (1024.0 * 1024.0));
+}
+
+void FrameCapture::WriteRecord(FrameCaptureCommand command, const void* payload, uint32_t payloadSize, const void* extra, uint32_t extraSize, const void* extra2, uint32_t extra2Size)
+{
+    uint32_t recordHeader[2] = { static_cast<uint32_t>(command), payloadSize + extraSize + extra2Size };
+    fwrite(recordHeader, sizeof(recordHeader), 1, mFile);
+    if (payloadSize > 0)
+    {
+        fwrite(payload, payloadSize, 1, mFile);
+    }
+    if (extraSize > 0)
+    {
+        fwrite(extra, extraSize, 1, mFile);
+    }
+    if (extra2Size > 0)
+    {
+        fwrite(extra2, extra2Size, 1, mFile);
+    }
+    ++mRecordCount;
+}
+
+uint32_t FrameCapture::GetId(uint64_t handle)
+{
+    auto it = mIds.find(handle);
+    if (it != mIds.end())
+    {
+        return it->second;
+    }
+    // something created before the capture or outside its hooks. 0 tells the replayer to skip it.
+    return 0;
+}
+
+void FrameCapture::CreateBuffer(VkBuffer buffer, VkDeviceSize size, VkBufferUsageFlags usage)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFile == nullptr)
+    {
+        return;
+    }
+
+    FrameCaptureBuffer payload = {};
+    payload.id = mNextId++;
+    payload.usage = usage;
+    payload.size = size;
+    mIds[(uint64_t)buffer] = payload.id;
+    WriteRecord(FRAME_CAPTURE_CREATE_BUFFER, &payload, sizeof(payload));
+}
+
+void FrameCapture::UploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFile == nullptr)
+    {
+        return;
+    }
+
+    FrameCaptureUpload payload = {};
+    payload.id = GetId((uint64_t)buffer);
+    payload.offset = offset;
+    payload.size = size;
+    WriteRecord(FRAME_CAPTURE_UPLOAD_BUFFER, &payload, sizeof(payload), data, static_cast<uint32_t>(size));
+}
+
+void FrameCapture::DestroyBuffer(VkBuffer buffer)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFile == nullptr)
+    {
+        return;
+    }
+
+    FrameCaptureObject payload = { GetId((uint64_t)buffer) };
+    mIds.erase((uint64_t)buffer);
+    WriteRecord(FRAME_CAPTURE_DESTROY_BUFFER, &payload, sizeof(payload));
+}
+
+void FrameCapture::CreatePipeline(VkPipeline pipeline, const FrameCapturePipelineDesc& desc, const std::vector<char>& vertexCode, const std::vector<char>* pFragmentCode)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFile == nullptr)
+    {
+        return;
+    }
+
+    FrameCapturePipeline payload = {};
+    payload.id = mNextId++;
+    payload.desc = desc;
+    payload.vertexCodeSize = static_cast<uint32_t>(vertexCode.size());
+    payload.fragmentCodeSize = pFragmentCode != nullptr ? static_cast<uint32_t>(pFragmentCode->size()) : 0;
+    mIds[(uint64_t)pipeline] = payload.id;
+    WriteRecord(FRAME_CAPTURE_CREATE_PIPELINE, &payload, sizeof(payload), vertexCode.data(), payload.vertexCodeSize,
+        pFragmentCode != nullptr ? pFragmentCode->data() : nullptr, payload.fragmentCodeSize);
+}
+
+void FrameCapture::DestroyPipeline(VkPipeline pipeline)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFile == nullptr || pipeline == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    FrameCaptureObject payload = { GetId((uint64_t)pipeline) };
+    mIds.erase((uint64_t)pipeline);
+    WriteRecord(FRAME_CAPTURE_DESTROY_PIPELINE, &payload, sizeof(payload));
+}
+
+void FrameCapture::BeginFrame()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFile == nullptr)
+    {
+        return;
+    }
+
+    FrameCaptureObject payload = { mFramesRecorded };
+    WriteRecord(FRAME_CAPTURE_BEGIN_FRAME, &payload, sizeof(payload));
+    mInFrame = true;
+}
+
+void FrameCapture::FrameData(const void* data, uint32_t size)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFile == nullptr || !mInFrame)
+    {
+        return;
+    }
+    WriteRecord(FRAME_CAPTURE_FRAME_DATA, data, size);
+}
+
+void FrameCapture::InstanceData(const void* data, uint32_t size)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFile == nullptr || !mInFrame)
+    {
+        return;
+    }
+    WriteRecord(FRAME_CAPTURE_INSTANCE_DATA, data, size);
+}
+
+void FrameCapture::BeginPass(const FrameCapturePass& pass)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFile == nullptr || !mInFrame)
+    {
+        return;
+    }
+    WriteRecord(FRAME_CAPTURE_BEGIN_PASS, &pass, sizeof(pass));
+}
+
+void FrameCapture::BindPipeline(VkPipeline pipeline)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFile == nullptr || !mInFrame)
+    {
+        return;
+    }
+
+    FrameCaptureObject payload = { GetId((uint64_t)pipeline) };
+    WriteRecord(FRAME_CAPTURE_BIND_PIPELINE, &payload, sizeof(payload));
+}
+
+void FrameCapture::BindVertexBuffer(VkBuffer buffer, VkDeviceSize offset)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFile == nullptr || !mInFrame)
+    {
+        return;
+    }
+
+    FrameCaptureBind payload = {};
+    payload.id = GetId((uint64_t)buffer);
+    payload.offset = offset;
+    WriteRecord(FRAME_CAPTURE_BIND_VERTEX_BUFFER, &payload, sizeof(payload));
+}
+
+void FrameCapture::Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFile == nullptr || !mInFrame)
+    {
+        return;
+    }
+
+    FrameCaptureDraw payload = { vertexCount, instanceCount, firstVertex, firstInstance };
+    WriteRecord(FRAME_CAPTURE_DRAW, &payload, sizeof(payload));
+}
+
+void FrameCapture::EndPass()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFile == nullptr || !mInFrame)
+    {
+        return;
+    }
+    WriteRecord(FRAME_CAPTURE_END_PASS, nullptr, 0);
+}
+
+void FrameCapture::EndFrame()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFile == nullptr || !mInFrame)
+    {
+        return;
+    }
+
+    WriteRecord(FRAME_CAPTURE_END_FRAME, nullptr, 0);
+    mInFrame = false;
+    if (++mFramesRecorded >= mFrameCount)
+    {
+        Close();
+    }
+}
+
+void FrameCaptureReader::Open(const char* path)
+{
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+        logger.throw_error("failed to open capture %s.", path);
+    }
+
+    size_t fileSize = (size_t)file.tellg();
+    mData.resize(fileSize);
+    file.seekg(0);
+    file.read(mData.data(), fileSize);
+
+    if (fileSize < sizeof(FrameCaptureHeader))
+    {
+        logger.throw_error("%s is too small to be a capture.", path);
+    }
+    memcpy(&mHeader, mData.data(), sizeof(mHeader));
+    if (mHeader.magic != FRAME_CAPTURE_MAGIC)
+    {
+        logger.throw_error("%s isn't a Vulka capture.", path);
+    }
+    if (mHeader.version != FRAME_CAPTURE_VERSION)
+    {
+        logger.throw_error("%s is capture version %u, this build reads version %u.", path, mHeader.version, FRAME_CAPTURE_VERSION);
+    }
+
+    Rewind();
+    logger.debug("Capture %s loaded (%u frames, %u records).", path, mHeader.frameCount, mHeader.recordCount);
+}
+
+bool FrameCaptureReader::Next(FrameCaptureRecord& record)
+{
+    uint32_t recordHeader[2];
+    if (mCursor + sizeof(recordHeader) > mData.size())
+    {
+        return false;
+    }
+    memcpy(recordHeader, mData.data() + mCursor, sizeof(recordHeader));
+    if (mCursor + sizeof(recordHeader) + recordHeader[1] > mData.size())
+    {
+        logger.warn("Capture is truncated. Stopping at the last complete record.");
+        mCursor = mData.size();
+        return false;
+    }
+
+    record.command = static_cast<FrameCaptureCommand>(recordHeader[0]);
+    record.pData = mData.data() + mCursor + sizeof(recordHeader);
+    record.size = recordHeader[1];
+    mCursor += sizeof(recordHeader) + recordHeader[1];
+    return true;
+}
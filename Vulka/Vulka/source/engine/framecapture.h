@@ -0,0 +1,205 @@
+#ifndef _FRAME_CAPTURE_H_
+#define _FRAME_CAPTURE_H_
+
+#include "vulkanloader.h"
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+File layout: a FrameCaptureHeader, then records of { uint32 command, uint32 payload size, payload }.
+Payloads are the structs below, written as-is, some followed by raw bytes (upload data, shader code).
+It's a same-machine format: no endianness or packing fixups, and the version is bumped on any change.
+*/
+const uint32_t FRAME_CAPTURE_MAGIC = 'VKCP';
+const uint32_t FRAME_CAPTURE_VERSION = 3;
+const uint32_t FRAME_CAPTURE_MAX_ATTRIBUTES = 8;
+const uint32_t FRAME_CAPTURE_MAX_CONSTANTS = 8;
+// world matrices (one mat4 each) a frame can carry: the engine's instance binding and the replayer's are both this big.
+const uint32_t FRAME_CAPTURE_MAX_INSTANCES = 128 * 1024;
+const VkDeviceSize FRAME_CAPTURE_INSTANCE_RANGE = FRAME_CAPTURE_MAX_INSTANCES * 16 * sizeof(float);
+
+enum FrameCaptureCommand
+{
+    FRAME_CAPTURE_CREATE_BUFFER = 1,    // FrameCaptureBuffer
+    FRAME_CAPTURE_UPLOAD_BUFFER,        // FrameCaptureUpload + size bytes
+    FRAME_CAPTURE_DESTROY_BUFFER,       // FrameCaptureObject
+    FRAME_CAPTURE_CREATE_PIPELINE,      // FrameCapturePipeline + vertex code + fragment code
+    FRAME_CAPTURE_DESTROY_PIPELINE,     // FrameCaptureObject
+    FRAME_CAPTURE_BEGIN_FRAME,          // FrameCaptureObject (frame index)
+    FRAME_CAPTURE_FRAME_DATA,           // per-frame uniform bytes
+    FRAME_CAPTURE_BEGIN_PASS,           // FrameCapturePass
+    FRAME_CAPTURE_BIND_PIPELINE,        // FrameCaptureObject
+    FRAME_CAPTURE_BIND_VERTEX_BUFFER,   // FrameCaptureBind
+    FRAME_CAPTURE_DRAW,                 // FrameCaptureDraw
+    FRAME_CAPTURE_END_PASS,             // nothing
+    FRAME_CAPTURE_END_FRAME,            // nothing
+    FRAME_CAPTURE_INSTANCE_DATA,        // per-frame world matrices, one per instance
+};
+
+typedef struct FrameCaptureHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t frameCount;
+    uint32_t recordCount;
+} FrameCaptureHeader;
+
+typedef struct FrameCaptureObject {
+    uint32_t id;
+} FrameCaptureObject;
+
+typedef struct FrameCaptureBuffer {
+    uint32_t id;
+    VkBufferUsageFlags usage;
+    VkDeviceSize size;
+} FrameCaptureBuffer;
+
+typedef struct FrameCaptureUpload {
+    uint32_t id;
+    uint32_t reserved;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+} FrameCaptureUpload;
+
+// the subset of graphics pipeline state the engine varies. everything else matches createGraphicsPipeline().
+typedef struct FrameCapturePipelineDesc {
+    uint32_t vertexStride;
+    uint32_t attributeCount;
+    VkVertexInputAttributeDescription attributes[FRAME_CAPTURE_MAX_ATTRIBUTES];
+    VkPrimitiveTopology topology;
+    VkCullModeFlags cullMode;
+    VkFrontFace frontFace;
+    VkBool32 depthTest;
+    VkBool32 depthWrite;
+    VkCompareOp depthCompareOp;
+    VkColorComponentFlags colorWriteMask;
+    VkSampleCountFlagBits samples;
+    VkFormat colorFormat;
+    VkFormat depthFormat;
+    // specialization constants, 32 bits each, applied to every stage.
+    uint32_t constantCount;
+    uint32_t constantIds[FRAME_CAPTURE_MAX_CONSTANTS];
+    uint32_t constantValues[FRAME_CAPTURE_MAX_CONSTANTS];
+} FrameCapturePipelineDesc;
+
+typedef struct FrameCapturePipeline {
+    uint32_t id;
+    FrameCapturePipelineDesc desc;
+    uint32_t vertexCodeSize;
+    uint32_t fragmentCodeSize;          // 0 for depth-only pipelines
+} FrameCapturePipeline;
+
+typedef struct FrameCapturePass {
+    VkExtent2D extent;
+    float clearColor[4];
+    float clearDepth;
+    VkFormat colorFormat;
+    VkFormat depthFormat;
+    VkSampleCountFlagBits samples;
+} FrameCapturePass;
+
+typedef struct FrameCaptureBind {
+    uint32_t id;
+    uint32_t reserved;
+    VkDeviceSize offset;
+} FrameCaptureBind;
+
+typedef struct FrameCaptureDraw {
+    uint32_t vertexCount;
+    uint32_t instanceCount;
+    uint32_t firstVertex;
+    uint32_t firstInstance;
+} FrameCaptureDraw;
+
+typedef struct FrameCaptureInfo {
+    std::string path;
+    uint32_t frameCount;    // frames recorded after which the file is closed
+} FrameCaptureInfo;
+
+/*
+Records the high-level render commands the engine issues (resource creation, uploads,
+pipelines, passes, binds, draws) along with the data they reference, so VulkaReplay can
+re-issue them without the game. Armed from startup so every resource a captured frame
+uses is in the file. Closes itself after frameCount frames; calls after that do nothing.
+
+Vulkan handles are mapped to small ids on the way in. Safe to call from several threads.
+*/
+class FrameCapture
+{
+public:
+    void Initialize(FrameCaptureInfo* frameCaptureInfo);
+    void Shutdown();
+
+    bool IsRecording() const { return mFile != nullptr; }
+
+    void CreateBuffer(VkBuffer buffer, VkDeviceSize size, VkBufferUsageFlags usage);
+    void UploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size);
+    void DestroyBuffer(VkBuffer buffer);
+    void CreatePipeline(VkPipeline pipeline, const FrameCapturePipelineDesc& desc, const std::vector<char>& vertexCode, const std::vector<char>* pFragmentCode);
+    void DestroyPipeline(VkPipeline pipeline);
+
+    void BeginFrame();
+    void FrameData(const void* data, uint32_t size);
+    void InstanceData(const void* data, uint32_t size);
+    void BeginPass(const FrameCapturePass& pass);
+    void BindPipeline(VkPipeline pipeline);
+    void BindVertexBuffer(VkBuffer buffer, VkDeviceSize offset);
+    void Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance);
+    void EndPass();
+    void EndFrame();
+
+private:
+    void WriteRecord(FrameCaptureCommand command, const void* payload, uint32_t payloadSize, const void* extra = nullptr, uint32_t extraSize = 0, const void* extra2 = nullptr, uint32_t extra2Size = 0);
+    uint32_t GetId(uint64_t handle);
+    void Close();
+
+    std::mutex mMutex;
+    FILE* mFile = nullptr;
+    std::string mPath;
+    uint32_t mFrameCount = 0;
+    uint32_t mFramesRecorded = 0;
+    uint32_t mRecordCount = 0;
+    bool mInFrame = false;
+    std::unordered_map<uint64_t, uint32_t> mIds;
+    uint32_t mNextId = 1;
+};
+
+typedef struct FrameCaptureRecord {
+    FrameCaptureCommand command;
+    const char* pData;
+    uint32_t size;
+} FrameCaptureRecord;
+
+/*
+Reads a capture back. The whole file is loaded up front so replay never touches the disk.
+*/
+class FrameCaptureReader
+{
+public:
+    void Open(const char* path);
+
+    const FrameCaptureHeader& GetHeader() const { return mHeader; }
+    bool Next(FrameCaptureRecord& record);
+    void Rewind() { mCursor = sizeof(FrameCaptureHeader); }
+
+    template <typename T>
+    static T ReadPayload(const FrameCaptureRecord& record)
+    {
+        T value = {};
+        if (record.size >= sizeof(T))
+        {
+            memcpy(&value, record.pData, sizeof(T));
+        }
+        return value;
+    }
+
+private:
+    std::vector<char> mData;
+    FrameCaptureHeader mHeader = {};
+    size_t mCursor = 0;
+};
+
+#endif _FRAME_CAPTURE_H_
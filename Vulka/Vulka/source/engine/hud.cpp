@@ -0,0 +1,370 @@
+#include "hud.h"
+#include "logger.h"
+#include "profiler.h"
+#include "vkutil.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+// glyphs are 3x5 texels in 4x6 atlas cells, drawn at GLYPH_SCALE pixels per texel.
+const uint32_t GLYPH_WIDTH = 3;
+const uint32_t GLYPH_HEIGHT = 5;
+const uint32_t ATLAS_CELL_WIDTH = GLYPH_WIDTH + 1;
+const uint32_t ATLAS_CELL_HEIGHT = GLYPH_HEIGHT + 1;
+const uint32_t ATLAS_COLUMNS = 16;
+const float GLYPH_SCALE = 2.0f;
+const float GLYPH_ADVANCE = ATLAS_CELL_WIDTH * GLYPH_SCALE;
+const float LINE_HEIGHT = (ATLAS_CELL_HEIGHT + 1) * GLYPH_SCALE;
+
+const float PANEL_X = 8.0f;
+const float PANEL_Y = 8.0f;
+const float PANEL_PADDING = 6.0f;
+const float GRAPH_HEIGHT = 48.0f;
+const float GRAPH_BAR_WIDTH = 2.0f;
+// the graph's top is this many ms, unless a frame took longer.
+const double GRAPH_MIN_SCALE_MS = 33.3;
+const double TARGET_FRAME_MS = 1000.0 / 60.0;
+
+const glm::vec3 PANEL_COLOR = glm::vec3(0.05f, 0.05f, 0.08f);
+const glm::vec3 TEXT_COLOR = glm::vec3(0.9f, 0.9f, 0.9f);
+const glm::vec3 LABEL_COLOR = glm::vec3(0.55f, 0.75f, 1.0f);
+const glm::vec3 GOOD_COLOR = glm::vec3(0.3f, 0.85f, 0.3f);
+const glm::vec3 SLOW_COLOR = glm::vec3(0.95f, 0.8f, 0.2f);
+const glm::vec3 BAD_COLOR = glm::vec3(0.95f, 0.25f, 0.2f);
+
+/*
+Everything the HUD prints. Lower case is drawn as upper case, anything else missing as '?'.
+*/
+static const struct Glyph
+{
+    char character;
+    const char* rows[GLYPH_HEIGHT];
+} glyphs[] = {
+    { ' ', { "000", "000", "000", "000", "000" } },
+    { '0', { "111", "101", "101", "101", "111" } },
+    { '1', { "010", "110", "010", "010", "111" } },
+    { '2', { "111", "001", "111", "100", "111" } },
+    { '3', { "111", "001", "111", "001", "111" } },
+    { '4', { "101", "101", "111", "001", "001" } },
+    { '5', { "111", "100", "111", "001", "111" } },
+    { '6', { "111", "100", "111", "101", "111" } },
+    { '7', { "111", "001", "001", "001", "001" } },
+    { '8', { "111", "101", "111", "101", "111" } },
+    { '9', { "111", "101", "111", "001", "111" } },
+    { 'A', { "010", "101", "111", "101", "101" } },
+    { 'B', { "110", "101", "110", "101", "110" } },
+    { 'C', { "011", "100", "100", "100", "011" } },
+    { 'D', { "110", "101", "101", "101", "110" } },
+    { 'E', { "111", "100", "110", "100", "111" } },
+    { 'F', { "111", "100", "110", "100", "100" } },
+    { 'G', { "011", "100", "101", "101", "011" } },
+    { 'H', { "101", "101", "111", "101", "101" } },
+    { 'I', { "111", "010", "010", "010", "111" } },
+    { 'J', { "001", "001", "001", "101", "010" } },
+    { 'K', { "101", "101", "110", "101", "101" } },
+    { 'L', { "100", "100", "100", "100", "111" } },
+    { 'M', { "101", "111", "111", "101", "101" } },
+    { 'N', { "110", "101", "101", "101", "101" } },
+    { 'O', { "010", "101", "101", "101", "010" } },
+    { 'P', { "110", "101", "110", "100", "100" } },
+    { 'Q', { "010", "101", "101", "110", "011" } },
+    { 'R', { "110", "101", "110", "101", "101" } },
+    { 'S', { "011", "100", "010", "001", "110" } },
+    { 'T', { "111", "010", "010", "010", "010" } },
+    { 'U', { "101", "101", "101", "101", "111" } },
+    { 'V', { "101", "101", "101", "101", "010" } },
+    { 'W', { "101", "101", "111", "111", "101" } },
+    { 'X', { "101", "101", "010", "101", "101" } },
+    { 'Y', { "101", "101", "010", "010", "010" } },
+    { 'Z', { "111", "001", "010", "100", "111" } },
+    { '.', { "000", "000", "000", "000", "010" } },
+    { ',', { "000", "000", "000", "010", "100" } },
+    { ':', { "000", "010", "000", "010", "000" } },
+    { '-', { "000", "000", "111", "000", "000" } },
+    { '+', { "000", "010", "111", "010", "000" } },
+    { '=', { "000", "111", "000", "111", "000" } },
+    { '/', { "001", "001", "010", "100", "100" } },
+    { '%', { "101", "001", "010", "100", "101" } },
+    { '(', { "010", "100", "100", "100", "010" } },
+    { ')', { "010", "001", "001", "001", "010" } },
+    { '_', { "000", "000", "000", "000", "111" } },
+    { '?', { "111", "001", "010", "000", "010" } }
+};
+const uint32_t GLYPH_COUNT = sizeof(glyphs) / sizeof(glyphs[0]);
+// the cell after the glyphs is lit all the way, for everything that isn't text.
+const uint32_t SOLID_CELL = GLYPH_COUNT;
+
+void Hud::Initialize(HudInfo* hudInfo)
+{
+    mPhysicalDevice = hudInfo->physicalDevice;
+    mDevice = hudInfo->device;
+    mMaxQuads = hudInfo->maxQuads;
+    mVisible = hudInfo->visible;
+    mHistory.assign((std::max)(hudInfo->historyLength, 1u), 0.0);
+    mHistoryNext = 0;
+    mQuads.reserve(static_cast<size_t>(mMaxQuads) * HUD_VERTEX_COUNT);
+
+    CreateAtlas(hudInfo->pTransfer);
+}
+
+void Hud::CreateAtlas(TransferQueue* pTransfer)
+{
+    uint32_t atlasRows = (SOLID_CELL + ATLAS_COLUMNS) / ATLAS_COLUMNS;
+    VkExtent2D extent = { ATLAS_COLUMNS * ATLAS_CELL_WIDTH, atlasRows * ATLAS_CELL_HEIGHT };
+    // one byte per texel, 255 where lit.
+    std::vector<uint8_t> texels(static_cast<size_t>(extent.width) * extent.height, 0);
+
+    uint32_t unknown = GLYPH_COUNT - 1;
+    memset(mGlyphCells, unknown, sizeof(mGlyphCells));
+    for (uint32_t i = 0; i < GLYPH_COUNT; ++i)
+    {
+        uint32_t cellX = (i % ATLAS_COLUMNS) * ATLAS_CELL_WIDTH;
+        uint32_t cellY = (i / ATLAS_COLUMNS) * ATLAS_CELL_HEIGHT;
+        for (uint32_t y = 0; y < GLYPH_HEIGHT; ++y)
+        {
+            for (uint32_t x = 0; x < GLYPH_WIDTH; ++x)
+            {
+                texels[(cellY + y) * extent.width + cellX + x] = glyphs[i].rows[y][x] == '1' ? 255 : 0;
+            }
+        }
+        mGlyphCells[static_cast<uint8_t>(glyphs[i].character)] = static_cast<uint8_t>(i);
+    }
+    for (char c = 'a'; c <= 'z'; ++c)
+    {
+        mGlyphCells[static_cast<uint8_t>(c)] = mGlyphCells[static_cast<uint8_t>(c - 'a' + 'A')];
+    }
+
+    uint32_t solidX = (SOLID_CELL % ATLAS_COLUMNS) * ATLAS_CELL_WIDTH;
+    uint32_t solidY = (SOLID_CELL / ATLAS_COLUMNS) * ATLAS_CELL_HEIGHT;
+    for (uint32_t y = 0; y < ATLAS_CELL_HEIGHT; ++y)
+    {
+        memset(&texels[(solidY + y) * extent.width + solidX], 255, ATLAS_CELL_WIDTH);
+    }
+
+    mTexelToUv = glm::vec2(1.0f / extent.width, 1.0f / extent.height);
+    mSolidUv = glm::vec2(solidX + 0.5f * ATLAS_CELL_WIDTH, solidY + 0.5f * ATLAS_CELL_HEIGHT) * mTexelToUv;
+
+    CreateImage(mPhysicalDevice, mDevice, extent, VK_FORMAT_R8_UNORM, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        MEMORY_CATEGORY_OTHER, &mAtlasImage, &mAtlasMemory);
+
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = mAtlasImage;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R8_UNORM;
+    viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    if (vkCreateImageView(mDevice, &viewInfo, nullptr, &mAtlasView) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to create the hud atlas view.");
+    }
+
+    // glyphs are drawn at whole multiples of their texels, so nearest keeps them sharp.
+    VkSamplerCreateInfo samplerInfo = {};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = 0.0f;
+
+    if (vkCreateSampler(mDevice, &samplerInfo, nullptr, &mAtlasSampler) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to create the hud atlas sampler.");
+    }
+
+    mAtlasUploadValue = pTransfer->UploadImage(mAtlasImage, extent, texels.data(), texels.size(),
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+}
+
+void Hud::Shutdown()
+{
+    vkDestroySampler(mDevice, mAtlasSampler, nullptr);
+    vkDestroyImageView(mDevice, mAtlasView, nullptr);
+    vkDestroyImage(mDevice, mAtlasImage, nullptr);
+    memoryBudget.TrackFree(mAtlasMemory);
+    vkFreeMemory(mDevice, mAtlasMemory, nullptr);
+    mAtlasSampler = VK_NULL_HANDLE;
+    mAtlasView = VK_NULL_HANDLE;
+    mAtlasImage = VK_NULL_HANDLE;
+    mAtlasMemory = VK_NULL_HANDLE;
+
+    mHistory.clear();
+    mQuads.clear();
+    mVertices = {};
+    mVertexCount = 0;
+}
+
+void Hud::AddFrameTime(double frameMs)
+{
+    mHistory[mHistoryNext] = frameMs;
+    mHistoryNext = (mHistoryNext + 1) % static_cast<uint32_t>(mHistory.size());
+}
+
+VkVertexInputBindingDescription Hud::GetBindingDescription()
+{
+    VkVertexInputBindingDescription bindingDescription = {};
+    bindingDescription.binding = 0;
+    bindingDescription.stride = sizeof(HudVertex);
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    return bindingDescription;
+}
+
+std::array<VkVertexInputAttributeDescription, 3> Hud::GetAttributeDescriptions()
+{
+    std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions = {};
+    attributeDescriptions[0].binding = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
+    attributeDescriptions[0].offset = offsetof(HudVertex, pos);
+
+    attributeDescriptions[1].binding = 0;
+    attributeDescriptions[1].location = 1;
+    attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
+    attributeDescriptions[1].offset = offsetof(HudVertex, uv);
+
+    attributeDescriptions[2].binding = 0;
+    attributeDescriptions[2].location = 2;
+    attributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescriptions[2].offset = offsetof(HudVertex, color);
+    return attributeDescriptions;
+}
+
+void Hud::Quad(float x, float y, float width, float height, const glm::vec2& uvTopLeft, const glm::vec2& uvBottomRight, const glm::vec3& color)
+{
+    if (mQuads.size() + HUD_VERTEX_COUNT > static_cast<size_t>(mMaxQuads) * HUD_VERTEX_COUNT)
+    {
+        return;
+    }
+
+    glm::vec2 topLeft = glm::vec2(x, y) * mPixelToClip - 1.0f;
+    glm::vec2 bottomRight = glm::vec2(x + width, y + height) * mPixelToClip - 1.0f;
+    glm::vec2 topRight = glm::vec2(bottomRight.x, topLeft.y);
+    glm::vec2 bottomLeft = glm::vec2(topLeft.x, bottomRight.y);
+    glm::vec2 uvTopRight = glm::vec2(uvBottomRight.x, uvTopLeft.y);
+    glm::vec2 uvBottomLeft = glm::vec2(uvTopLeft.x, uvBottomRight.y);
+
+    // same winding as SpriteBatch's quads.
+    mQuads.push_back({ topLeft, uvTopLeft, color });
+    mQuads.push_back({ topRight, uvTopRight, color });
+    mQuads.push_back({ bottomRight, uvBottomRight, color });
+    mQuads.push_back({ bottomRight, uvBottomRight, color });
+    mQuads.push_back({ bottomLeft, uvBottomLeft, color });
+    mQuads.push_back({ topLeft, uvTopLeft, color });
+}
+
+void Hud::Rect(float x, float y, float width, float height, const glm::vec3& color)
+{
+    Quad(x, y, width, height, mSolidUv, mSolidUv, color);
+}
+
+float Hud::Text(float x, float y, const glm::vec3& color, const char* format, ...)
+{
+    char text[128];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    uint8_t space = mGlyphCells[static_cast<uint8_t>(' ')];
+    for (const char* c = text; *c != '\0'; ++c, x += GLYPH_ADVANCE)
+    {
+        // one quad per glyph, over its cell. a space has nothing lit, so it's only an advance.
+        uint8_t cell = mGlyphCells[static_cast<uint8_t>(*c) & 0x7f];
+        if (cell == space)
+        {
+            continue;
+        }
+        glm::vec2 cellTopLeft = glm::vec2(static_cast<float>((cell % ATLAS_COLUMNS) * ATLAS_CELL_WIDTH), static_cast<float>((cell / ATLAS_COLUMNS) * ATLAS_CELL_HEIGHT));
+        glm::vec2 cellBottomRight = cellTopLeft + glm::vec2(static_cast<float>(GLYPH_WIDTH), static_cast<float>(GLYPH_HEIGHT));
+        Quad(x, y, GLYPH_WIDTH * GLYPH_SCALE, GLYPH_HEIGHT * GLYPH_SCALE, cellTopLeft * mTexelToUv, cellBottomRight * mTexelToUv, color);
+    }
+    return x;
+}
+
+void Hud::Build(UploadRing& ring, const HudStats& stats)
+{
+    mVertices = {};
+    mVertexCount = 0;
+    if (!mVisible || stats.extent.width == 0 || stats.extent.height == 0)
+    {
+        return;
+    }
+
+    PROFILE_FUNCTION();
+    mQuads.clear();
+    mPixelToClip = glm::vec2(2.0f / stats.extent.width, 2.0f / stats.extent.height);
+
+    uint32_t historyLength = static_cast<uint32_t>(mHistory.size());
+    double latestMs = mHistory[(mHistoryNext + historyLength - 1) % historyLength];
+    double worstMs = 0.0;
+    double sumMs = 0.0;
+    for (double ms : mHistory)
+    {
+        worstMs = (std::max)(worstMs, ms);
+        sumMs += ms;
+    }
+    double averageMs = sumMs / historyLength;
+
+    float width = (std::max)(historyLength * GRAPH_BAR_WIDTH, 32.0f * GLYPH_ADVANCE);
+    float height = 5.0f * LINE_HEIGHT + GRAPH_HEIGHT + PANEL_PADDING;
+    Rect(PANEL_X, PANEL_Y, width + 2.0f * PANEL_PADDING, height + 2.0f * PANEL_PADDING, PANEL_COLOR);
+
+    float x = PANEL_X + PANEL_PADDING;
+    float y = PANEL_Y + PANEL_PADDING;
+    float valueX = x + 5.0f * GLYPH_ADVANCE;
+    Text(x, y, LABEL_COLOR, "FPS");
+    Text(valueX, y, TEXT_COLOR, "%.1f  %.2f MS  AVG %.2f", averageMs > 0.0 ? 1000.0 / averageMs : 0.0, latestMs, averageMs);
+    y += LINE_HEIGHT;
+
+    Text(x, y, LABEL_COLOR, "CPU");
+    float afterCpu = stats.cpuMs >= 0.0 ? Text(valueX, y, TEXT_COLOR, "%.2f MS", stats.cpuMs) : Text(valueX, y, TEXT_COLOR, "-");
+    float gpuX = (std::max)(afterCpu + GLYPH_ADVANCE, valueX + 10.0f * GLYPH_ADVANCE);
+    Text(gpuX, y, LABEL_COLOR, "GPU");
+    if (stats.gpuMs >= 0.0)
+    {
+        Text(gpuX + 4.0f * GLYPH_ADVANCE, y, TEXT_COLOR, "%.2f MS", stats.gpuMs);
+    }
+    else
+    {
+        Text(gpuX + 4.0f * GLYPH_ADVANCE, y, TEXT_COLOR, "-");
+    }
+    y += LINE_HEIGHT;
+
+    Text(x, y, LABEL_COLOR, "DRAW");
+    Text(valueX, y, TEXT_COLOR, "%u  TRIS %llu", stats.draws, static_cast<unsigned long long>(stats.triangles));
+    y += LINE_HEIGHT;
+
+    Text(x, y, LABEL_COLOR, "MEM");
+    double usedMb = stats.memoryUsed / (1024.0 * 1024.0);
+    double budgetMb = stats.memoryBudget / (1024.0 * 1024.0);
+    glm::vec3 memoryColor = stats.memoryBudget > 0 && stats.memoryUsed > stats.memoryBudget ? BAD_COLOR : TEXT_COLOR;
+    Text(valueX, y, memoryColor, "%.1f / %.1f MB", usedMb, budgetMb);
+    y += LINE_HEIGHT;
+
+    Text(x, y, LABEL_COLOR, "PRES");
+    Text(valueX, y, TEXT_COLOR, "%s  %uX%u", stats.presentMode, stats.extent.width, stats.extent.height);
+    y += LINE_HEIGHT + PANEL_PADDING;
+
+    // frame time graph, oldest on the left. a tick marks the 60 fps budget.
+    double scaleMs = (std::max)(GRAPH_MIN_SCALE_MS, worstMs);
+    float graphBottom = y + GRAPH_HEIGHT;
+    for (uint32_t i = 0; i < historyLength; ++i)
+    {
+        double ms = mHistory[(mHistoryNext + i) % historyLength];
+        float barHeight = (std::max)(static_cast<float>(ms / scaleMs) * GRAPH_HEIGHT, 1.0f);
+        const glm::vec3& color = ms <= TARGET_FRAME_MS ? GOOD_COLOR : (ms <= 2.0 * TARGET_FRAME_MS ? SLOW_COLOR : BAD_COLOR);
+        Rect(x + i * GRAPH_BAR_WIDTH, graphBottom - barHeight, GRAPH_BAR_WIDTH, barHeight, color);
+    }
+    float targetY = graphBottom - static_cast<float>(TARGET_FRAME_MS / scaleMs) * GRAPH_HEIGHT;
+    Rect(x, targetY, historyLength * GRAPH_BAR_WIDTH, 1.0f, TEXT_COLOR);
+
+    mVertexCount = static_cast<uint32_t>(mQuads.size());
+    mVertices = ring.Allocate(mQuads.size() * sizeof(HudVertex), sizeof(glm::vec4));
+    memcpy(mVertices.pData, mQuads.data(), mQuads.size() * sizeof(HudVertex));
+}
@@ -0,0 +1,113 @@
+#ifndef _HUD_H_
+#define _HUD_H_
+
+#include "transferqueue.h"
+#include "uploadring.h"
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+typedef struct HudInfo {
+    VkPhysicalDevice physicalDevice;
+    VkDevice device;
+    TransferQueue* pTransfer;   // uploads the glyph atlas. the caller Require()s GetAtlasUploadValue()
+    uint32_t maxQuads;          // per frame. the ring handed to Build() needs room for maxQuads * HUD_VERTEX_COUNT vertices
+    uint32_t historyLength;     // frames shown in the frame time graph
+    bool visible;               // shown from the start
+} HudInfo;
+
+// laid out as hud.vert reads it. position is in clip space, uv in the glyph atlas.
+typedef struct HudVertex {
+    glm::vec2 pos;
+    glm::vec2 uv;
+    glm::vec3 color;
+} HudVertex;
+
+// two triangles per quad, not indexed.
+const uint32_t HUD_VERTEX_COUNT = 6;
+
+// what the HUD shows, gathered by the caller once per frame.
+typedef struct HudStats {
+    double cpuMs;               // negative when not known yet
+    double gpuMs;               // negative without timestamps
+    uint32_t draws;
+    uint64_t triangles;
+    VkDeviceSize memoryUsed;    // device local
+    VkDeviceSize memoryBudget;
+    const char* presentMode;
+    VkExtent2D extent;
+} HudStats;
+
+/*
+Performance overlay: frame time graph, cpu/gpu time, draws, triangles, memory and present mode.
+
+Text comes from a small bitmap font atlas, uploaded once as an R8 image that hud.frag samples
+(binding 2 of the frame's descriptor set) and discards unlit texels from. Each glyph is one quad
+over its atlas cell. Graph bars and the backing panel are quads too, over a cell that's lit all
+the way, so the whole overlay is a single stream of HudVertex quads: one vertex allocation and one
+draw. Hidden, it costs nothing but AddFrameTime().
+*/
+class Hud
+{
+public:
+    void Initialize(HudInfo* hudInfo);
+    void Shutdown();
+
+    void Toggle() { mVisible = !mVisible; }
+    bool IsVisible() const { return mVisible; }
+
+    // once per frame, shown or not, so the graph is full when the HUD is turned on.
+    void AddFrameTime(double frameMs);
+
+    /*
+    Lay out the overlay for stats and write its vertices into ring. Leaves nothing to draw when hidden.
+    ring must already be on the frame these vertices are for (UploadRing::BeginFrame()).
+    */
+    void Build(UploadRing& ring, const HudStats& stats);
+
+    VkBuffer GetVertexBuffer() const { return mVertices.buffer; }
+    VkDeviceSize GetVertexOffset() const { return mVertices.offset; }
+    uint32_t GetVertexCount() const { return mVertexCount; }
+
+    // in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL once the upload is acquired.
+    VkImageView GetAtlasView() const { return mAtlasView; }
+    VkSampler GetAtlasSampler() const { return mAtlasSampler; }
+    uint64_t GetAtlasUploadValue() const { return mAtlasUploadValue; }
+
+    static VkVertexInputBindingDescription GetBindingDescription();
+    static std::array<VkVertexInputAttributeDescription, 3> GetAttributeDescriptions();
+
+private:
+    void CreateAtlas(TransferQueue* pTransfer);
+    void Quad(float x, float y, float width, float height, const glm::vec2& uvTopLeft, const glm::vec2& uvBottomRight, const glm::vec3& color);
+    void Rect(float x, float y, float width, float height, const glm::vec3& color);
+    // returns the x after the last character.
+    float Text(float x, float y, const glm::vec3& color, const char* format, ...);
+
+    uint32_t mMaxQuads = 0;
+    bool mVisible = false;
+
+    std::vector<double> mHistory;   // ring of frame times, oldest at mHistoryNext
+    uint32_t mHistoryNext = 0;
+
+    VkPhysicalDevice mPhysicalDevice = VK_NULL_HANDLE;
+    VkDevice mDevice = VK_NULL_HANDLE;
+
+    // glyphs laid out in a grid of cells, then one solid cell.
+    VkImage mAtlasImage = VK_NULL_HANDLE;
+    VkDeviceMemory mAtlasMemory = VK_NULL_HANDLE;
+    VkImageView mAtlasView = VK_NULL_HANDLE;
+    VkSampler mAtlasSampler = VK_NULL_HANDLE;
+    uint64_t mAtlasUploadValue = 0;
+    glm::vec2 mTexelToUv = glm::vec2(0.0f);
+    uint8_t mGlyphCells[128];           // atlas cell of each ascii character
+    glm::vec2 mSolidUv = glm::vec2(0.0f);  // inside the solid cell
+
+    glm::vec2 mPixelToClip = glm::vec2(0.0f);
+    std::vector<HudVertex> mQuads;      // built on the cpu, copied to the ring in one go
+    UploadAllocation mVertices = {};
+    uint32_t mVertexCount = 0;
+};
+
+#endif _HUD_H_
@@ -15,6 +15,7 @@ void Input::Initialize(InputInfo* inputInfo)
 void Input::Update()
 {
     ProcessCloseKeys();
+    UpdateActionStates();
 }
 
 void Input::Shutdown()
@@ -41,6 +42,16 @@ void Input::ProcessCloseKeys()
     glfwSetWindowShouldClose(pWindow, GLFW_TRUE);
 }
 
+void Input::UpdateActionStates()
+{
+    for (const auto& binding : mKeybindings)
+    {
+        ActionState& state = mActionStates[binding.first];
+        state.previous = state.down;
+        state.down = glfwGetKey(pWindow, binding.second) == GLFW_PRESS;
+    }
+}
+
 void Input::AddKeybinding(uint32_t action, int key)
 {
     // this needs to be more smart, allowing a vector of keys for a single action.
@@ -77,4 +88,14 @@ bool Input::IsActionPressed(uint32_t action)
         return false;
     }
     return glfwGetKey(pWindow, iter->second) == GLFW_PRESS;
+}
+
+bool Input::IsActionJustPressed(uint32_t action)
+{
+    auto iter = mActionStates.find(action);
+    if (iter == mActionStates.end())
+    {
+        return false;
+    }
+    return iter->second.down && !iter->second.previous;
 }
\ No newline at end of file
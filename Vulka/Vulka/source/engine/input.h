@@ -19,15 +19,25 @@ public:
 
     void AddKeybinding(uint32_t action, int key);
     bool IsActionPressed(uint32_t action);
+    // true only on the first Update() the key is seen down. for toggles.
+    bool IsActionJustPressed(uint32_t action);
 
 private:
     void ProcessCloseKeys();
+    void UpdateActionStates();
 
     GLFWwindow* pWindow;
     int* pCloseKeys;
     size_t mCloseKeyCount;
 
     std::map<uint32_t, int> mKeybindings; // mapping of action -> GLFW_KEY value
+
+    struct ActionState
+    {
+        bool down = false;
+        bool previous = false;
+    };
+    std::map<uint32_t, ActionState> mActionStates; // sampled once per Update()
 };
 
 #endif _INPUT_H_
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <Windows.h>
 #include <cstdio>
 #include <cstdarg>
+#include <mutex>
 #if __cplusplus < 201703L
 #include <memory>
 #endif
@@ -189,6 +190,8 @@ private:
     template <typename... Args>
     void log_internal(const std::string& text, WORD color, bool newline=false)
     {
+        // startup work runs on worker threads too. the color swap below isn't atomic.
+        std::lock_guard<std::mutex> lock(outputMutex);
         // cache the current screen buffer info
         GetConsoleScreenBufferInfo(hstdout, &csbi);
         // set the specified color
@@ -207,6 +210,7 @@ private:
     template <typename... Args>
     void error_internal(const std::string& text, WORD color)
     {
+        std::lock_guard<std::mutex> lock(outputMutex);
         // cache the current screen buffer info
         GetConsoleScreenBufferInfo(herr, &csbi);
         // set the specified color
@@ -221,6 +225,7 @@ private:
     template <typename... Args>
     void throw_error_internal(const std::string& text, WORD color)
     {
+        std::lock_guard<std::mutex> lock(outputMutex);
         // cache the current screen buffer info
         GetConsoleScreenBufferInfo(herr, &csbi);
         // set the specified color
@@ -266,6 +271,8 @@ private:
     HANDLE hstdout;
     HANDLE herr;
     CONSOLE_SCREEN_BUFFER_INFO csbi;
+    // every translation unit gets its own copy of logger below, but they all write to the same console.
+    static inline std::mutex outputMutex;
 };
 
 /* 
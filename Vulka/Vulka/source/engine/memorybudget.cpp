@@ -0,0 +1,265 @@
+#include "memorybudget.h"
+#include "logger.h"
+
+#include <algorithm>
+
+MemoryBudget memoryBudget;
+
+// without VK_EXT_memory_budget, assume this much of a heap is ours to use before the os starts moving things around.
+const float FALLBACK_BUDGET_FRACTION = 0.8f;
+// the budget query goes through the driver, so don't do it every frame.
+const uint32_t BUDGET_QUERY_INTERVAL = 16;
+// a heap that warned has to drop this far below the threshold before it can warn again.
+const float WARNING_HYSTERESIS = 0.05f;
+
+static const char* categoryNames[MEMORY_CATEGORY_COUNT] = {
+    "geometry",
+    "render targets",
+    "upload ring",
+    "staging",
+    "other"
+};
+
+static double ToMB(VkDeviceSize bytes)
+{
+    return bytes / (1024.0 * 1024.0);
+}
+
+void MemoryBudget::Initialize(MemoryBudgetInfo* memoryBudgetInfo)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    mPhysicalDevice = memoryBudgetInfo->physicalDevice;
+    mUseBudgetExtension = memoryBudgetInfo->useBudgetExtension;
+    mWarningThreshold = memoryBudgetInfo->warningThreshold;
+    mReportInterval = memoryBudgetInfo->reportInterval;
+    mFrame = 0;
+
+    vkGetPhysicalDeviceMemoryProperties(mPhysicalDevice, &mMemoryProperties);
+    for (uint32_t i = 0; i < mMemoryProperties.memoryHeapCount; ++i)
+    {
+        mHeaps[i] = Heap();
+        mHeaps[i].size = mMemoryProperties.memoryHeaps[i].size;
+        mHeaps[i].deviceLocal = (mMemoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        mHeaps[i].budget = static_cast<VkDeviceSize>(mHeaps[i].size * FALLBACK_BUDGET_FRACTION);
+    }
+    for (auto& category : mCategories)
+    {
+        category = Category();
+    }
+    mAllocations.clear();
+    mInitialized = true;
+
+    QueryBudget();
+
+    for (uint32_t i = 0; i < mMemoryProperties.memoryHeapCount; ++i)
+    {
+        logger.debug("Memory heap %u: %.1f MB%s, budget %.1f MB.", i, ToMB(mHeaps[i].size), mHeaps[i].deviceLocal ? " device local" : "", ToMB(mHeaps[i].budget));
+    }
+    logger.debug("Memory budget tracking initialized (%s).", mUseBudgetExtension ? "VK_EXT_memory_budget" : "estimated budgets");
+}
+
+void MemoryBudget::Shutdown()
+{
+    if (!mInitialized)
+    {
+        return;
+    }
+
+    Report();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mAllocations.empty())
+    {
+        VkDeviceSize leaked = 0;
+        for (const auto& allocation : mAllocations)
+        {
+            leaked += allocation.second.size;
+        }
+        logger.warn("%u device memory allocations (%.1f MB) were never freed.", static_cast<uint32_t>(mAllocations.size()), ToMB(leaked));
+    }
+    mAllocations.clear();
+    mInitialized = false;
+}
+
+void MemoryBudget::TrackAllocation(VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size, MemoryCategory category)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mInitialized)
+    {
+        return;
+    }
+
+    uint32_t heapIndex = mMemoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    mAllocations[memory] = { heapIndex, size, category };
+
+    Heap& heap = mHeaps[heapIndex];
+    heap.tracked += size;
+    heap.peak = (std::max)(heap.peak, heap.tracked);
+
+    Category& stats = mCategories[category];
+    stats.current += size;
+    stats.peak = (std::max)(stats.peak, stats.current);
+    ++stats.count;
+
+    // a big allocation shouldn't have to wait for the next poll to be noticed.
+    CheckHeap(heapIndex);
+}
+
+void MemoryBudget::TrackFree(VkDeviceMemory memory)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto it = mAllocations.find(memory);
+    if (it == mAllocations.end())
+    {
+        return;
+    }
+
+    const Allocation& allocation = it->second;
+    mHeaps[allocation.heap].tracked -= allocation.size;
+    mCategories[allocation.category].current -= allocation.size;
+    --mCategories[allocation.category].count;
+    mAllocations.erase(it);
+}
+
+void MemoryBudget::Update()
+{
+    if (!mInitialized)
+    {
+        return;
+    }
+
+    ++mFrame;
+    if (mFrame % BUDGET_QUERY_INTERVAL == 0)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        QueryBudget();
+        for (uint32_t i = 0; i < mMemoryProperties.memoryHeapCount; ++i)
+        {
+            CheckHeap(i);
+        }
+    }
+
+    if (mReportInterval != 0 && mFrame % mReportInterval == 0)
+    {
+        Report();
+    }
+}
+
+void MemoryBudget::Report()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    logger.debug("Memory report (frame %llu):", (unsigned long long)mFrame);
+    for (uint32_t i = 0; i < mMemoryProperties.memoryHeapCount; ++i)
+    {
+        const Heap& heap = mHeaps[i];
+        if (mUseBudgetExtension)
+        {
+            logger.debug("  heap %u%s: %.1f MB tracked (peak %.1f), driver usage %.1f MB (peak %.1f), budget %.1f of %.1f MB.",
+                i, heap.deviceLocal ? " device local" : "", ToMB(heap.tracked), ToMB(heap.peak),
+                ToMB(heap.driverUsage), ToMB(heap.peakDriverUsage), ToMB(heap.budget), ToMB(heap.size));
+        }
+        else
+        {
+            logger.debug("  heap %u%s: %.1f MB tracked (peak %.1f), estimated budget %.1f of %.1f MB.",
+                i, heap.deviceLocal ? " device local" : "", ToMB(heap.tracked), ToMB(heap.peak), ToMB(heap.budget), ToMB(heap.size));
+        }
+    }
+    for (uint32_t i = 0; i < MEMORY_CATEGORY_COUNT; ++i)
+    {
+        const Category& category = mCategories[i];
+        if (category.peak == 0)
+        {
+            continue;
+        }
+        logger.debug("  %s: %.1f MB in %u allocations (peak %.1f MB).", categoryNames[i], ToMB(category.current), category.count, ToMB(category.peak));
+    }
+}
+
+VkDeviceSize MemoryBudget::GetPeakDeviceLocalBytes()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    VkDeviceSize peak = 0;
+    for (uint32_t i = 0; i < mMemoryProperties.memoryHeapCount; ++i)
+    {
+        if (mHeaps[i].deviceLocal)
+        {
+            peak += (std::max)(mHeaps[i].peak, mHeaps[i].peakDriverUsage);
+        }
+    }
+    return peak;
+}
+
+void MemoryBudget::GetDeviceLocalUsage(VkDeviceSize* pUsed, VkDeviceSize* pBudget)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    *pUsed = 0;
+    *pBudget = 0;
+    for (uint32_t i = 0; i < mMemoryProperties.memoryHeapCount; ++i)
+    {
+        if (mHeaps[i].deviceLocal)
+        {
+            *pUsed += (std::max)(mHeaps[i].tracked, mHeaps[i].driverUsage);
+            *pBudget += mHeaps[i].budget;
+        }
+    }
+}
+
+void MemoryBudget::QueryBudget()
+{
+    if (!mUseBudgetExtension)
+    {
+        return;
+    }
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 memoryProperties2 = {};
+    memoryProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    memoryProperties2.pNext = &budgetProperties;
+    vkGetPhysicalDeviceMemoryProperties2(mPhysicalDevice, &memoryProperties2);
+
+    for (uint32_t i = 0; i < mMemoryProperties.memoryHeapCount; ++i)
+    {
+        Heap& heap = mHeaps[i];
+        // drivers are allowed to report 0 for heaps they don't track.
+        if (budgetProperties.heapBudget[i] != 0)
+        {
+            heap.budget = budgetProperties.heapBudget[i];
+        }
+        heap.driverUsage = budgetProperties.heapUsage[i];
+        heap.peakDriverUsage = (std::max)(heap.peakDriverUsage, heap.driverUsage);
+    }
+}
+
+void MemoryBudget::CheckHeap(uint32_t heapIndex)
+{
+    Heap& heap = mHeaps[heapIndex];
+    if (heap.budget == 0)
+    {
+        return;
+    }
+
+    // the driver's number covers allocations we don't make (swapchain, driver internals) but lags by up to a poll.
+    VkDeviceSize usage = (std::max)(heap.tracked, heap.driverUsage);
+    float fraction = static_cast<float>(static_cast<double>(usage) / heap.budget);
+
+    // warn once on nearing the budget and once more on going over it.
+    uint32_t level = fraction >= 1.0f ? 2 : (fraction >= mWarningThreshold ? 1 : 0);
+    if (level > heap.warningLevel)
+    {
+        heap.warningLevel = level;
+        logger.warn("Memory heap %u%s is at %.0f%% of its budget (%.1f of %.1f MB).%s",
+            heapIndex, heap.deviceLocal ? " (device local)" : "", fraction * 100.0f, ToMB(usage), ToMB(heap.budget),
+            level == 2 ? " Over budget, expect paging." : "");
+    }
+    else if (level < heap.warningLevel && fraction < (level == 1 ? 1.0f : mWarningThreshold) - WARNING_HYSTERESIS)
+    {
+        heap.warningLevel = level;
+    }
+}
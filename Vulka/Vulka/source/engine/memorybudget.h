@@ -0,0 +1,112 @@
+#ifndef _MEMORY_BUDGET_H_
+#define _MEMORY_BUDGET_H_
+
+#include "vulkanloader.h"
+#include <mutex>
+#include <unordered_map>
+
+enum MemoryCategory
+{
+    MEMORY_CATEGORY_GEOMETRY,       // vertex and index buffers
+    MEMORY_CATEGORY_RENDER_TARGET,  // render graph attachments
+    MEMORY_CATEGORY_UPLOAD,         // per-frame upload ring
+    MEMORY_CATEGORY_STAGING,        // transfer queue staging ring
+    MEMORY_CATEGORY_OTHER,
+    MEMORY_CATEGORY_COUNT
+};
+
+typedef struct MemoryBudgetInfo {
+    VkPhysicalDevice physicalDevice;
+    bool useBudgetExtension;    // VK_EXT_memory_budget is enabled on the device
+    float warningThreshold;     // fraction of a heap's budget at which to start warning
+    uint32_t reportInterval;    // frames between reports, 0 to only report on Shutdown()
+} MemoryBudgetInfo;
+
+/*
+Accounts for every VkDeviceMemory the engine allocates, per heap and per category, and keeps
+the peaks. With VK_EXT_memory_budget the driver's budget and usage for the whole process are
+polled as well; without it the budget is a fixed share of the heap size and usage is what we
+tracked ourselves.
+
+A heap going past warningThreshold of its budget logs a warning and going over the budget logs
+another; each re-arms once usage drops back below. Past the budget the driver is free to start
+paging to system memory, which shows up as frame spikes long before anything fails.
+
+Allocate and free from any thread. Like the profiler there is one global instance, so the
+engine/ systems can report without a pointer back into Game.
+*/
+class MemoryBudget
+{
+public:
+    void Initialize(MemoryBudgetInfo* memoryBudgetInfo);
+
+    /*
+    Report peaks and anything still allocated. Call after everything has been freed.
+    */
+    void Shutdown();
+
+    void TrackAllocation(VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size, MemoryCategory category);
+    void TrackFree(VkDeviceMemory memory);
+
+    /*
+    Once per frame: polls the driver budget every few frames and reports every reportInterval.
+    */
+    void Update();
+
+    void Report();
+
+    VkDeviceSize GetPeakDeviceLocalBytes();
+
+    /*
+    Current usage and budget summed over the device local heaps. Usage is the driver's figure when
+    it has one, otherwise what we tracked.
+    */
+    void GetDeviceLocalUsage(VkDeviceSize* pUsed, VkDeviceSize* pBudget);
+
+private:
+    struct Allocation
+    {
+        uint32_t heap;
+        VkDeviceSize size;
+        MemoryCategory category;
+    };
+
+    struct Heap
+    {
+        VkDeviceSize size = 0;
+        bool deviceLocal = false;
+        VkDeviceSize budget = 0;
+        VkDeviceSize driverUsage = 0;   // whole process as the driver sees it; 0 without the extension
+        VkDeviceSize tracked = 0;
+        VkDeviceSize peak = 0;
+        VkDeviceSize peakDriverUsage = 0;
+        uint32_t warningLevel = 0;      // 0 fine, 1 past the threshold, 2 over budget
+    };
+
+    struct Category
+    {
+        VkDeviceSize current = 0;
+        VkDeviceSize peak = 0;
+        uint32_t count = 0;
+    };
+
+    void QueryBudget();
+    void CheckHeap(uint32_t heapIndex);
+
+    bool mInitialized = false;
+    VkPhysicalDevice mPhysicalDevice = VK_NULL_HANDLE;
+    bool mUseBudgetExtension = false;
+    float mWarningThreshold = 0.9f;
+    uint32_t mReportInterval = 0;
+    uint64_t mFrame = 0;
+
+    VkPhysicalDeviceMemoryProperties mMemoryProperties = {};
+    Heap mHeaps[VK_MAX_MEMORY_HEAPS];
+    Category mCategories[MEMORY_CATEGORY_COUNT];
+    std::unordered_map<VkDeviceMemory, Allocation> mAllocations;
+    std::mutex mMutex;
+};
+
+extern MemoryBudget memoryBudget;
+
+#endif _MEMORY_BUDGET_H_
@@ -0,0 +1,268 @@
+#include "particlesystem.h"
+#include "logger.h"
+#include "memorybudget.h"
+#include "vkutil.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+static_assert(sizeof(Particle) == 32 && offsetof(Particle, color) == 16 && offsetof(Particle, life) == 28, "Particle has to match the std430 layout in particle.comp");
+
+// a frame that took longer than this (a hitch, a breakpoint) is simulated as if it hadn't.
+const float PARTICLE_MAX_STEP = 0.1f;
+
+void ParticleSystem::Initialize(ParticleSystemInfo* particleSystemInfo)
+{
+    mPhysicalDevice = particleSystemInfo->physicalDevice;
+    mDevice = particleSystemInfo->device;
+    mMaxParticles = particleSystemInfo->maxParticles;
+    mEmitPerSecond = particleSystemInfo->emitPerSecond;
+    mEmitRemainder = 0.0f;
+    mSource = 0;
+    mStateCleared = false;
+
+    // written by the compute shader and read back as per-instance vertex data by the draw. exclusive,
+    // so they're handed between the compute and graphics families rather than shared by both.
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        CreateBuffer(mPhysicalDevice, mDevice, sizeof(Particle) * static_cast<VkDeviceSize>(mMaxParticles), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEMORY_CATEGORY_GEOMETRY, &mParticleBuffers[i], &mParticleMemory[i]);
+    }
+    CreateBuffer(mPhysicalDevice, mDevice, sizeof(State), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEMORY_CATEGORY_GEOMETRY, &mStateBuffer, &mStateMemory);
+
+    // binding 0: this frame's particles. binding 1: where the survivors go. binding 2: State.
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings = {};
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+    if (vkCreateDescriptorSetLayout(mDevice, &layoutInfo, nullptr, &mSetLayout) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to create particle descriptor set layout.");
+    }
+
+    VkDescriptorPoolSize poolSize = {};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = 2 * static_cast<uint32_t>(bindings.size());
+
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = 2;
+    if (vkCreateDescriptorPool(mDevice, &poolInfo, nullptr, &mDescriptorPool) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to create particle descriptor pool.");
+    }
+
+    VkDescriptorSetLayout setLayouts[2] = { mSetLayout, mSetLayout };
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = mDescriptorPool;
+    allocInfo.descriptorSetCount = 2;
+    allocInfo.pSetLayouts = setLayouts;
+    if (vkAllocateDescriptorSets(mDevice, &allocInfo, mDescriptorSets) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to allocate particle descriptor sets.");
+    }
+
+    // set i reads buffer i and writes the other one. the frames alternate between the two.
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        VkDescriptorBufferInfo bufferInfos[3] = {
+            { mParticleBuffers[i], 0, VK_WHOLE_SIZE },
+            { mParticleBuffers[1 - i], 0, VK_WHOLE_SIZE },
+            { mStateBuffer, 0, VK_WHOLE_SIZE }
+        };
+        std::array<VkWriteDescriptorSet, 3> writes = {};
+        for (uint32_t binding = 0; binding < 3; ++binding)
+        {
+            writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[binding].dstSet = mDescriptorSets[i];
+            writes[binding].dstBinding = binding;
+            writes[binding].descriptorCount = 1;
+            writes[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[binding].pBufferInfo = &bufferInfos[binding];
+        }
+        vkUpdateDescriptorSets(mDevice, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+
+    VkPushConstantRange pushConstantRange = {};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(PushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &mSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    if (vkCreatePipelineLayout(mDevice, &pipelineLayoutInfo, nullptr, &mPipelineLayout) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to create particle pipeline layout.");
+    }
+
+    const std::vector<char>& code = *particleSystemInfo->pComputeShaderCode;
+    VkShaderModuleCreateInfo shaderInfo = {};
+    shaderInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shaderInfo.codeSize = code.size();
+    shaderInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(mDevice, &shaderInfo, nullptr, &shaderModule) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to create particle shader module.");
+    }
+    mPreparePipeline = CreatePipeline(shaderModule, true);
+    mSimulatePipeline = CreatePipeline(shaderModule, false);
+    vkDestroyShaderModule(mDevice, shaderModule, nullptr);
+
+    logger.debug("Particle system created. %u particles max, %.0f emitted per second.", mMaxParticles, mEmitPerSecond);
+}
+
+void ParticleSystem::Shutdown()
+{
+    if (mDevice == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    vkDestroyPipeline(mDevice, mPreparePipeline, nullptr);
+    vkDestroyPipeline(mDevice, mSimulatePipeline, nullptr);
+    vkDestroyPipelineLayout(mDevice, mPipelineLayout, nullptr);
+    vkDestroyDescriptorPool(mDevice, mDescriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(mDevice, mSetLayout, nullptr);
+
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        vkDestroyBuffer(mDevice, mParticleBuffers[i], nullptr);
+        memoryBudget.TrackFree(mParticleMemory[i]);
+        vkFreeMemory(mDevice, mParticleMemory[i], nullptr);
+    }
+    vkDestroyBuffer(mDevice, mStateBuffer, nullptr);
+    memoryBudget.TrackFree(mStateMemory);
+    vkFreeMemory(mDevice, mStateMemory, nullptr);
+
+    mDevice = VK_NULL_HANDLE;
+}
+
+void ParticleSystem::Clear(VkCommandBuffer commandBuffer)
+{
+    if (!mStateCleared)
+    {
+        vkCmdFillBuffer(commandBuffer, mStateBuffer, 0, VK_WHOLE_SIZE, 0);
+        mStateCleared = true;
+    }
+}
+
+void ParticleSystem::Prepare(VkCommandBuffer commandBuffer, float deltaSeconds, float timeSeconds)
+{
+    deltaSeconds = (std::min)((std::max)(deltaSeconds, 0.0f), PARTICLE_MAX_STEP);
+
+    // the only thing the cpu decides is how many to try to emit. whether there's room is up to the gpu.
+    float emit = mEmitPerSecond * deltaSeconds + mEmitRemainder;
+    float emitWhole = std::floor(emit);
+    mEmitRemainder = emit - emitWhole;
+
+    mPushConstants = {};
+    mPushConstants.deltaSeconds = deltaSeconds;
+    mPushConstants.timeSeconds = timeSeconds;
+    mPushConstants.emitCount = static_cast<uint32_t>((std::min)(emitWhole, static_cast<float>(mMaxParticles)));
+    mPushConstants.maxParticles = mMaxParticles;
+    mPushConstants.source = mSource;
+
+    // one invocation sizes the simulation from last frame's survivors and resets the output count.
+    Bind(commandBuffer, mPreparePipeline);
+    vkCmdDispatch(commandBuffer, 1, 1, 1);
+}
+
+void ParticleSystem::Simulate(VkCommandBuffer commandBuffer)
+{
+    Bind(commandBuffer, mSimulatePipeline);
+    vkCmdDispatchIndirect(commandBuffer, mStateBuffer, offsetof(State, simulate));
+
+    // the survivors are next frame's input.
+    mSource = 1 - mSource;
+}
+
+void ParticleSystem::Draw(VkCommandBuffer commandBuffer)
+{
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mParticleBuffers[mSource], &offset);
+    vkCmdDrawIndirect(commandBuffer, mStateBuffer, offsetof(State, draws) + sizeof(VkDrawIndirectCommand) * mSource, 1, sizeof(VkDrawIndirectCommand));
+}
+
+void ParticleSystem::Bind(VkCommandBuffer commandBuffer, VkPipeline pipeline)
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1, &mDescriptorSets[mPushConstants.source], 0, nullptr);
+    vkCmdPushConstants(commandBuffer, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(mPushConstants), &mPushConstants);
+}
+
+VkVertexInputBindingDescription ParticleSystem::GetBindingDescription()
+{
+    VkVertexInputBindingDescription bindingDescription = {};
+    bindingDescription.binding = 0;
+    bindingDescription.stride = sizeof(Particle);
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    return bindingDescription;
+}
+
+std::array<VkVertexInputAttributeDescription, 3> ParticleSystem::GetAttributeDescriptions()
+{
+    std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions = {};
+    attributeDescriptions[0].binding = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
+    attributeDescriptions[0].offset = offsetof(Particle, position);
+
+    attributeDescriptions[1].binding = 0;
+    attributeDescriptions[1].location = 1;
+    attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescriptions[1].offset = offsetof(Particle, color);
+
+    attributeDescriptions[2].binding = 0;
+    attributeDescriptions[2].location = 2;
+    attributeDescriptions[2].format = VK_FORMAT_R32_SFLOAT;
+    attributeDescriptions[2].offset = offsetof(Particle, life);
+    return attributeDescriptions;
+}
+
+VkPipeline ParticleSystem::CreatePipeline(VkShaderModule shaderModule, bool prepare)
+{
+    // the two steps are the same shader specialized on PREPARE (constant_id 0).
+    VkSpecializationMapEntry entry = { 0, 0, sizeof(VkBool32) };
+    VkBool32 prepareValue = prepare ? VK_TRUE : VK_FALSE;
+    VkSpecializationInfo specializationInfo = {};
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &entry;
+    specializationInfo.dataSize = sizeof(prepareValue);
+    specializationInfo.pData = &prepareValue;
+
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.stage.pSpecializationInfo = &specializationInfo;
+    pipelineInfo.layout = mPipelineLayout;
+    pipelineInfo.basePipelineIndex = -1;
+
+    VkPipeline pipeline;
+    if (vkCreateComputePipelines(mDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to create particle %s pipeline.", prepare ? "prepare" : "simulate");
+    }
+    return pipeline;
+}
@@ -0,0 +1,123 @@
+#ifndef _PARTICLE_SYSTEM_H_
+#define _PARTICLE_SYSTEM_H_
+
+#include "vulkanloader.h"
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+typedef struct ParticleSystemInfo {
+    VkPhysicalDevice physicalDevice;
+    VkDevice device;
+    uint32_t maxParticles;                      // live at once. emission stops while the buffer is full
+    float emitPerSecond;
+    const std::vector<char>* pComputeShaderCode; // particle.comp, spir-v
+} ParticleSystemInfo;
+
+// one particle, laid out as particle.comp stores it (std430) and particle.vert reads it (per instance).
+typedef struct Particle {
+    glm::vec2 position;
+    glm::vec2 velocity;
+    glm::vec3 color;
+    float life;                                 // seconds left
+} Particle;
+
+// quads are expanded in the vertex shader, one instance per particle.
+const uint32_t PARTICLE_VERTEX_COUNT = 6;
+// local_size_x in particle.comp. simulate dispatches one row of these, one invocation per particle.
+const uint32_t PARTICLE_WORKGROUP_SIZE = 64;
+// the smallest maxComputeWorkGroupCount[0] a device may report, so one dispatch can always reach every particle.
+const uint32_t PARTICLE_MAX_COUNT = 65535 * PARTICLE_WORKGROUP_SIZE;
+
+/*
+Particles that live entirely on the gpu. Emission, integration and death run in a compute shader
+over a persistent device local buffer, and the survivors are compacted into a second buffer that
+becomes the next frame's input. The number of survivors only ever exists on the gpu: it's written
+straight into the draw's indirect arguments, so nothing is read back and a million particles cost
+gpu time only.
+
+Every frame, each step in a render graph pass that declares the buffers it touches:
+    Clear(computeCommandBuffer);        transfer write of the state buffer, only the first time
+    Prepare(computeCommandBuffer, ...); compute write of the state buffer
+    Simulate(computeCommandBuffer);     reads the state buffer as dispatch arguments and writes it,
+                                        reads the source buffer and writes the destination buffer
+    Draw(commandBuffer);                inside a render pass, with a pipeline built from GetBindingDescription().
+                                        reads the (new) source buffer as vertices and the state buffer as draw arguments
+
+Simulate() swaps source and destination, so the getters have to be asked again after it. The
+simulation runs on the async compute queue: the graphics submit waits on the compute submit, and
+the next compute submit on the graphics one, since the simulation overwrites what the previous draw
+read. The buffers are exclusive, so the graphs hand them between the two queue families.
+*/
+class ParticleSystem
+{
+public:
+    void Initialize(ParticleSystemInfo* particleSystemInfo);
+    // the device must be idle.
+    void Shutdown();
+
+    // both buffers start out empty. does nothing after the first frame.
+    void Clear(VkCommandBuffer commandBuffer);
+    // decide how many to emit and size the simulation from last frame's survivors.
+    void Prepare(VkCommandBuffer commandBuffer, float deltaSeconds, float timeSeconds);
+    /*
+    Emit, integrate, kill and compact. Leaves the live particles and their draw arguments ready for Draw().
+    */
+    void Simulate(VkCommandBuffer commandBuffer);
+    void Draw(VkCommandBuffer commandBuffer);
+
+    VkBuffer GetSourceBuffer() const { return mParticleBuffers[mSource]; }
+    VkBuffer GetDestinationBuffer() const { return mParticleBuffers[1 - mSource]; }
+    VkBuffer GetStateBuffer() const { return mStateBuffer; }
+
+    static VkVertexInputBindingDescription GetBindingDescription();
+    static std::array<VkVertexInputAttributeDescription, 3> GetAttributeDescriptions();
+
+    uint32_t GetMaxParticles() const { return mMaxParticles; }
+
+private:
+    // mirrors the State block in particle.comp.
+    struct State
+    {
+        VkDrawIndirectCommand draws[2];         // instanceCount is how many particles each buffer holds
+        VkDispatchIndirectCommand simulate;
+        uint32_t simulateCount;                 // survivors to update plus particles to emit
+        uint32_t aliveCount;                    // particles in this frame's input
+    };
+
+    struct PushConstants
+    {
+        float deltaSeconds;
+        float timeSeconds;
+        uint32_t emitCount;
+        uint32_t maxParticles;
+        uint32_t source;                        // which buffer (and draws[] entry) is this frame's input
+    };
+
+    VkPipeline CreatePipeline(VkShaderModule shaderModule, bool prepare);
+    void Bind(VkCommandBuffer commandBuffer, VkPipeline pipeline);
+
+    VkPhysicalDevice mPhysicalDevice = VK_NULL_HANDLE;
+    VkDevice mDevice = VK_NULL_HANDLE;
+    uint32_t mMaxParticles = 0;
+    float mEmitPerSecond = 0.0f;
+    float mEmitRemainder = 0.0f;                // fraction of a particle carried to the next frame
+
+    VkBuffer mParticleBuffers[2] = {};
+    VkDeviceMemory mParticleMemory[2] = {};
+    VkBuffer mStateBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory mStateMemory = VK_NULL_HANDLE;
+    uint32_t mSource = 0;
+    bool mStateCleared = false;
+    PushConstants mPushConstants = {};          // from Prepare(), for both dispatches
+
+    VkDescriptorSetLayout mSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet mDescriptorSets[2] = {};    // one per source buffer
+    VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline mPreparePipeline = VK_NULL_HANDLE;
+    VkPipeline mSimulatePipeline = VK_NULL_HANDLE;
+};
+
+#endif _PARTICLE_SYSTEM_H_
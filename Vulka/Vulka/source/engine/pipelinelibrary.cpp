@@ -0,0 +1,143 @@
+#include "pipelinelibrary.h"
+#include "logger.h"
+#include "profiler.h"
+
+#include <chrono>
+
+static const VkGraphicsPipelineLibraryFlagsEXT PART_FLAGS[PIPELINE_LIBRARY_PART_COUNT] = {
+    VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT
+};
+
+static const char* PART_NAMES[PIPELINE_LIBRARY_PART_COUNT] = {
+    "vertex input",
+    "pre-rasterization",
+    "fragment shader",
+    "fragment output"
+};
+
+void PipelineLibrary::Initialize(PipelineLibraryInfo* pipelineLibraryInfo)
+{
+    mDevice = pipelineLibraryInfo->device;
+    mLinkCount = 0;
+    mLinkMs = 0.0;
+    mPartMs = 0.0;
+}
+
+void PipelineLibrary::Shutdown()
+{
+    if (mLinkCount > 0)
+    {
+        logger.debug("Pipeline library: %u pipelines linked, %.1f us per link. Parts took %.2f ms to compile.", mLinkCount, mLinkMs * 1000.0 / mLinkCount, mPartMs);
+    }
+    Clear();
+    mDevice = VK_NULL_HANDLE;
+}
+
+VkPipeline PipelineLibrary::Create(const VkGraphicsPipelineCreateInfo& pipelineInfo, const uint32_t partKeys[PIPELINE_LIBRARY_PART_COUNT])
+{
+    VkPipeline libraries[PIPELINE_LIBRARY_PART_COUNT];
+    for (uint32_t part = 0; part < PIPELINE_LIBRARY_PART_COUNT; ++part)
+    {
+        libraries[part] = GetPart(static_cast<PipelineLibraryPart>(part), partKeys[part], pipelineInfo);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    VkPipelineLibraryCreateInfoKHR libraryInfo = {};
+    libraryInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+    libraryInfo.libraryCount = PIPELINE_LIBRARY_PART_COUNT;
+    libraryInfo.pLibraries = libraries;
+
+    // no VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT: a fast link is the whole point.
+    VkGraphicsPipelineCreateInfo linkInfo = {};
+    linkInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    linkInfo.pNext = &libraryInfo;
+    linkInfo.layout = pipelineInfo.layout;
+    linkInfo.basePipelineIndex = -1;
+
+    VkPipeline pipeline;
+    if (vkCreateGraphicsPipelines(mDevice, VK_NULL_HANDLE, 1, &linkInfo, nullptr, &pipeline) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to link pipeline from libraries.");
+    }
+
+    mLinkMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ++mLinkCount;
+    return pipeline;
+}
+
+void PipelineLibrary::Clear()
+{
+    for (auto& parts : mParts)
+    {
+        for (auto& part : parts)
+        {
+            vkDestroyPipeline(mDevice, part.second, nullptr);
+        }
+        parts.clear();
+    }
+}
+
+uint32_t PipelineLibrary::GetPartCount() const
+{
+    size_t count = 0;
+    for (const auto& parts : mParts)
+    {
+        count += parts.size();
+    }
+    return static_cast<uint32_t>(count);
+}
+
+VkPipeline PipelineLibrary::GetPart(PipelineLibraryPart part, uint32_t key, const VkGraphicsPipelineCreateInfo& pipelineInfo)
+{
+    auto it = mParts[part].find(key);
+    if (it != mParts[part].end())
+    {
+        return it->second;
+    }
+
+    PROFILE_ZONE(PART_NAMES[part]);
+    auto start = std::chrono::steady_clock::now();
+
+    // only the stages that belong to this part. the interface parts have none.
+    VkPipelineShaderStageCreateInfo stages[8];
+    uint32_t stageCount = 0;
+    for (uint32_t i = 0; i < pipelineInfo.stageCount && stageCount < 8; ++i)
+    {
+        bool fragment = pipelineInfo.pStages[i].stage == VK_SHADER_STAGE_FRAGMENT_BIT;
+        if ((part == PIPELINE_LIBRARY_PRE_RASTERIZATION && !fragment) || (part == PIPELINE_LIBRARY_FRAGMENT_SHADER && fragment))
+        {
+            stages[stageCount++] = pipelineInfo.pStages[i];
+        }
+    }
+
+    // whatever else the caller chained (dynamic rendering formats) stays behind ours.
+    VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo = {};
+    libraryInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+    libraryInfo.pNext = pipelineInfo.pNext;
+    libraryInfo.flags = PART_FLAGS[part];
+
+    // state outside the part's subset is ignored, so the full create info can go in as is.
+    VkGraphicsPipelineCreateInfo partInfo = pipelineInfo;
+    partInfo.pNext = &libraryInfo;
+    partInfo.flags |= VK_PIPELINE_CREATE_LIBRARY_BIT_KHR;
+    partInfo.stageCount = stageCount;
+    partInfo.pStages = stageCount > 0 ? stages : nullptr;
+    partInfo.basePipelineHandle = VK_NULL_HANDLE;
+    partInfo.basePipelineIndex = -1;
+
+    VkPipeline library;
+    if (vkCreateGraphicsPipelines(mDevice, VK_NULL_HANDLE, 1, &partInfo, nullptr, &library) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to create %s pipeline library.", PART_NAMES[part]);
+    }
+    mParts[part].emplace(key, library);
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    mPartMs += ms;
+    logger.debug("Pipeline library part compiled (%s, key %08x) in %.2f ms.", PART_NAMES[part], key, ms);
+    return library;
+}
@@ -0,0 +1,71 @@
+#ifndef _PIPELINE_LIBRARY_H_
+#define _PIPELINE_LIBRARY_H_
+
+#include "vulkanloader.h"
+#include <cstdint>
+#include <unordered_map>
+
+// the four pieces VK_EXT_graphics_pipeline_library splits a graphics pipeline into.
+enum PipelineLibraryPart
+{
+    PIPELINE_LIBRARY_VERTEX_INPUT,
+    PIPELINE_LIBRARY_PRE_RASTERIZATION,
+    PIPELINE_LIBRARY_FRAGMENT_SHADER,
+    PIPELINE_LIBRARY_FRAGMENT_OUTPUT,
+    PIPELINE_LIBRARY_PART_COUNT
+};
+
+typedef struct PipelineLibraryInfo {
+    VkDevice device;    // with VK_KHR_pipeline_library, VK_EXT_graphics_pipeline_library and its feature enabled
+} PipelineLibraryInfo;
+
+/*
+Graphics pipelines built from separately compiled parts (VK_EXT_graphics_pipeline_library).
+
+Each part is compiled once per distinct key and kept. A pipeline is then a link of four parts,
+which skips link time optimization and costs microseconds instead of the milliseconds of a
+monolithic vkCreateGraphicsPipelines. The price is slightly less optimized code, since the
+shaders were compiled without knowing their neighbours.
+
+Not thread safe, same as PipelineVariants.
+*/
+class PipelineLibrary
+{
+public:
+    void Initialize(PipelineLibraryInfo* pipelineLibraryInfo);
+    // destroys every part.
+    void Shutdown();
+
+    /*
+    Build the pipeline pipelineInfo describes, compiling only the parts whose key hasn't been
+    seen yet. pipelineInfo is an ordinary monolithic create info, pNext chain included; each part
+    takes the state it needs from it. partKeys[part] has to change whenever that part's state does:
+        vertex input:       vertex input and input assembly
+        pre-rasterization:  vertex stage (and its constants), viewport, rasterization, layout
+        fragment shader:    fragment stage (and its constants), depth stencil, multisample, layout
+        fragment output:    color blend, multisample
+    The render pass or attachment formats aren't in any key; Clear() when they change.
+    */
+    VkPipeline Create(const VkGraphicsPipelineCreateInfo& pipelineInfo, const uint32_t partKeys[PIPELINE_LIBRARY_PART_COUNT]);
+
+    /*
+    Destroy every part. Pipelines already linked from them don't need them anymore.
+    */
+    void Clear();
+
+    uint32_t GetPartCount() const;
+    uint32_t GetLinkCount() const { return mLinkCount; }
+    double GetLinkMs() const { return mLinkMs; }
+
+private:
+    VkPipeline GetPart(PipelineLibraryPart part, uint32_t key, const VkGraphicsPipelineCreateInfo& pipelineInfo);
+
+    VkDevice mDevice = VK_NULL_HANDLE;
+    std::unordered_map<uint32_t, VkPipeline> mParts[PIPELINE_LIBRARY_PART_COUNT];
+
+    uint32_t mLinkCount = 0;
+    double mLinkMs = 0.0;       // all links together
+    double mPartMs = 0.0;       // all part compiles together
+};
+
+#endif _PIPELINE_LIBRARY_H_
@@ -0,0 +1,151 @@
+#include "pipelinevariants.h"
+#include "logger.h"
+#include "profiler.h"
+
+#include <chrono>
+
+void PipelineVariants::Initialize(PipelineVariantsInfo* pipelineVariantsInfo)
+{
+    mFields = pipelineVariantsInfo->fields;
+    mCreate = pipelineVariantsInfo->create;
+    mDestroy = pipelineVariantsInfo->destroy;
+    if (mFields.size() > PIPELINE_VARIANT_MAX_FIELDS)
+    {
+        logger.throw_error("too many pipeline variant fields (%u, at most %u).", static_cast<uint32_t>(mFields.size()), PIPELINE_VARIANT_MAX_FIELDS);
+    }
+
+    uint32_t offset = 0;
+    mDefaultKey = 0;
+    for (uint32_t i = 0, count = static_cast<uint32_t>(mFields.size()); i < count; ++i)
+    {
+        mOffsets[i] = offset;
+        offset += mFields[i].bits;
+        if (mFields[i].bits == 0 || offset > 32)
+        {
+            logger.throw_error("pipeline variant field '%s' doesn't fit in the key.", mFields[i].name);
+        }
+        mDefaultKey = With(mDefaultKey, i, mFields[i].defaultValue);
+    }
+
+    mPrebuilt = false;
+    mMissCount = 0;
+}
+
+void PipelineVariants::Shutdown()
+{
+    Clear();
+    mFields.clear();
+    mCreate = nullptr;
+    mDestroy = nullptr;
+}
+
+PipelineVariantKey PipelineVariants::With(PipelineVariantKey key, uint32_t field, uint32_t value) const
+{
+    uint32_t bits = mFields[field].bits;
+    uint32_t mask = bits == 32 ? 0xffffffff : (1u << bits) - 1;
+    if (value > mask)
+    {
+        logger.warn("Pipeline variant field '%s' can't hold %u; clamped to %u.", mFields[field].name, value, mask);
+        value = mask;
+    }
+    return (key & ~(mask << mOffsets[field])) | (value << mOffsets[field]);
+}
+
+uint32_t PipelineVariants::GetField(PipelineVariantKey key, uint32_t field) const
+{
+    uint32_t bits = mFields[field].bits;
+    uint32_t mask = bits == 32 ? 0xffffffff : (1u << bits) - 1;
+    return (key >> mOffsets[field]) & mask;
+}
+
+VkPipeline PipelineVariants::Get(PipelineVariantKey key)
+{
+    auto it = mPipelines.find(key);
+    if (it != mPipelines.end())
+    {
+        return it->second;
+    }
+
+    if (mPrebuilt)
+    {
+        ++mMissCount;
+        logger.warn("Pipeline variant (%s) wasn't prebuilt; creating it now.", Describe(key).c_str());
+    }
+    return Create(key);
+}
+
+void PipelineVariants::Prebuild(const std::vector<PipelineVariantKey>& keys)
+{
+    PROFILE_FUNCTION();
+    auto start = std::chrono::steady_clock::now();
+    uint32_t created = 0;
+    for (PipelineVariantKey key : keys)
+    {
+        if (mPipelines.find(key) == mPipelines.end())
+        {
+            Create(key);
+            ++created;
+        }
+    }
+    mPrebuilt = true;
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    logger.debug("Prebuilt %u pipeline variants in %.2f ms.", created, ms);
+}
+
+void PipelineVariants::Clear()
+{
+    for (auto& pipeline : mPipelines)
+    {
+        mDestroy(pipeline.second);
+    }
+    mPipelines.clear();
+    mPrebuilt = false;
+}
+
+std::string PipelineVariants::Describe(PipelineVariantKey key) const
+{
+    std::string description;
+    for (uint32_t i = 0, count = static_cast<uint32_t>(mFields.size()); i < count; ++i)
+    {
+        if (i != 0)
+        {
+            description += " ";
+        }
+        description += mFields[i].name;
+        description += "=";
+        description += std::to_string(GetField(key, i));
+    }
+    return description;
+}
+
+VkPipeline PipelineVariants::Create(PipelineVariantKey key)
+{
+    // one 32-bit slot per constant field; bools are VkBool32 in the shader, which is the same size.
+    VkSpecializationMapEntry entries[PIPELINE_VARIANT_MAX_FIELDS];
+    uint32_t values[PIPELINE_VARIANT_MAX_FIELDS];
+    uint32_t entryCount = 0;
+    for (uint32_t i = 0, count = static_cast<uint32_t>(mFields.size()); i < count; ++i)
+    {
+        if (mFields[i].constantId == PIPELINE_VARIANT_NO_CONSTANT)
+        {
+            continue;
+        }
+        entries[entryCount].constantID = mFields[i].constantId;
+        entries[entryCount].offset = entryCount * sizeof(uint32_t);
+        entries[entryCount].size = sizeof(uint32_t);
+        values[entryCount] = GetField(key, i);
+        ++entryCount;
+    }
+
+    VkSpecializationInfo specializationInfo = {};
+    specializationInfo.mapEntryCount = entryCount;
+    specializationInfo.pMapEntries = entries;
+    specializationInfo.dataSize = entryCount * sizeof(uint32_t);
+    specializationInfo.pData = values;
+
+    VkPipeline pipeline = mCreate(key, &specializationInfo);
+    mPipelines.emplace(key, pipeline);
+    logger.debug("Pipeline variant created (%s).", Describe(key).c_str());
+    return pipeline;
+}
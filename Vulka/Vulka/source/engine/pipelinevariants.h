@@ -0,0 +1,92 @@
+#ifndef _PIPELINE_VARIANTS_H_
+#define _PIPELINE_VARIANTS_H_
+
+#include "vulkanloader.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// every choice a variant makes, bit-packed. fields are laid out in the order they were declared.
+typedef uint32_t PipelineVariantKey;
+
+// for fields that select fixed function state rather than feed a shader constant.
+const uint32_t PIPELINE_VARIANT_NO_CONSTANT = 0xffffffff;
+const uint32_t PIPELINE_VARIANT_MAX_FIELDS = 8;
+
+typedef struct PipelineVariantField {
+    const char* name;
+    uint32_t bits;              // width in the key. values have to fit
+    uint32_t constantId;        // layout(constant_id = N) in the shaders, or PIPELINE_VARIANT_NO_CONSTANT
+    uint32_t defaultValue;
+} PipelineVariantField;
+
+typedef struct PipelineVariantsInfo {
+    std::vector<PipelineVariantField> fields;
+    /*
+    Build the pipeline for key. pSpecialization holds every constant field as a 32-bit value and
+    is meant for every shader stage; a stage that doesn't declare a constant ignores it.
+    */
+    std::function<VkPipeline(PipelineVariantKey key, const VkSpecializationInfo* pSpecialization)> create;
+    std::function<void(VkPipeline pipeline)> destroy;
+} PipelineVariantsInfo;
+
+/*
+Pipelines keyed by a compact variant key and created on first use. Shaders declare their
+switches (feature toggles, counts) as specialization constants, so each variant gets code
+compiled for exactly its values instead of branching on a uniform at runtime.
+
+Creating a pipeline can take milliseconds, so variants known to be needed are meant to be
+built by Prebuild() at startup. A variant first asked for after that is still created, but
+logged, because it cost a hitch.
+
+Not thread safe: create, look up and clear from one thread at a time.
+*/
+class PipelineVariants
+{
+public:
+    void Initialize(PipelineVariantsInfo* pipelineVariantsInfo);
+    // destroys every variant.
+    void Shutdown();
+
+    PipelineVariantKey GetDefaultKey() const { return mDefaultKey; }
+    PipelineVariantKey With(PipelineVariantKey key, uint32_t field, uint32_t value) const;
+    uint32_t GetField(PipelineVariantKey key, uint32_t field) const;
+
+    /*
+    The pipeline for key, created now if it doesn't exist yet.
+    */
+    VkPipeline Get(PipelineVariantKey key);
+
+    /*
+    Create the variants that aren't there yet. Later first uses of a variant get logged as misses.
+    */
+    void Prebuild(const std::vector<PipelineVariantKey>& keys);
+
+    /*
+    Destroy every variant, for when something they were all built against (render pass,
+    attachment formats) is replaced. The next Prebuild() starts a new startup window.
+    */
+    void Clear();
+
+    uint32_t GetCount() const { return static_cast<uint32_t>(mPipelines.size()); }
+    uint32_t GetMissCount() const { return mMissCount; }
+    // "name=value ..." for logging.
+    std::string Describe(PipelineVariantKey key) const;
+
+private:
+    VkPipeline Create(PipelineVariantKey key);
+
+    std::vector<PipelineVariantField> mFields;
+    uint32_t mOffsets[PIPELINE_VARIANT_MAX_FIELDS] = {};
+    PipelineVariantKey mDefaultKey = 0;
+    std::function<VkPipeline(PipelineVariantKey, const VkSpecializationInfo*)> mCreate;
+    std::function<void(VkPipeline)> mDestroy;
+
+    std::unordered_map<PipelineVariantKey, VkPipeline> mPipelines;
+    bool mPrebuilt = false;
+    uint32_t mMissCount = 0;
+};
+
+#endif _PIPELINE_VARIANTS_H_
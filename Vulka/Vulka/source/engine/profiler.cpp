@@ -0,0 +1,354 @@
+#include "profiler.h"
+#include "logger.h"
+
+#include <chrono>
+#include <cstdio>
+
+Profiler profiler;
+
+int64_t Profiler::Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::Initialize(ProfilerInfo* profilerInfo)
+{
+    mOutputPath = profilerInfo->outputPath;
+    mMaxEventsPerThread = profilerInfo->maxEventsPerThread;
+    mEpochNs = Now();
+    mEnabled.store(true);
+
+    logger.debug("Profiler initialized. Trace goes to %s.", mOutputPath.c_str());
+}
+
+void Profiler::Shutdown()
+{
+    if (!IsEnabled())
+    {
+        return;
+    }
+    mEnabled.store(false);
+
+    FILE* file = nullptr;
+    if (fopen_s(&file, mOutputPath.c_str(), "w") != 0 || file == nullptr)
+    {
+        logger.error("Couldn't write the profiler trace to %s.", mOutputPath.c_str());
+        return;
+    }
+
+    // pid 1 is the cpu with one track per thread, pid 2 the gpu queue.
+    // names are code literals, so they're written without escaping.
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"GPU\"}},\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":2,\"tid\":0,\"args\":{\"name\":\"graphics queue\"}}");
+
+    size_t eventCount = 0;
+    uint64_t dropped = mGpuDropped;
+    auto writeEvents = [&](const std::vector<CpuEvent>& events, uint32_t pid, uint32_t tid)
+    {
+        for (const auto& event : events)
+        {
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                event.name, pid, tid, (event.beginNs - mEpochNs) / 1000.0, (event.endNs - event.beginNs) / 1000.0);
+        }
+        eventCount += events.size();
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(mThreadsMutex);
+        for (auto& thread : mThreads)
+        {
+            std::lock_guard<std::mutex> threadLock(thread->mutex);
+            if (!thread->name.empty())
+            {
+                fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", thread->threadId, thread->name.c_str());
+            }
+            writeEvents(thread->events, 1, thread->threadId);
+            dropped += thread->dropped;
+            thread->events.clear();
+        }
+    }
+    writeEvents(mGpuEvents, 2, 0);
+    mGpuEvents.clear();
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    if (dropped > 0)
+    {
+        logger.warn("Profiler dropped %llu zones. Raise the per-thread or per-frame limits to keep them.", (unsigned long long)dropped);
+    }
+    logger.debug("Profiler trace with %zu zones written to %s.", eventCount, mOutputPath.c_str());
+}
+
+void Profiler::InitializeGpu(ProfilerGpuInfo* profilerGpuInfo)
+{
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(profilerGpuInfo->physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(profilerGpuInfo->physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    uint32_t validBits = queueFamilies[profilerGpuInfo->queueFamilyIndex].timestampValidBits;
+    if (validBits == 0)
+    {
+        logger.warn("The profiled queue doesn't support timestamps. GPU zones and frame times are disabled.");
+        return;
+    }
+    mTimestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(profilerGpuInfo->physicalDevice, &deviceProperties);
+    mTimestampPeriod = deviceProperties.limits.timestampPeriod;
+
+    mDevice = profilerGpuInfo->device;
+    mMaxZonesPerFrame = profilerGpuInfo->maxZonesPerFrame;
+    mGpuFrames.resize(profilerGpuInfo->frameCount);
+
+    VkQueryPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = mMaxZonesPerFrame * 2;
+
+    for (auto& frame : mGpuFrames)
+    {
+        if (vkCreateQueryPool(mDevice, &poolInfo, nullptr, &frame.pool) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create a profiler query pool.");
+        }
+        frame.zones.reserve(mMaxZonesPerFrame);
+    }
+
+    // only the trace needs gpu times on the cpu timeline; the frame time is a plain difference.
+    if (IsEnabled())
+    {
+        Calibrate(profilerGpuInfo->queue, profilerGpuInfo->queueFamilyIndex);
+    }
+
+    logger.debug("Profiler GPU zones initialized (%u frames, %u zones per frame).", profilerGpuInfo->frameCount, mMaxZonesPerFrame);
+}
+
+void Profiler::ShutdownGpu()
+{
+    if (mDevice == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    for (auto& frame : mGpuFrames)
+    {
+        CollectGpuFrame(frame);
+        vkDestroyQueryPool(mDevice, frame.pool, nullptr);
+    }
+    mGpuFrames.clear();
+    mGpuFrame = ~0u;
+    mGpuFrameZone = ~0u;
+    mDevice = VK_NULL_HANDLE;
+}
+
+/*
+Take one timestamp on the queue and note the cpu time around it. Every later gpu timestamp
+is placed on the cpu timeline relative to this one. Good to well under a millisecond, which
+is plenty to see gaps between submits; clock drift over very long runs isn't corrected.
+*/
+void Profiler::Calibrate(VkQueue queue, uint32_t queueFamilyIndex)
+{
+    VkCommandPoolCreateInfo commandPoolInfo = {};
+    commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    commandPoolInfo.queueFamilyIndex = queueFamilyIndex;
+
+    VkCommandPool commandPool;
+    if (vkCreateCommandPool(mDevice, &commandPoolInfo, nullptr, &commandPool) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to create the profiler calibration command pool.");
+    }
+
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    vkAllocateCommandBuffers(mDevice, &allocInfo, &commandBuffer);
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    vkCmdResetQueryPool(commandBuffer, mGpuFrames[0].pool, 0, 1);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mGpuFrames[0].pool, 0);
+    vkEndCommandBuffer(commandBuffer);
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    int64_t before = Now();
+    vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    vkQueueWaitIdle(queue);
+    int64_t after = Now();
+
+    uint64_t ticks = 0;
+    vkGetQueryPoolResults(mDevice, mGpuFrames[0].pool, 0, 1, sizeof(ticks), &ticks, sizeof(ticks), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    mCalibrationTicks = ticks & mTimestampMask;
+    mCalibrationNs = before + (after - before) / 2;
+
+    vkDestroyCommandPool(mDevice, commandPool, nullptr);
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+    ThreadBuffer* buffer = GetThreadBuffer();
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    buffer->name = name;
+}
+
+const char* Profiler::InternName(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(mThreadsMutex);
+    // set nodes never move, so the pointer stays valid for the life of the profiler.
+    return mNames.insert(name).first->c_str();
+}
+
+Profiler::ThreadBuffer* Profiler::GetThreadBuffer()
+{
+    // buffers are never freed, so the cached pointer can't dangle.
+    static thread_local ThreadBuffer* threadBuffer = nullptr;
+    if (threadBuffer == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(mThreadsMutex);
+        mThreads.push_back(std::make_unique<ThreadBuffer>());
+        threadBuffer = mThreads.back().get();
+        threadBuffer->threadId = static_cast<uint32_t>(mThreads.size());
+    }
+    return threadBuffer;
+}
+
+void Profiler::AddCpuZone(const char* name, int64_t beginNs, int64_t endNs)
+{
+    if (!IsEnabled())
+    {
+        return;
+    }
+
+    ThreadBuffer* buffer = GetThreadBuffer();
+    // only contended while the trace is being written.
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    if (buffer->events.size() >= mMaxEventsPerThread)
+    {
+        ++buffer->dropped;
+        return;
+    }
+    buffer->events.push_back({ name, beginNs, endNs });
+}
+
+void Profiler::BeginGpuFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+    if (mDevice == VK_NULL_HANDLE)
+    {
+        mGpuFrame = ~0u;
+        return;
+    }
+
+    GpuFrame& frame = mGpuFrames[frameIndex];
+    CollectGpuFrame(frame);
+
+    vkCmdResetQueryPool(commandBuffer, frame.pool, 0, mMaxZonesPerFrame * 2);
+    mGpuFrame = frameIndex;
+
+    // always zone 0, which is where CollectGpuFrame() looks for the frame time.
+    mGpuFrameZone = 0;
+    frame.zones.push_back({ "frame", false });
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.pool, 0);
+}
+
+void Profiler::EndGpuFrame(VkCommandBuffer commandBuffer)
+{
+    EndGpuZone(commandBuffer, mGpuFrameZone);
+    mGpuFrameZone = ~0u;
+    mGpuFrame = ~0u;
+}
+
+void Profiler::CollectGpuFrame(uint32_t frameIndex)
+{
+    if (mDevice == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    CollectGpuFrame(mGpuFrames[frameIndex]);
+}
+
+uint32_t Profiler::BeginGpuZone(VkCommandBuffer commandBuffer, const char* name)
+{
+    if (mGpuFrame == ~0u || !IsEnabled())
+    {
+        return ~0u;
+    }
+
+    GpuFrame& frame = mGpuFrames[mGpuFrame];
+    if (frame.zones.size() >= mMaxZonesPerFrame)
+    {
+        ++mGpuDropped;
+        return ~0u;
+    }
+
+    uint32_t zone = static_cast<uint32_t>(frame.zones.size());
+    frame.zones.push_back({ name, false });
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.pool, zone * 2);
+    return zone;
+}
+
+void Profiler::EndGpuZone(VkCommandBuffer commandBuffer, uint32_t zone)
+{
+    if (mGpuFrame == ~0u || zone == ~0u)
+    {
+        return;
+    }
+
+    GpuFrame& frame = mGpuFrames[mGpuFrame];
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.pool, zone * 2 + 1);
+    frame.zones[zone].ended = true;
+}
+
+void Profiler::CollectGpuFrame(GpuFrame& frame)
+{
+    if (frame.zones.empty())
+    {
+        return;
+    }
+
+    std::vector<uint64_t> timestamps(frame.zones.size() * 2);
+    VkResult result = vkGetQueryPoolResults(mDevice, frame.pool, 0, static_cast<uint32_t>(timestamps.size()),
+        timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+    // not ready means the frame was never submitted (or a zone was never closed); drop it.
+    if (result == VK_SUCCESS && frame.zones[0].ended)
+    {
+        uint64_t ticks = ((timestamps[1] & mTimestampMask) - (timestamps[0] & mTimestampMask)) & mTimestampMask;
+        mGpuFrameMs = static_cast<double>(ticks) * mTimestampPeriod / 1000000.0;
+    }
+    if (result == VK_SUCCESS && IsEnabled())
+    {
+        for (size_t i = 0, count = frame.zones.size(); i < count; ++i)
+        {
+            if (!frame.zones[i].ended)
+            {
+                continue;
+            }
+            if (mGpuEvents.size() >= mMaxEventsPerThread)
+            {
+                ++mGpuDropped;
+                continue;
+            }
+            int64_t begin = static_cast<int64_t>((timestamps[i * 2] & mTimestampMask) - mCalibrationTicks);
+            int64_t end = static_cast<int64_t>((timestamps[i * 2 + 1] & mTimestampMask) - mCalibrationTicks);
+            mGpuEvents.push_back({ frame.zones[i].name,
+                mCalibrationNs + static_cast<int64_t>(begin * mTimestampPeriod),
+                mCalibrationNs + static_cast<int64_t>(end * mTimestampPeriod) });
+        }
+    }
+    frame.zones.clear();
+}
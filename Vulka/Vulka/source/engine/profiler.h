@@ -0,0 +1,183 @@
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include "vulkanloader.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+typedef struct ProfilerInfo {
+    std::string outputPath;         // chrome trace json, written on Shutdown()
+    uint32_t maxEventsPerThread;    // zones past this are counted and dropped so a long run can't eat all memory
+} ProfilerInfo;
+
+typedef struct ProfilerGpuInfo {
+    VkPhysicalDevice physicalDevice;
+    VkDevice device;
+    VkQueue queue;                  // the queue gpu zones are recorded for; used once to line up gpu and cpu clocks
+    uint32_t queueFamilyIndex;
+    uint32_t frameCount;            // one query pool per frame in flight
+    uint32_t maxZonesPerFrame;
+} ProfilerGpuInfo;
+
+/*
+Scoped cpu and gpu zones written out as a Chrome trace (chrome://tracing, ui.perfetto.dev).
+
+Cpu zones go into a buffer per thread, so recording one is two clock reads and a push_back
+on a lock nobody else takes until export. Gpu zones are timestamp pairs in a query pool per
+frame in flight; a frame's results are read back when its slot comes around again
+(CollectGpuFrame or BeginGpuFrame), which is after the slot's wait, so reading never stalls.
+
+Every gpu frame is wrapped in a "frame" zone. That one is recorded even without a trace,
+since it's where the hud and the benchmark get their gpu frame time from.
+
+Zone names are stored as pointers: use literals, __FUNCTION__ or InternName().
+Everything else is a no-op until Initialize() is called, so the macros can stay in shipping code.
+*/
+class Profiler
+{
+public:
+    void Initialize(ProfilerInfo* profilerInfo);
+
+    /*
+    Write the trace and stop recording. Call after ShutdownGpu().
+    */
+    void Shutdown();
+
+    void InitializeGpu(ProfilerGpuInfo* profilerGpuInfo);
+
+    /*
+    Collect whatever the gpu has finished and destroy the query pools. The device must be idle.
+    */
+    void ShutdownGpu();
+
+    bool IsEnabled() const { return mEnabled.load(std::memory_order_relaxed); }
+
+    void SetThreadName(const char* name);
+    const char* InternName(const std::string& name);
+
+    void AddCpuZone(const char* name, int64_t beginNs, int64_t endNs);
+
+    /*
+    Start recording gpu zones for frame slot frameIndex into commandBuffer. The slot's previous
+    frame must have completed; its zones are collected here if CollectGpuFrame() wasn't called.
+    */
+    void BeginGpuFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+    void EndGpuFrame(VkCommandBuffer commandBuffer);
+    void CollectGpuFrame(uint32_t frameIndex);
+
+    /*
+    Gpu time of the last frame collected, in milliseconds. -1 until one has been read back
+    or when the queue has no timestamps.
+    */
+    double GetGpuFrameMs() const { return mGpuFrameMs; }
+    bool HasGpuTimestamps() const { return mDevice != VK_NULL_HANDLE; }
+    uint32_t BeginGpuZone(VkCommandBuffer commandBuffer, const char* name);
+    void EndGpuZone(VkCommandBuffer commandBuffer, uint32_t zone);
+
+    static int64_t Now();
+
+private:
+    struct CpuEvent
+    {
+        const char* name;
+        int64_t beginNs;
+        int64_t endNs;
+    };
+
+    struct ThreadBuffer
+    {
+        uint32_t threadId = 0;
+        std::string name;
+        std::mutex mutex;
+        std::vector<CpuEvent> events;
+        uint64_t dropped = 0;
+    };
+
+    struct GpuZone
+    {
+        const char* name;
+        bool ended;
+    };
+
+    struct GpuFrame
+    {
+        VkQueryPool pool = VK_NULL_HANDLE;
+        std::vector<GpuZone> zones;
+    };
+
+    ThreadBuffer* GetThreadBuffer();
+    void CollectGpuFrame(GpuFrame& frame);
+    void Calibrate(VkQueue queue, uint32_t queueFamilyIndex);
+
+    std::atomic<bool> mEnabled = { false };
+    std::string mOutputPath;
+    uint32_t mMaxEventsPerThread = 0;
+    int64_t mEpochNs = 0;
+
+    std::mutex mThreadsMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> mThreads;
+    std::set<std::string> mNames;
+
+    VkDevice mDevice = VK_NULL_HANDLE;
+    std::vector<GpuFrame> mGpuFrames;
+    uint32_t mGpuFrame = ~0u;           // slot gpu zones are currently recorded into
+    uint32_t mGpuFrameZone = ~0u;
+    double mGpuFrameMs = -1.0;
+    uint32_t mMaxZonesPerFrame = 0;
+    uint64_t mTimestampMask = 0;
+    double mTimestampPeriod = 1.0;      // nanoseconds per tick
+    uint64_t mCalibrationTicks = 0;     // a gpu timestamp and the cpu time it was taken at
+    int64_t mCalibrationNs = 0;
+    std::vector<CpuEvent> mGpuEvents;
+    uint64_t mGpuDropped = 0;
+};
+
+// one profiler for the whole process, shared by every translation unit.
+extern Profiler profiler;
+
+class ProfileZone
+{
+public:
+    ProfileZone(const char* name) : mName(name), mBeginNs(profiler.IsEnabled() ? Profiler::Now() : -1) {}
+    ~ProfileZone()
+    {
+        if (mBeginNs >= 0)
+        {
+            profiler.AddCpuZone(mName, mBeginNs, Profiler::Now());
+        }
+    }
+
+private:
+    const char* mName;
+    int64_t mBeginNs;
+};
+
+class GpuProfileZone
+{
+public:
+    GpuProfileZone(VkCommandBuffer commandBuffer, const char* name) : mCommandBuffer(commandBuffer), mZone(profiler.BeginGpuZone(commandBuffer, name)) {}
+    ~GpuProfileZone() { profiler.EndGpuZone(mCommandBuffer, mZone); }
+
+private:
+    VkCommandBuffer mCommandBuffer;
+    uint32_t mZone;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifndef VULKA_DISABLE_PROFILER
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__FUNCTION__)
+#define PROFILE_GPU_ZONE(commandBuffer, name) GpuProfileZone PROFILE_CONCAT(gpuProfileZone, __LINE__)(commandBuffer, name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_GPU_ZONE(commandBuffer, name)
+#endif
+
+#endif _PROFILER_H_
@@ -0,0 +1,581 @@
+#include "rendergraph.h"
+#include "logger.h"
+#include "memorybudget.h"
+#include "profiler.h"
+#include "vkutil.h"
+
+#include <algorithm>
+
+// the access bits that produce data. only these need to be made available by a barrier.
+static const VkAccessFlags WRITE_ACCESS_MASK = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+                                             | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+                                             | VK_ACCESS_SHADER_WRITE_BIT
+                                             | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+RenderGraphResource RenderGraph::ImportImage(const char* name, RenderGraphImportInfo* importInfo)
+{
+    Resource resource = {};
+    resource.name = name;
+    resource.imported = true;
+    resource.importInfo = *importInfo;
+    resource.desc.format = importInfo->format;
+    resource.desc.extent = importInfo->extent;
+    resource.desc.samples = VK_SAMPLE_COUNT_1_BIT;
+    resource.desc.aspect = importInfo->aspect;
+    mResources.push_back(resource);
+    return static_cast<RenderGraphResource>(mResources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::ImportBuffer(const char* name, RenderGraphBufferImportInfo* importInfo)
+{
+    Resource resource = {};
+    resource.name = name;
+    resource.imported = true;
+    resource.isBuffer = true;
+    resource.bufferImportInfo = *importInfo;
+    mResources.push_back(resource);
+    return static_cast<RenderGraphResource>(mResources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::CreateImage(const char* name, RenderGraphImageDesc* imageDesc)
+{
+    Resource resource = {};
+    resource.name = name;
+    resource.imported = false;
+    resource.desc = *imageDesc;
+    mResources.push_back(resource);
+    return static_cast<RenderGraphResource>(mResources.size() - 1);
+}
+
+uint32_t RenderGraph::AddPass(const char* name, RenderGraphExecute execute)
+{
+    Pass pass = {};
+    pass.name = name;
+    pass.profileName = profiler.InternName(name);
+    pass.execute = execute;
+    mPasses.push_back(pass);
+    return static_cast<uint32_t>(mPasses.size() - 1);
+}
+
+void RenderGraph::Use(uint32_t pass, RenderGraphResource resource, RenderGraphAccess access)
+{
+    mPasses[pass].uses.push_back({ resource, access });
+}
+
+void RenderGraph::SetSideEffects(uint32_t pass)
+{
+    mPasses[pass].sideEffects = true;
+}
+
+RenderGraph::AccessInfo RenderGraph::GetAccessInfo(RenderGraphAccess access, VkImageAspectFlags aspect)
+{
+    AccessInfo info = {};
+    switch (access)
+    {
+    case RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT:
+        info.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        info.stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        info.access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        info.write = true;
+        break;
+    case RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT:
+        info.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        info.stage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        info.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        info.write = true;
+        break;
+    case RENDER_GRAPH_ACCESS_DEPTH_READ:
+        info.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        info.stage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        info.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+        info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        info.write = false;
+        break;
+    case RENDER_GRAPH_ACCESS_SHADER_READ:
+        info.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        info.stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        info.access = VK_ACCESS_SHADER_READ_BIT;
+        info.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
+        info.write = false;
+        break;
+    case RENDER_GRAPH_ACCESS_TRANSFER_SRC:
+        info.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        info.stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        info.access = VK_ACCESS_TRANSFER_READ_BIT;
+        info.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        info.write = false;
+        break;
+    case RENDER_GRAPH_ACCESS_TRANSFER_DST:
+        info.layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        info.stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        info.access = VK_ACCESS_TRANSFER_WRITE_BIT;
+        info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        info.write = true;
+        break;
+    case RENDER_GRAPH_ACCESS_STORAGE_READ:
+        info.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        info.stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        info.access = VK_ACCESS_SHADER_READ_BIT;
+        info.usage = 0;
+        info.write = false;
+        break;
+    case RENDER_GRAPH_ACCESS_STORAGE_WRITE:
+        info.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        info.stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        info.access = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        info.usage = 0;
+        info.write = true;
+        break;
+    case RENDER_GRAPH_ACCESS_INDIRECT_READ:
+        info.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        info.stage = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+        info.access = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        info.usage = 0;
+        info.write = false;
+        break;
+    case RENDER_GRAPH_ACCESS_VERTEX_READ:
+        info.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        info.stage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        info.access = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+        info.usage = 0;
+        info.write = false;
+        break;
+    }
+    return info;
+}
+
+void RenderGraph::Compile(RenderGraphCompileInfo* compileInfo)
+{
+    mDevice = compileInfo->device;
+    mQueueFamily = compileInfo->queueFamily;
+
+    CullPasses();
+    ComputeLifetimes();
+    CreateTransientImages(compileInfo);
+    BuildBarriers();
+    mCompiled = true;
+
+    uint32_t activeCount = 0;
+    for (const auto& pass : mPasses)
+    {
+        activeCount += pass.active ? 1 : 0;
+    }
+    uint32_t transientCount = 0;
+    for (const auto& resource : mResources)
+    {
+        transientCount += resource.image != VK_NULL_HANDLE && !resource.imported ? 1 : 0;
+    }
+    logger.debug("Render graph compiled. %u of %u passes active, %u transient images.",
+        activeCount, static_cast<uint32_t>(mPasses.size()), transientCount);
+}
+
+void RenderGraph::CullPasses()
+{
+    // walk backwards from the outputs (imported images and buffers). a pass survives if it writes
+    // something a later surviving pass (or the outside world) needs. everything a
+    // surviving pass touches becomes needed in turn; attachments are loaded as well as stored.
+    std::vector<bool> needed(mResources.size(), false);
+    for (size_t i = 0, count = mResources.size(); i < count; ++i)
+    {
+        needed[i] = mResources[i].imported;
+    }
+
+    for (size_t i = mPasses.size(); i-- > 0;)
+    {
+        Pass& pass = mPasses[i];
+        pass.active = pass.sideEffects;
+        for (const auto& use : pass.uses)
+        {
+            if (GetAccessInfo(use.access, mResources[use.resource].desc.aspect).write && needed[use.resource])
+            {
+                pass.active = true;
+            }
+        }
+
+        if (!pass.active)
+        {
+            logger.debug("Render graph culled pass '%s'.", pass.name.c_str());
+            continue;
+        }
+        for (const auto& use : pass.uses)
+        {
+            needed[use.resource] = true;
+        }
+    }
+}
+
+void RenderGraph::ComputeLifetimes()
+{
+    for (uint32_t i = 0, count = static_cast<uint32_t>(mPasses.size()); i < count; ++i)
+    {
+        const Pass& pass = mPasses[i];
+        if (!pass.active)
+        {
+            continue;
+        }
+        for (const auto& use : pass.uses)
+        {
+            Resource& resource = mResources[use.resource];
+            AccessInfo info = GetAccessInfo(use.access, resource.desc.aspect);
+            resource.firstPass = (std::min)(resource.firstPass, i);
+            resource.lastPass = (std::max)(resource.lastPass, i);
+            resource.lastStage = info.stage;
+            resource.lastAccess = info.access;
+            resource.usage |= info.usage;
+        }
+    }
+}
+
+void RenderGraph::CreateTransientImages(RenderGraphCompileInfo* compileInfo)
+{
+    VkDeviceSize allocatedBytes = 0;
+    for (auto& resource : mResources)
+    {
+        if (resource.imported || resource.firstPass == ~0u)
+        {
+            // imported, or only used by culled passes.
+            continue;
+        }
+
+        VkImageUsageFlags usage = resource.usage | resource.desc.extraUsage;
+        if (resource.desc.lazilyAllocated)
+        {
+            usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        }
+
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = resource.desc.format;
+        imageInfo.extent = { resource.desc.extent.width, resource.desc.extent.height, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = resource.desc.samples;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = usage;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (vkCreateImage(mDevice, &imageInfo, nullptr, &resource.image) != VK_SUCCESS)
+        {
+            logger.throw_error("render graph failed to create image '%s'.", resource.name.c_str());
+        }
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(mDevice, resource.image, &requirements);
+
+        uint32_t memoryTypeIndex = 0;
+        bool found = resource.desc.lazilyAllocated && TryFindMemoryType(compileInfo->physicalDevice, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, &memoryTypeIndex);
+        if (!found)
+        {
+            memoryTypeIndex = FindMemoryType(compileInfo->physicalDevice, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        }
+
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = requirements.size;
+        allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+        if (vkAllocateMemory(mDevice, &allocInfo, nullptr, &resource.memory) != VK_SUCCESS)
+        {
+            logger.throw_error("render graph failed to allocate memory for image '%s'.", resource.name.c_str());
+        }
+        memoryBudget.TrackAllocation(resource.memory, memoryTypeIndex, requirements.size, MEMORY_CATEGORY_RENDER_TARGET);
+        allocatedBytes += requirements.size;
+        vkBindImageMemory(mDevice, resource.image, resource.memory, 0);
+
+        VkImageViewCreateInfo viewInfo = {};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = resource.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = resource.desc.format;
+        viewInfo.subresourceRange.aspectMask = resource.desc.aspect;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(mDevice, &viewInfo, nullptr, &resource.view) != VK_SUCCESS)
+        {
+            logger.throw_error("render graph failed to create image view '%s'.", resource.name.c_str());
+        }
+    }
+
+    if (allocatedBytes > 0)
+    {
+        logger.debug("Render graph transient memory: %llu KB.", (unsigned long long)(allocatedBytes / 1024));
+    }
+}
+
+void RenderGraph::BuildBarriers()
+{
+    struct State
+    {
+        VkImageLayout layout;
+        VkPipelineStageFlags writeStage;    // stage of the last write (or whatever we have to wait for first)
+        VkAccessFlags writeAccess;          // write access still to be made available
+        VkPipelineStageFlags readStages;    // stages that read since the last write
+    };
+
+    std::vector<State> states(mResources.size());
+    // imported buffers another queue family hands over until their first use acquires them.
+    std::vector<bool> acquirePending(mResources.size(), false);
+    for (size_t i = 0, count = mResources.size(); i < count; ++i)
+    {
+        const Resource& resource = mResources[i];
+        if (resource.isBuffer)
+        {
+            const RenderGraphBufferImportInfo& importInfo = resource.bufferImportInfo;
+            states[i] = { VK_IMAGE_LAYOUT_UNDEFINED, importInfo.initialStage, 0, 0 };
+            acquirePending[i] = importInfo.acquireFamily != VK_QUEUE_FAMILY_IGNORED && importInfo.acquireFamily != mQueueFamily;
+        }
+        else if (resource.imported)
+        {
+            states[i] = { resource.importInfo.initialLayout, resource.importInfo.initialStage, 0, 0 };
+        }
+        else
+        {
+            // transients start undefined every frame; their contents never survive. with several
+            // frames in flight the previous frame can still be using the image, so wait on its last use.
+            states[i] = { VK_IMAGE_LAYOUT_UNDEFINED, resource.lastStage, resource.lastAccess & WRITE_ACCESS_MASK, 0 };
+        }
+    }
+
+    for (auto& pass : mPasses)
+    {
+        pass.before = BarrierBatch();
+        if (!pass.active)
+        {
+            continue;
+        }
+
+        for (const auto& use : pass.uses)
+        {
+            State& state = states[use.resource];
+            AccessInfo info = GetAccessInfo(use.access, mResources[use.resource].desc.aspect);
+            bool layoutChange = !mResources[use.resource].isBuffer && state.layout != info.layout;
+            bool acquire = acquirePending[use.resource];
+
+            VkPipelineStageFlags srcStages = 0;
+            bool needed = false;
+            if (info.write)
+            {
+                // WAW and WAR both need an execution dependency; only WAW needs the write made available.
+                srcStages = state.writeStage | state.readStages;
+                needed = layoutChange || srcStages != 0;
+            }
+            else
+            {
+                // reading something a previous stage already saw doesn't need another barrier.
+                bool visible = state.writeAccess == 0 || (state.readStages & info.stage) == info.stage;
+                srcStages = state.writeStage | (layoutChange ? state.readStages : 0);
+                needed = layoutChange || !visible;
+            }
+
+            if (needed || acquire)
+            {
+                Barrier barrier = {};
+                barrier.resource = use.resource;
+                barrier.oldLayout = state.layout;
+                barrier.newLayout = info.layout;
+                barrier.srcAccess = state.writeAccess;
+                barrier.dstAccess = info.access;
+                barrier.srcFamily = acquire ? mResources[use.resource].bufferImportInfo.acquireFamily : VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstFamily = acquire ? mQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+                pass.before.barriers.push_back(barrier);
+                acquirePending[use.resource] = false;
+                pass.before.srcStages |= srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+                pass.before.dstStages |= info.stage;
+            }
+
+            state.layout = mResources[use.resource].isBuffer ? state.layout : info.layout;
+            if (info.write)
+            {
+                state.writeStage = info.stage;
+                state.writeAccess = info.access & WRITE_ACCESS_MASK;
+                state.readStages = 0;
+            }
+            else
+            {
+                state.readStages |= info.stage;
+            }
+        }
+    }
+
+    // hand imported images back in the layout the outside world expects, and imported buffers
+    // to the queue family that uses them next.
+    mFinalBarriers = BarrierBatch();
+    for (RenderGraphResource i = 0, count = static_cast<RenderGraphResource>(mResources.size()); i < count; ++i)
+    {
+        const Resource& resource = mResources[i];
+        const State& state = states[i];
+        if (resource.isBuffer)
+        {
+            uint32_t releaseFamily = resource.bufferImportInfo.releaseFamily;
+            if (resource.firstPass == ~0u || releaseFamily == VK_QUEUE_FAMILY_IGNORED || releaseFamily == mQueueFamily)
+            {
+                continue;
+            }
+        }
+        else if (!resource.imported || state.layout == resource.importInfo.finalLayout)
+        {
+            continue;
+        }
+        Barrier barrier = {};
+        barrier.resource = i;
+        barrier.oldLayout = state.layout;
+        barrier.newLayout = resource.isBuffer ? state.layout : resource.importInfo.finalLayout;
+        barrier.srcAccess = state.writeAccess;
+        barrier.dstAccess = 0;
+        barrier.srcFamily = resource.isBuffer ? mQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstFamily = resource.isBuffer ? resource.bufferImportInfo.releaseFamily : VK_QUEUE_FAMILY_IGNORED;
+        mFinalBarriers.barriers.push_back(barrier);
+        VkPipelineStageFlags srcStages = state.writeStage | state.readStages;
+        mFinalBarriers.srcStages |= srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        mFinalBarriers.dstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    }
+}
+
+void RenderGraph::RecordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch)
+{
+    if (batch.barriers.empty())
+    {
+        return;
+    }
+
+    std::vector<VkBufferMemoryBarrier> bufferBarriers;
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    imageBarriers.reserve(batch.barriers.size());
+    for (const auto& barrier : batch.barriers)
+    {
+        const Resource& resource = mResources[barrier.resource];
+
+        if (resource.isBuffer)
+        {
+            // an acquire from a family that hasn't released the buffer yet is just a barrier on this queue.
+            bool transfer = barrier.srcFamily != barrier.dstFamily && (barrier.dstFamily != mQueueFamily || resource.acquire);
+
+            VkBufferMemoryBarrier bufferBarrier = {};
+            bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            bufferBarrier.srcAccessMask = barrier.srcAccess;
+            bufferBarrier.dstAccessMask = barrier.dstAccess;
+            bufferBarrier.srcQueueFamilyIndex = transfer ? barrier.srcFamily : VK_QUEUE_FAMILY_IGNORED;
+            bufferBarrier.dstQueueFamilyIndex = transfer ? barrier.dstFamily : VK_QUEUE_FAMILY_IGNORED;
+            bufferBarrier.buffer = resource.buffer;
+            bufferBarrier.offset = 0;
+            bufferBarrier.size = VK_WHOLE_SIZE;
+            bufferBarriers.push_back(bufferBarrier);
+            continue;
+        }
+
+        VkImageMemoryBarrier imageBarrier = {};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcAccessMask = barrier.srcAccess;
+        imageBarrier.dstAccessMask = barrier.dstAccess;
+        imageBarrier.oldLayout = barrier.oldLayout;
+        imageBarrier.newLayout = barrier.newLayout;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = resource.image;
+        imageBarrier.subresourceRange.aspectMask = resource.desc.aspect;
+        imageBarrier.subresourceRange.baseMipLevel = 0;
+        imageBarrier.subresourceRange.levelCount = 1;
+        imageBarrier.subresourceRange.baseArrayLayer = 0;
+        imageBarrier.subresourceRange.layerCount = 1;
+        imageBarriers.push_back(imageBarrier);
+    }
+
+    vkCmdPipelineBarrier(commandBuffer, batch.srcStages, batch.dstStages, 0, 0, nullptr,
+        static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(), static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+void RenderGraph::Execute(VkCommandBuffer commandBuffer)
+{
+    if (!mCompiled)
+    {
+        logger.throw_error("render graph executed before it was compiled.");
+    }
+
+    for (const auto& pass : mPasses)
+    {
+        if (!pass.active)
+        {
+            continue;
+        }
+        PROFILE_GPU_ZONE(commandBuffer, pass.profileName);
+        RecordBarriers(commandBuffer, pass.before);
+        pass.execute(commandBuffer, *this);
+    }
+    RecordBarriers(commandBuffer, mFinalBarriers);
+}
+
+void RenderGraph::Reset(DeletionQueue* pDeletionQueue)
+{
+    if (mDevice != VK_NULL_HANDLE)
+    {
+        for (auto& resource : mResources)
+        {
+            if (resource.imported || resource.image == VK_NULL_HANDLE)
+            {
+                continue;
+            }
+            if (pDeletionQueue != nullptr)
+            {
+                pDeletionQueue->DestroyImageView(resource.view);
+                pDeletionQueue->DestroyImage(resource.image);
+                pDeletionQueue->FreeMemory(resource.memory);
+            }
+            else
+            {
+                vkDestroyImageView(mDevice, resource.view, nullptr);
+                vkDestroyImage(mDevice, resource.image, nullptr);
+                memoryBudget.TrackFree(resource.memory);
+                vkFreeMemory(mDevice, resource.memory, nullptr);
+            }
+        }
+    }
+
+    mResources.clear();
+    mPasses.clear();
+    mFinalBarriers = BarrierBatch();
+    mCompiled = false;
+}
+
+void RenderGraph::SetImportedImage(RenderGraphResource resource, VkImage image, VkImageView view)
+{
+    mResources[resource].image = image;
+    mResources[resource].view = view;
+}
+
+void RenderGraph::SetImportedBuffer(RenderGraphResource resource, VkBuffer buffer, bool acquire)
+{
+    mResources[resource].buffer = buffer;
+    mResources[resource].acquire = acquire;
+}
+
+VkImage RenderGraph::GetImage(RenderGraphResource resource) const
+{
+    return mResources[resource].image;
+}
+
+VkImageView RenderGraph::GetImageView(RenderGraphResource resource) const
+{
+    return mResources[resource].view;
+}
+
+VkFormat RenderGraph::GetFormat(RenderGraphResource resource) const
+{
+    return mResources[resource].desc.format;
+}
+
+VkExtent2D RenderGraph::GetExtent(RenderGraphResource resource) const
+{
+    return mResources[resource].desc.extent;
+}
+
+bool RenderGraph::IsPassActive(uint32_t pass) const
+{
+    return mPasses[pass].active;
+}
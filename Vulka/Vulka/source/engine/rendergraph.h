@@ -0,0 +1,194 @@
+#ifndef _RENDER_GRAPH_H_
+#define _RENDER_GRAPH_H_
+
+#include "deletionqueue.h"
+#include "vulkanloader.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+typedef uint32_t RenderGraphResource;
+const RenderGraphResource RENDER_GRAPH_INVALID_RESOURCE = ~0u;
+
+/*
+How a pass touches an image or buffer. Each one maps to a layout, pipeline stage and access mask,
+which is everything the graph needs to place barriers. Buffers ignore the layout.
+*/
+enum RenderGraphAccess
+{
+    RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT,       // written (and possibly loaded) as a color or resolve attachment
+    RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT,       // depth test + write
+    RENDER_GRAPH_ACCESS_DEPTH_READ,             // depth test only
+    RENDER_GRAPH_ACCESS_SHADER_READ,            // sampled from a fragment or compute shader
+    RENDER_GRAPH_ACCESS_TRANSFER_SRC,
+    RENDER_GRAPH_ACCESS_TRANSFER_DST,           // copied or filled into, image or buffer
+    RENDER_GRAPH_ACCESS_STORAGE_READ,           // buffer read by a compute shader
+    RENDER_GRAPH_ACCESS_STORAGE_WRITE,          // buffer written (and possibly read) by a compute shader
+    RENDER_GRAPH_ACCESS_INDIRECT_READ,          // buffer holding draw or dispatch arguments
+    RENDER_GRAPH_ACCESS_VERTEX_READ,            // buffer bound as vertex input
+};
+
+typedef struct RenderGraphImageDesc {
+    VkFormat format;
+    VkExtent2D extent;
+    VkSampleCountFlagBits samples;
+    VkImageAspectFlags aspect;
+    VkImageUsageFlags extraUsage;   // on top of what the graph derives from the passes
+    bool lazilyAllocated;           // transient attachment that never needs to reach memory (tilers)
+} RenderGraphImageDesc;
+
+typedef struct RenderGraphImportInfo {
+    VkFormat format;
+    VkExtent2D extent;
+    VkImageAspectFlags aspect;
+    VkImageLayout initialLayout;        // layout the image is in when the frame starts
+    VkPipelineStageFlags initialStage;  // stage whatever made it available waits at (e.g. the acquire semaphore)
+    VkImageLayout finalLayout;          // layout it has to be left in (e.g. PRESENT_SRC)
+} RenderGraphImportInfo;
+
+typedef struct RenderGraphBufferImportInfo {
+    VkPipelineStageFlags initialStage;  // stage whatever made it available waits at (e.g. a semaphore from another queue)
+    uint32_t acquireFamily;             // queue family that releases it to this graph every frame, or VK_QUEUE_FAMILY_IGNORED
+    uint32_t releaseFamily;             // queue family it's released to after its last use, or VK_QUEUE_FAMILY_IGNORED
+} RenderGraphBufferImportInfo;
+
+typedef struct RenderGraphCompileInfo {
+    VkPhysicalDevice physicalDevice;
+    VkDevice device;
+    uint32_t queueFamily;               // family of the queue Execute()'s command buffers go to
+} RenderGraphCompileInfo;
+
+class RenderGraph;
+typedef std::function<void(VkCommandBuffer, const RenderGraph&)> RenderGraphExecute;
+
+/*
+A per-frame graph of passes. Passes declare which images and buffers they read and write and how;
+the graph then:
+  - culls passes whose results never reach an imported resource (or a pass marked with side effects),
+  - derives every layout transition and barrier between passes,
+  - hands imported buffers between queue families, acquiring before the first use and releasing after the last,
+  - creates the transient images.
+
+Build once (AddPass/Use/...), Compile(), then Execute() every frame. Imported images and buffers can
+change every frame (swapchain images, ping-ponged buffers) through SetImportedImage()/SetImportedBuffer().
+Anything that depends on the swapchain (extent, format) means Reset() and build it again.
+
+A graph records into one queue's command buffers. Work on another queue gets a graph of its own,
+with the buffers both touch imported into each.
+*/
+class RenderGraph
+{
+public:
+    RenderGraphResource ImportImage(const char* name, RenderGraphImportInfo* importInfo);
+    RenderGraphResource ImportBuffer(const char* name, RenderGraphBufferImportInfo* importInfo);
+    RenderGraphResource CreateImage(const char* name, RenderGraphImageDesc* imageDesc);
+
+    uint32_t AddPass(const char* name, RenderGraphExecute execute);
+    void Use(uint32_t pass, RenderGraphResource resource, RenderGraphAccess access);
+    void SetSideEffects(uint32_t pass);   // never cull this pass
+
+    void Compile(RenderGraphCompileInfo* compileInfo);
+    void Execute(VkCommandBuffer commandBuffer);
+
+    /*
+    Destroy every transient resource and forget all passes, ready to be built again.
+    With a deletion queue the transients are handed to it instead, so frames still in
+    flight can keep using them.
+    */
+    void Reset(DeletionQueue* pDeletionQueue = nullptr);
+
+    void SetImportedImage(RenderGraphResource resource, VkImage image, VkImageView view);
+    /*
+    acquire is false while the acquire family hasn't released the buffer yet (its first frame);
+    the first barrier then stays within this queue.
+    */
+    void SetImportedBuffer(RenderGraphResource resource, VkBuffer buffer, bool acquire = true);
+
+    VkImage GetImage(RenderGraphResource resource) const;
+    VkImageView GetImageView(RenderGraphResource resource) const;
+    VkFormat GetFormat(RenderGraphResource resource) const;
+    VkExtent2D GetExtent(RenderGraphResource resource) const;
+    bool IsPassActive(uint32_t pass) const;
+
+private:
+    struct AccessInfo
+    {
+        VkImageLayout layout;
+        VkPipelineStageFlags stage;
+        VkAccessFlags access;
+        VkImageUsageFlags usage;
+        bool write;
+    };
+    static AccessInfo GetAccessInfo(RenderGraphAccess access, VkImageAspectFlags aspect);
+
+    struct Resource
+    {
+        std::string name;
+        RenderGraphImageDesc desc;
+        bool imported;
+        bool isBuffer;
+        RenderGraphImportInfo importInfo;
+        RenderGraphBufferImportInfo bufferImportInfo;
+
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        bool acquire = false;
+        VkImageUsageFlags usage = 0;
+        uint32_t firstPass = ~0u;
+        uint32_t lastPass = 0;
+        VkPipelineStageFlags lastStage = 0;
+        VkAccessFlags lastAccess = 0;
+    };
+
+    struct PassUse
+    {
+        RenderGraphResource resource;
+        RenderGraphAccess access;
+    };
+
+    struct Barrier
+    {
+        RenderGraphResource resource;
+        VkImageLayout oldLayout;
+        VkImageLayout newLayout;
+        VkAccessFlags srcAccess;
+        VkAccessFlags dstAccess;
+        uint32_t srcFamily;
+        uint32_t dstFamily;
+    };
+
+    struct BarrierBatch
+    {
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        std::vector<Barrier> barriers;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        const char* profileName = nullptr;  // interned copy of name for gpu zones, which outlive Reset()
+        RenderGraphExecute execute;
+        std::vector<PassUse> uses;
+        bool sideEffects = false;
+        bool active = false;
+        BarrierBatch before;
+    };
+
+    void CullPasses();
+    void ComputeLifetimes();
+    void CreateTransientImages(RenderGraphCompileInfo* compileInfo);
+    void BuildBarriers();
+    void RecordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch);
+
+    VkDevice mDevice = VK_NULL_HANDLE;
+    uint32_t mQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+    std::vector<Resource> mResources;
+    std::vector<Pass> mPasses;
+    BarrierBatch mFinalBarriers;
+    bool mCompiled = false;
+};
+
+#endif _RENDER_GRAPH_H_
@@ -0,0 +1,190 @@
+#include "scenesystems.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+// the largest axis scale keeps the sphere conservative under non-uniform scale.
+static glm::vec4 TransformSphere(const glm::mat4& world, const glm::vec4& local)
+{
+    glm::vec3 center = glm::vec3(world * glm::vec4(glm::vec3(local), 1.0f));
+    float scale = (std::max)(glm::length(glm::vec3(world[0])), (std::max)(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+    return glm::vec4(center, local.w * scale);
+}
+
+void UpdateTransforms(EntityStore& store)
+{
+    PROFILE_FUNCTION();
+    const ComponentMask required = ComponentBit(COMPONENT_TRANSFORM) | ComponentBit(COMPONENT_WORLD_MATRIX);
+    const ComponentMask bounds = ComponentBit(COMPONENT_BOUNDS) | ComponentBit(COMPONENT_WORLD_BOUNDS);
+
+    for (uint32_t a = 0, archetypeCount = store.GetArchetypeCount(); a < archetypeCount; ++a)
+    {
+        Archetype& archetype = store.GetArchetype(a);
+        if (!archetype.Has(required))
+        {
+            continue;
+        }
+
+        const TransformComponent* transforms = archetype.Get<TransformComponent>();
+        WorldMatrixComponent* worldMatrices = archetype.Get<WorldMatrixComponent>();
+        for (uint32_t i = 0, count = archetype.GetCount(); i < count; ++i)
+        {
+            worldMatrices[i].matrix = ComposeTransform(transforms[i]);
+        }
+
+        if (!archetype.Has(bounds))
+        {
+            continue;
+        }
+
+        // separate pass so each loop only streams the columns it needs.
+        const BoundsComponent* localBounds = archetype.Get<BoundsComponent>();
+        WorldBoundsComponent* worldBounds = archetype.Get<WorldBoundsComponent>();
+        for (uint32_t i = 0, count = archetype.GetCount(); i < count; ++i)
+        {
+            worldBounds[i].sphere = TransformSphere(worldMatrices[i].matrix, localBounds[i].sphere);
+        }
+    }
+}
+
+void UpdateHierarchy(TransformHierarchy& hierarchy, EntityStore& store)
+{
+    PROFILE_FUNCTION();
+    hierarchy.Update();
+
+    // only the nodes that were recomputed, so a still scene does no work here.
+    for (const TransformHierarchy::Range& range : hierarchy.GetUpdatedRanges())
+    {
+        for (uint32_t i = range.begin; i < range.end; ++i)
+        {
+            Entity entity = hierarchy.GetEntityAt(i);
+            WorldMatrixComponent* worldMatrix = store.Get<WorldMatrixComponent>(entity);
+            if (worldMatrix == nullptr)
+            {
+                continue;
+            }
+            worldMatrix->matrix = hierarchy.GetWorldAt(i);
+
+            const BoundsComponent* localBounds = store.Get<BoundsComponent>(entity);
+            WorldBoundsComponent* worldBounds = store.Get<WorldBoundsComponent>(entity);
+            if (localBounds != nullptr && worldBounds != nullptr)
+            {
+                worldBounds->sphere = TransformSphere(worldMatrix->matrix, localBounds->sphere);
+            }
+        }
+    }
+}
+
+void CullEntities(EntityStore& store, Culler& culler, const Frustum& frustum, VisibleSet& visible)
+{
+    PROFILE_FUNCTION();
+    visible.rows.resize(store.GetArchetypeCount());
+    visible.visibleCount = 0;
+    visible.testedCount = 0;
+
+    for (uint32_t a = 0, archetypeCount = store.GetArchetypeCount(); a < archetypeCount; ++a)
+    {
+        Archetype& archetype = store.GetArchetype(a);
+        std::vector<uint32_t>& rows = visible.rows[a];
+
+        const WorldBoundsComponent* worldBounds = archetype.Get<WorldBoundsComponent>();
+        uint32_t count = archetype.GetCount();
+        if (worldBounds == nullptr)
+        {
+            // nothing to test against; everything is visible.
+            rows.resize(count);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                rows[i] = i;
+            }
+            visible.visibleCount += count;
+            continue;
+        }
+
+        // the component is just the sphere, so the column can be handed over as is.
+        static_assert(sizeof(WorldBoundsComponent) == sizeof(glm::vec4), "world bounds column must be packed spheres");
+        rows.resize(count);
+        rows.resize(culler.Cull(frustum, &worldBounds[0].sphere, count, rows.data()));
+        visible.testedCount += count;
+        visible.visibleCount += static_cast<uint32_t>(rows.size());
+    }
+}
+
+void BuildDrawList(EntityStore& store, const VisibleSet& visible, DrawList& drawList)
+{
+    PROFILE_FUNCTION();
+    const ComponentMask required = ComponentBit(COMPONENT_MESH) | ComponentBit(COMPONENT_MATERIAL);
+
+    drawList.batches.clear();
+    drawList.instances.clear();
+    drawList.batchLookup.clear();
+    drawList.instanceBatches.clear();
+
+    // count instances per (material, mesh). neighbours usually share a key, so remember the last one.
+    uint64_t lastKey = ~0ull;
+    uint32_t lastBatch = 0;
+    for (uint32_t a = 0, archetypeCount = (std::min)(store.GetArchetypeCount(), static_cast<uint32_t>(visible.rows.size())); a < archetypeCount; ++a)
+    {
+        Archetype& archetype = store.GetArchetype(a);
+        if (!archetype.Has(required))
+        {
+            continue;
+        }
+
+        const MeshComponent* meshes = archetype.Get<MeshComponent>();
+        const MaterialComponent* materials = archetype.Get<MaterialComponent>();
+        for (uint32_t row : visible.rows[a])
+        {
+            uint64_t key = (static_cast<uint64_t>(materials[row].material) << 32) | meshes[row].mesh;
+            if (key != lastKey)
+            {
+                auto it = drawList.batchLookup.find(key);
+                if (it == drawList.batchLookup.end())
+                {
+                    it = drawList.batchLookup.emplace(key, static_cast<uint32_t>(drawList.batches.size())).first;
+                    drawList.batches.push_back({ meshes[row].mesh, materials[row].material, 0, 0 });
+                }
+                lastKey = key;
+                lastBatch = it->second;
+            }
+            ++drawList.batches[lastBatch].instanceCount;
+            drawList.instanceBatches.push_back(lastBatch);
+        }
+    }
+
+    // order batches by material then mesh, and remember where each one went.
+    uint32_t batchCount = static_cast<uint32_t>(drawList.batches.size());
+    std::sort(drawList.batches.begin(), drawList.batches.end(), [](const DrawBatch& a, const DrawBatch& b)
+    {
+        return a.material != b.material ? a.material < b.material : a.mesh < b.mesh;
+    });
+    drawList.batchRemap.resize(batchCount);
+    uint32_t firstInstance = 0;
+    for (uint32_t i = 0; i < batchCount; ++i)
+    {
+        DrawBatch& batch = drawList.batches[i];
+        uint64_t key = (static_cast<uint64_t>(batch.material) << 32) | batch.mesh;
+        drawList.batchRemap[drawList.batchLookup[key]] = i;
+        batch.firstInstance = firstInstance;
+        firstInstance += batch.instanceCount;
+        // refilled by the scatter below.
+        batch.instanceCount = 0;
+    }
+
+    // same walk again, dropping each instance into its batch's range.
+    drawList.instances.resize(firstInstance);
+    uint32_t instance = 0;
+    for (uint32_t a = 0, archetypeCount = (std::min)(store.GetArchetypeCount(), static_cast<uint32_t>(visible.rows.size())); a < archetypeCount; ++a)
+    {
+        if (!store.GetArchetype(a).Has(required))
+        {
+            continue;
+        }
+        for (uint32_t row : visible.rows[a])
+        {
+            DrawBatch& batch = drawList.batches[drawList.batchRemap[drawList.instanceBatches[instance++]]];
+            drawList.instances[batch.firstInstance + batch.instanceCount++] = { a, row };
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef _SCENE_SYSTEMS_H_
+#define _SCENE_SYSTEMS_H_
+
+#include "culling.h"
+#include "entitystore.h"
+#include "transformhierarchy.h"
+#include <unordered_map>
+#include <vector>
+
+/*
+The per-frame systems over the entity store: transforms, culling and the draw list.
+Each one walks whole archetype columns front to back.
+*/
+
+/*
+World matrices from transforms, then world bounding spheres from local ones.
+*/
+void UpdateTransforms(EntityStore& store);
+
+/*
+Hierarchy driven entities carry no TransformComponent, so UpdateTransforms() skips them; their
+world matrices and bounds are written from the hierarchy, and only for nodes it recomputed.
+*/
+void UpdateHierarchy(TransformHierarchy& hierarchy, EntityStore& store);
+
+/*
+Rows that passed culling, per archetype (indexed like EntityStore::GetArchetype()).
+*/
+typedef struct VisibleSet {
+    std::vector<std::vector<uint32_t>> rows;
+    uint32_t visibleCount;
+    uint32_t testedCount;
+} VisibleSet;
+
+/*
+Culls each archetype's world bounds column with culler; rows come out in ascending order.
+*/
+void CullEntities(EntityStore& store, Culler& culler, const Frustum& frustum, VisibleSet& visible);
+
+typedef struct DrawBatch {
+    uint32_t mesh;
+    uint32_t material;
+    uint32_t firstInstance;     // into DrawList::instances
+    uint32_t instanceCount;
+} DrawBatch;
+
+typedef struct DrawInstance {
+    uint32_t archetype;
+    uint32_t row;
+} DrawInstance;
+
+/*
+Visible entities grouped by material, then mesh. Batches are sorted so state changes between
+them are as few as possible; instances are laid out batch by batch.
+*/
+typedef struct DrawList {
+    std::vector<DrawBatch> batches;
+    std::vector<DrawInstance> instances;
+
+    // scratch, kept between frames so building doesn't allocate once it has warmed up.
+    std::unordered_map<uint64_t, uint32_t> batchLookup;
+    std::vector<uint32_t> instanceBatches;
+    std::vector<uint32_t> batchRemap;
+} DrawList;
+
+void BuildDrawList(EntityStore& store, const VisibleSet& visible, DrawList& drawList);
+
+#endif _SCENE_SYSTEMS_H_
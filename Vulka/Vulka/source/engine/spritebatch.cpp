@@ -0,0 +1,142 @@
+#include "spritebatch.h"
+#include "logger.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static uint32_t SpriteKey(const Sprite& sprite)
+{
+    return ((sprite.layer & 0xff) << 24) | ((sprite.pipeline & 0xff) << 16) | (sprite.texture & 0xffff);
+}
+
+void SpriteBatch::Initialize(SpriteBatchInfo* spriteBatchInfo)
+{
+    mMaxSprites = spriteBatchInfo->maxSprites;
+    mSprites.reserve(mMaxSprites);
+    mSpriteRuns.reserve(mMaxSprites);
+}
+
+void SpriteBatch::Shutdown()
+{
+    mSprites.clear();
+    mDraws.clear();
+    mRuns.clear();
+    mRunLookup.clear();
+    mSpriteRuns.clear();
+    mRunRemap.clear();
+    mVertices = {};
+    mBuiltCount = 0;
+}
+
+void SpriteBatch::Clear()
+{
+    mSprites.clear();
+    mDroppedCount = 0;
+}
+
+void SpriteBatch::Add(const Sprite& sprite)
+{
+    if (mSprites.size() >= mMaxSprites)
+    {
+        if (!mWarnedDropped)
+        {
+            logger.warn("Sprite batch is full (%u sprites). Further sprites are dropped.", mMaxSprites);
+            mWarnedDropped = true;
+        }
+        ++mDroppedCount;
+        return;
+    }
+    mSprites.push_back(sprite);
+}
+
+void SpriteBatch::Build(UploadRing& ring)
+{
+    PROFILE_FUNCTION();
+    mDraws.clear();
+    mRuns.clear();
+    mRunLookup.clear();
+    mSpriteRuns.clear();
+    mBuiltCount = static_cast<uint32_t>(mSprites.size());
+    mVertices = {};
+    if (mSprites.empty())
+    {
+        return;
+    }
+
+    // count sprites per key. neighbours usually share a key, so remember the last one.
+    uint32_t lastKey = ~0u;
+    uint32_t lastRun = 0;
+    for (const Sprite& sprite : mSprites)
+    {
+        uint32_t key = SpriteKey(sprite);
+        if (key != lastKey)
+        {
+            auto it = mRunLookup.find(key);
+            if (it == mRunLookup.end())
+            {
+                it = mRunLookup.emplace(key, static_cast<uint32_t>(mRuns.size())).first;
+                mRuns.push_back({ key, 0, 0 });
+            }
+            lastKey = key;
+            lastRun = it->second;
+        }
+        ++mRuns[lastRun].count;
+        mSpriteRuns.push_back(lastRun);
+    }
+
+    // only the distinct keys get sorted. remember where each one went.
+    uint32_t runCount = static_cast<uint32_t>(mRuns.size());
+    std::sort(mRuns.begin(), mRuns.end(), [](const Run& a, const Run& b) { return a.key < b.key; });
+    mRunRemap.resize(runCount);
+    uint32_t first = 0;
+    for (uint32_t i = 0; i < runCount; ++i)
+    {
+        Run& run = mRuns[i];
+        mRunRemap[mRunLookup[run.key]] = i;
+        run.first = first;
+        first += run.count;
+
+        SpriteDraw draw = {};
+        draw.pipeline = (run.key >> 16) & 0xff;
+        draw.texture = run.key & 0xffff;
+        draw.firstVertex = run.first * SPRITE_VERTEX_COUNT;
+        draw.vertexCount = run.count * SPRITE_VERTEX_COUNT;
+        mDraws.push_back(draw);
+
+        // refilled by the scatter below.
+        run.count = 0;
+    }
+
+    mVertices = ring.Allocate(GetVertexBytes(), sizeof(glm::vec4));
+    SpriteVertex* pVertices = static_cast<SpriteVertex*>(mVertices.pData);
+
+    // the ring is usually write-combined memory: build each quad locally and copy it out whole, and never read it back.
+    for (uint32_t i = 0, count = mBuiltCount; i < count; ++i)
+    {
+        const Sprite& sprite = mSprites[i];
+        Run& run = mRuns[mRunRemap[mSpriteRuns[i]]];
+        uint32_t slot = run.first + run.count++;
+
+        float c = std::cos(sprite.rotation);
+        float s = std::sin(sprite.rotation);
+        glm::vec2 axisX = glm::vec2(c, s) * sprite.halfSize.x;
+        glm::vec2 axisY = glm::vec2(-s, c) * sprite.halfSize.y;
+        glm::vec2 topLeft = sprite.position - axisX - axisY;
+        glm::vec2 topRight = sprite.position + axisX - axisY;
+        glm::vec2 bottomRight = sprite.position + axisX + axisY;
+        glm::vec2 bottomLeft = sprite.position - axisX + axisY;
+
+        // clockwise in vulkan's y-down clip space, like the main pipeline's front faces.
+        SpriteVertex quad[SPRITE_VERTEX_COUNT] = {
+            { topLeft, sprite.color },
+            { topRight, sprite.color },
+            { bottomRight, sprite.color },
+            { bottomRight, sprite.color },
+            { bottomLeft, sprite.color },
+            { topLeft, sprite.color }
+        };
+        memcpy(pVertices + static_cast<size_t>(slot) * SPRITE_VERTEX_COUNT, quad, sizeof(quad));
+    }
+}
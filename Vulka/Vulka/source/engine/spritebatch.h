@@ -0,0 +1,103 @@
+#ifndef _SPRITE_BATCH_H_
+#define _SPRITE_BATCH_H_
+
+#include "uploadring.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// same layout as the main pipeline's Vertex, so sprites go through the same vertex input state.
+typedef struct SpriteVertex {
+    glm::vec2 pos;
+    glm::vec3 color;
+} SpriteVertex;
+
+typedef struct Sprite {
+    glm::vec2 position;     // center, in clip space
+    glm::vec2 halfSize;
+    float rotation;         // radians, around the center
+    glm::vec3 color;
+    uint32_t layer;         // drawn in increasing order. 0 to 255
+    uint32_t pipeline;      // caller's pipeline table index. 0 to 255
+    uint32_t texture;       // caller's texture table index. 0 to 65535
+} Sprite;
+
+/*
+One draw: a run of sprites that share layer, pipeline and texture. firstVertex is relative to
+the vertex buffer offset from GetVertexBuffer().
+*/
+typedef struct SpriteDraw {
+    uint32_t pipeline;
+    uint32_t texture;
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+} SpriteDraw;
+
+typedef struct SpriteBatchInfo {
+    uint32_t maxSprites;    // per frame. the ring handed to Build() needs room for maxSprites * SPRITE_VERTEX_COUNT vertices
+} SpriteBatchInfo;
+
+// two triangles per quad, no index buffer, so every run is a single plain vkCmdDraw.
+const uint32_t SPRITE_VERTEX_COUNT = 6;
+
+/*
+Collects quads during the frame and turns them into as few draws as possible: one per distinct
+(layer, pipeline, texture), in that order. Sprites that share all three keep the order they
+were added in.
+
+Build() counts sprites per key, sorts only the distinct keys, and then writes every sprite's
+vertices straight into its key's range of a persistently mapped, per-frame upload ring region.
+There is no staging copy and no per-sprite sort, so the cost is linear in the sprite count.
+*/
+class SpriteBatch
+{
+public:
+    void Initialize(SpriteBatchInfo* spriteBatchInfo);
+    void Shutdown();
+
+    // forget last frame's sprites. draws from Build() stay valid until the next Build().
+    void Clear();
+    // dropped (and counted) past maxSprites.
+    void Add(const Sprite& sprite);
+
+    /*
+    Write the vertices for everything added since Clear() into ring and build the draw list.
+    ring must already be on the frame these vertices are for (UploadRing::BeginFrame()).
+    */
+    void Build(UploadRing& ring);
+
+    const std::vector<SpriteDraw>& GetDraws() const { return mDraws; }
+    VkBuffer GetVertexBuffer() const { return mVertices.buffer; }
+    VkDeviceSize GetVertexOffset() const { return mVertices.offset; }
+    const void* GetVertexData() const { return mVertices.pData; }
+    VkDeviceSize GetVertexBytes() const { return static_cast<VkDeviceSize>(mBuiltCount) * SPRITE_VERTEX_COUNT * sizeof(SpriteVertex); }
+
+    uint32_t GetSpriteCount() const { return static_cast<uint32_t>(mSprites.size()); }
+    uint32_t GetDroppedCount() const { return mDroppedCount; }
+
+private:
+    struct Run
+    {
+        uint32_t key;
+        uint32_t first;     // in sprites
+        uint32_t count;
+    };
+
+    uint32_t mMaxSprites = 0;
+    std::vector<Sprite> mSprites;
+    uint32_t mDroppedCount = 0;
+    bool mWarnedDropped = false;
+
+    std::vector<SpriteDraw> mDraws;
+    UploadAllocation mVertices = {};
+    uint32_t mBuiltCount = 0;
+
+    // scratch, kept between frames so building doesn't allocate once it has warmed up.
+    std::vector<Run> mRuns;
+    std::unordered_map<uint32_t, uint32_t> mRunLookup;
+    std::vector<uint32_t> mSpriteRuns;
+    std::vector<uint32_t> mRunRemap;
+};
+
+#endif _SPRITE_BATCH_H_
@@ -0,0 +1,522 @@
+#include "transferqueue.h"
+#include "logger.h"
+#include "memorybudget.h"
+#include "profiler.h"
+#include "vkutil.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+// keeps every piece of staging data on a boundary memcpy and the copy engine both like.
+const VkDeviceSize STAGING_ALIGNMENT = 16;
+
+void TransferQueue::Initialize(TransferQueueInfo* transferQueueInfo)
+{
+    mPhysicalDevice = transferQueueInfo->physicalDevice;
+    mDevice = transferQueueInfo->device;
+    mQueue = transferQueueInfo->transferQueue;
+    mTransferFamily = transferQueueInfo->transferFamily;
+    mGraphicsFamily = transferQueueInfo->graphicsFamily;
+    mUseTimeline = transferQueueInfo->useTimelineSemaphore;
+
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = mTransferFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    if (vkCreateCommandPool(mDevice, &poolInfo, nullptr, &mCommandPool) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to create transfer command pool!");
+    }
+
+    if (mUseTimeline)
+    {
+        VkSemaphoreTypeCreateInfo typeInfo = {};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphoreInfo = {};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &typeInfo;
+
+        if (vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &mTimeline) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create transfer timeline semaphore.");
+        }
+    }
+
+    mStagingSize = AlignUp(transferQueueInfo->stagingSize, STAGING_ALIGNMENT);
+    CreateBuffer(mPhysicalDevice, mDevice, mStagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        MEMORY_CATEGORY_STAGING, &mStagingBuffer, &mStagingMemory);
+
+    // mapped once and left mapped for the lifetime of the queue.
+    void* data;
+    if (vkMapMemory(mDevice, mStagingMemory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to map the staging ring.");
+    }
+    pStagingMapped = static_cast<char*>(data);
+
+    logger.debug("Transfer queue initialized. Dedicated family: %s. Timeline semaphore: %s. Staging ring: %llu bytes.",
+        IsDedicated() ? "yes" : "no", mUseTimeline ? "yes" : "no", (unsigned long long)mStagingSize);
+}
+
+void TransferQueue::Shutdown()
+{
+    Flush();
+    vkQueueWaitIdle(mQueue);
+    Update();
+
+    if (mTimeline != VK_NULL_HANDLE)
+    {
+        vkDestroySemaphore(mDevice, mTimeline, nullptr);
+        mTimeline = VK_NULL_HANDLE;
+    }
+    for (VkFence fence : mFreeFences)
+    {
+        vkDestroyFence(mDevice, fence, nullptr);
+    }
+    mFreeFences.clear();
+
+    vkUnmapMemory(mDevice, mStagingMemory);
+    vkDestroyBuffer(mDevice, mStagingBuffer, nullptr);
+    memoryBudget.TrackFree(mStagingMemory);
+    vkFreeMemory(mDevice, mStagingMemory, nullptr);
+    mStagingBuffer = VK_NULL_HANDLE;
+    mStagingMemory = VK_NULL_HANDLE;
+    pStagingMapped = nullptr;
+
+    vkDestroyCommandPool(mDevice, mCommandPool, nullptr);
+    mCommandPool = VK_NULL_HANDLE;
+    mSubmittedUploads.clear();
+}
+
+void TransferQueue::BeginBatch()
+{
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = mCommandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    mOpenBatch = {};
+    if (vkAllocateCommandBuffers(mDevice, &allocInfo, &mOpenBatch.commandBuffer) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to allocate a transfer command buffer.");
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(mOpenBatch.commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to begin a transfer command buffer.");
+    }
+
+    mOpenBatch.value = mSubmittedValue + 1;
+    mBatchOpen = true;
+}
+
+VkDeviceSize TransferQueue::AllocateStaging(VkDeviceSize size)
+{
+    for (;;)
+    {
+        // nothing in use, so start over where there's the most room.
+        if (mStagingHead == mStagingTail)
+        {
+            mStagingHead = 0;
+            mStagingTail = 0;
+        }
+
+        // a piece never wraps around the end of the ring, it starts over at the beginning instead.
+        VkDeviceSize position = AlignUp(mStagingHead, STAGING_ALIGNMENT);
+        if (position % mStagingSize + size > mStagingSize)
+        {
+            position += mStagingSize - position % mStagingSize;
+        }
+        if (position + size - mStagingTail <= mStagingSize)
+        {
+            mStagingHead = position + size;
+            return position % mStagingSize;
+        }
+
+        // full. give back what's finished, and failing that wait for the oldest batch (submitting
+        // the open one first if it's the only thing holding the space).
+        VkDeviceSize tail = mStagingTail;
+        Update();
+        if (mStagingTail != tail)
+        {
+            continue;
+        }
+        if (mInFlightBatches.empty())
+        {
+            Flush();
+        }
+        PROFILE_ZONE("staging ring full");
+        Wait(mInFlightBatches.front().value);
+        Update();
+    }
+}
+
+uint64_t TransferQueue::UploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    // anything bigger than the ring goes in ring-sized pieces; waiting for space may submit the
+    // open batch in between, so each piece is its own pending upload.
+    const char* source = static_cast<const char*>(data);
+    uint64_t value = 0;
+    for (VkDeviceSize done = 0; done < size;)
+    {
+        VkDeviceSize pieceSize = (std::min)(size - done, mStagingSize);
+        VkDeviceSize stagingOffset = AllocateStaging(pieceSize);
+        if (!mBatchOpen)
+        {
+            BeginBatch();
+        }
+
+        memcpy(pStagingMapped + stagingOffset, source + done, (size_t)pieceSize);
+
+        VkBufferCopy copyRegion = {};
+        copyRegion.srcOffset = stagingOffset;
+        copyRegion.dstOffset = dstOffset + done;
+        copyRegion.size = pieceSize;
+        vkCmdCopyBuffer(mOpenBatch.commandBuffer, mStagingBuffer, dst, 1, &copyRegion);
+
+        PendingUpload upload = {};
+        upload.buffer = dst;
+        upload.offset = copyRegion.dstOffset;
+        upload.size = pieceSize;
+        upload.dstStage = dstStage;
+        upload.dstAccess = dstAccess;
+        upload.value = mOpenBatch.value;
+        mRecordedUploads.push_back(upload);
+
+        value = upload.value;
+        done += pieceSize;
+    }
+
+    return value;
+}
+
+uint64_t TransferQueue::UploadImage(VkImage dst, VkExtent2D extent, const void* data, VkDeviceSize size, VkImageLayout dstLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    if (size > mStagingSize)
+    {
+        logger.throw_error("image upload of %llu bytes doesn't fit the staging ring.", (unsigned long long)size);
+    }
+
+    VkDeviceSize stagingOffset = AllocateStaging(size);
+    if (!mBatchOpen)
+    {
+        BeginBatch();
+    }
+
+    memcpy(pStagingMapped + stagingOffset, data, (size_t)size);
+
+    // the copy needs the image in a transfer layout first. from UNDEFINED, so nothing is kept.
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = dst;
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    vkCmdPipelineBarrier(mOpenBatch.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy copyRegion = {};
+    copyRegion.bufferOffset = stagingOffset;
+    copyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    copyRegion.imageExtent = { extent.width, extent.height, 1 };
+    vkCmdCopyBufferToImage(mOpenBatch.commandBuffer, mStagingBuffer, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+    PendingUpload upload = {};
+    upload.image = dst;
+    upload.layout = dstLayout;
+    upload.dstStage = dstStage;
+    upload.dstAccess = dstAccess;
+    upload.value = mOpenBatch.value;
+    mRecordedUploads.push_back(upload);
+
+    return upload.value;
+}
+
+// the barrier that moves an uploaded image from the transfer layout to the one it's used in.
+// release and acquire both carry the same layout change; with a shared family it's a single barrier.
+static VkImageMemoryBarrier ImageUploadBarrier(VkImage image, VkImageLayout layout, VkAccessFlags srcAccess, VkAccessFlags dstAccess, uint32_t srcFamily, uint32_t dstFamily)
+{
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = layout;
+    barrier.srcQueueFamilyIndex = srcFamily;
+    barrier.dstQueueFamilyIndex = dstFamily;
+    barrier.image = image;
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    return barrier;
+}
+
+void TransferQueue::Flush()
+{
+    PROFILE_FUNCTION();
+    if (!mBatchOpen)
+    {
+        return;
+    }
+
+    // release half of the queue family ownership transfer. the matching acquire is
+    // recorded on the graphics queue by RecordAcquireBarriers().
+    if (IsDedicated())
+    {
+        std::vector<VkBufferMemoryBarrier> releases;
+        std::vector<VkImageMemoryBarrier> imageReleases;
+        releases.reserve(mRecordedUploads.size());
+        for (const auto& upload : mRecordedUploads)
+        {
+            if (upload.image != VK_NULL_HANDLE)
+            {
+                // dstAccessMask is ignored for a release
+                imageReleases.push_back(ImageUploadBarrier(upload.image, upload.layout, VK_ACCESS_TRANSFER_WRITE_BIT, 0, mTransferFamily, mGraphicsFamily));
+                continue;
+            }
+
+            VkBufferMemoryBarrier barrier = {};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = 0; // ignored for a release
+            barrier.srcQueueFamilyIndex = mTransferFamily;
+            barrier.dstQueueFamilyIndex = mGraphicsFamily;
+            barrier.buffer = upload.buffer;
+            barrier.offset = upload.offset;
+            barrier.size = upload.size;
+            releases.push_back(barrier);
+        }
+        vkCmdPipelineBarrier(mOpenBatch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+            0, nullptr, static_cast<uint32_t>(releases.size()), releases.data(), static_cast<uint32_t>(imageReleases.size()), imageReleases.data());
+    }
+
+    if (vkEndCommandBuffer(mOpenBatch.commandBuffer) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to record a transfer command buffer.");
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &mOpenBatch.commandBuffer;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+    mOpenBatch.fence = VK_NULL_HANDLE;
+    if (mUseTimeline)
+    {
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues = &mOpenBatch.value;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &mTimeline;
+    }
+    else if (!mFreeFences.empty())
+    {
+        // no timeline semaphores: each batch gets a fence, which Update() polls from then on.
+        mOpenBatch.fence = mFreeFences.back();
+        mFreeFences.pop_back();
+    }
+    else
+    {
+        VkFenceCreateInfo fenceInfo = {};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        if (vkCreateFence(mDevice, &fenceInfo, nullptr, &mOpenBatch.fence) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create transfer fence.");
+        }
+    }
+
+    if (vkQueueSubmit(mQueue, 1, &submitInfo, mOpenBatch.fence) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to submit transfer command buffer!");
+    }
+    mSubmittedValue = mOpenBatch.value;
+    mOpenBatch.stagingEnd = mStagingHead;
+
+    mInFlightBatches.push_back(mOpenBatch);
+    mSubmittedUploads.insert(mSubmittedUploads.end(), mRecordedUploads.begin(), mRecordedUploads.end());
+    mRecordedUploads.clear();
+    mOpenBatch = {};
+    mBatchOpen = false;
+}
+
+uint64_t TransferQueue::GetCompletedValue()
+{
+    if (!mUseTimeline)
+    {
+        // a fence also covers every earlier submit to the queue, so the newest signaled one is the answer.
+        for (auto it = mInFlightBatches.rbegin(); it != mInFlightBatches.rend() && it->value > mCompletedValue; ++it)
+        {
+            if (vkGetFenceStatus(mDevice, it->fence) == VK_SUCCESS)
+            {
+                mCompletedValue = it->value;
+                break;
+            }
+        }
+        return mCompletedValue;
+    }
+    uint64_t value = 0;
+    vkGetSemaphoreCounterValue(mDevice, mTimeline, &value);
+    return value;
+}
+
+void TransferQueue::Update()
+{
+    if (mInFlightBatches.empty())
+    {
+        return;
+    }
+
+    uint64_t completed = GetCompletedValue();
+    auto retired = std::remove_if(mInFlightBatches.begin(), mInFlightBatches.end(), [&](const Batch& batch)
+    {
+        if (batch.value > completed)
+        {
+            return false;
+        }
+        mStagingTail = (std::max)(mStagingTail, batch.stagingEnd);
+        if (batch.fence != VK_NULL_HANDLE)
+        {
+            vkResetFences(mDevice, 1, &batch.fence);
+            mFreeFences.push_back(batch.fence);
+        }
+        vkFreeCommandBuffers(mDevice, mCommandPool, 1, &batch.commandBuffer);
+        return true;
+    });
+    mInFlightBatches.erase(retired, mInFlightBatches.end());
+}
+
+void TransferQueue::Require(uint64_t value)
+{
+    mRequiredValue = (std::max)(mRequiredValue, value);
+}
+
+uint64_t TransferQueue::RecordAcquireBarriers(VkCommandBuffer commandBuffer, VkPipelineStageFlags* pWaitStages)
+{
+    *pWaitStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    // a required upload can't be acquired before its batch is submitted.
+    if (mRequiredValue > mSubmittedValue)
+    {
+        Flush();
+    }
+    // without a timeline there's nothing for the graphics submit to wait on, so a required
+    // upload that's still in flight has to be finished here.
+    if (!mUseTimeline && mRequiredValue > GetCompletedValue())
+    {
+        Wait(mRequiredValue);
+    }
+    if (mSubmittedUploads.empty())
+    {
+        return 0;
+    }
+
+    // everything that's done, and whatever this frame can't do without. the rest stays pending.
+    uint64_t completed = GetCompletedValue();
+    uint64_t waitValue = 0;
+    VkPipelineStageFlags dstStages = 0;
+    std::vector<VkBufferMemoryBarrier> acquires;
+    std::vector<VkImageMemoryBarrier> imageAcquires;
+    std::vector<PendingUpload> stillPending;
+    acquires.reserve(mSubmittedUploads.size());
+    for (const auto& upload : mSubmittedUploads)
+    {
+        if (upload.value > completed && upload.value > mRequiredValue)
+        {
+            stillPending.push_back(upload);
+            continue;
+        }
+
+        dstStages |= upload.dstStage;
+        waitValue = (std::max)(waitValue, upload.value);
+
+        uint32_t srcFamily = IsDedicated() ? mTransferFamily : VK_QUEUE_FAMILY_IGNORED;
+        uint32_t dstFamily = IsDedicated() ? mGraphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+        if (upload.image != VK_NULL_HANDLE)
+        {
+            VkAccessFlags srcAccess = IsDedicated() ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+            imageAcquires.push_back(ImageUploadBarrier(upload.image, upload.layout, srcAccess, upload.dstAccess, srcFamily, dstFamily));
+            continue;
+        }
+
+        VkBufferMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        // for an acquire the source access is ignored; with a shared family this is a normal transfer->use barrier.
+        barrier.srcAccessMask = IsDedicated() ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = upload.dstAccess;
+        barrier.srcQueueFamilyIndex = srcFamily;
+        barrier.dstQueueFamilyIndex = dstFamily;
+        barrier.buffer = upload.buffer;
+        barrier.offset = upload.offset;
+        barrier.size = upload.size;
+        acquires.push_back(barrier);
+    }
+
+    mSubmittedUploads.swap(stillPending);
+    if (acquires.empty() && imageAcquires.empty())
+    {
+        return 0;
+    }
+
+    VkPipelineStageFlags srcStage = IsDedicated() ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT;
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStages, 0,
+        0, nullptr, static_cast<uint32_t>(acquires.size()), acquires.data(), static_cast<uint32_t>(imageAcquires.size()), imageAcquires.data());
+
+    *pWaitStages = dstStages;
+
+    // waiting on a value that's already been reached costs nothing, and keeps the
+    // release -> acquire ordering the spec asks for even when the upload finished long ago.
+    return mUseTimeline ? waitValue : 0;
+}
+
+bool TransferQueue::IsComplete(uint64_t value)
+{
+    return value <= GetCompletedValue();
+}
+
+void TransferQueue::Wait(uint64_t value)
+{
+    if (value > mSubmittedValue)
+    {
+        Flush();
+    }
+    if (IsComplete(value))
+    {
+        return;
+    }
+
+    if (!mUseTimeline)
+    {
+        // the first batch that reaches value; its fence covers the ones before it.
+        for (const auto& batch : mInFlightBatches)
+        {
+            if (batch.value >= value)
+            {
+                vkWaitForFences(mDevice, 1, &batch.fence, VK_TRUE, (std::numeric_limits<uint64_t>::max)());
+                mCompletedValue = batch.value;
+                return;
+            }
+        }
+        return;
+    }
+
+    VkSemaphoreWaitInfo waitInfo = {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &mTimeline;
+    waitInfo.pValues = &value;
+    vkWaitSemaphores(mDevice, &waitInfo, (std::numeric_limits<uint64_t>::max)());
+}
@@ -0,0 +1,141 @@
+#ifndef _TRANSFER_QUEUE_H_
+#define _TRANSFER_QUEUE_H_
+
+#include "vulkanloader.h"
+#include <vector>
+
+typedef struct TransferQueueInfo {
+    VkPhysicalDevice physicalDevice;
+    VkDevice device;
+    VkQueue transferQueue;
+    uint32_t transferFamily;        // may equal graphicsFamily when there's no dedicated transfer family
+    uint32_t graphicsFamily;
+    bool useTimelineSemaphore;      // false falls back to a fence per batch, polled by Update()
+    VkDeviceSize stagingSize;       // the staging ring. bigger uploads are split into pieces of at most this size
+} TransferQueueInfo;
+
+/*
+Streams data into device local buffers (and the odd image) from a (preferably dedicated) transfer queue.
+
+Uploads are batched into one transfer command buffer and submitted by Flush().
+Each batch signals the next value on a timeline semaphore, and every upload
+returns the value it'll be complete at. The graphics side calls
+RecordAcquireBarriers() while recording a frame; that records the queue family
+ownership acquires for uploads that have already finished, plus the ones the frame
+asked for with Require(), and returns the timeline value the frame has to wait on.
+Streaming uploads nobody requires yet are picked up by whichever frame records after
+they finish, so they never stall the frame that kicked them off.
+
+Source data is copied into one persistently mapped staging ring. Space is handed out
+in submission order and given back when the batch that used it reaches its timeline
+value (or its fence signals), so steady-state uploads never allocate. An upload that
+finds the ring full waits for the oldest batch in flight.
+*/
+class TransferQueue
+{
+public:
+    void Initialize(TransferQueueInfo* transferQueueInfo);
+    void Shutdown();
+
+    /*
+    Queue a copy of size bytes from data into dst at dstOffset.
+    dstStage/dstAccess describe how the graphics queue will first use the data.
+    Returns the timeline value the upload will be complete at.
+    */
+    uint64_t UploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+    /*
+    Queue a copy of tightly packed texels from data into the whole of color image dst (one mip, one layer).
+    dst's previous contents are discarded. The copy isn't split, so size has to fit in the staging ring.
+    The graphics side gets the image in dstLayout, first used at dstStage/dstAccess.
+    Returns the timeline value the upload will be complete at.
+    */
+    uint64_t UploadImage(VkImage dst, VkExtent2D extent, const void* data, VkDeviceSize size, VkImageLayout dstLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+    /*
+    Submit everything queued since the last Flush(). Cheap when nothing is queued.
+    */
+    void Flush();
+
+    /*
+    Give staging ring space back for batches the gpu has finished with. Without timeline
+    semaphores this is also where their fences get polled. Call once a frame.
+    */
+    void Update();
+
+    /*
+    Record the graphics side of the ownership transfer (or a plain barrier when the
+    families match) for every flushed upload that hasn't been acquired yet.
+    Returns the timeline value the submit containing commandBuffer must wait on, or 0,
+    and fills pWaitStages with the stages that wait has to block.
+    */
+    uint64_t RecordAcquireBarriers(VkCommandBuffer commandBuffer, VkPipelineStageFlags* pWaitStages);
+
+    /*
+    The next frame recorded reads uploads up to value, so it has to acquire (and wait for) them
+    even if they haven't finished. Anything not required is only used once it's been acquired.
+    */
+    void Require(uint64_t value);
+
+    bool IsComplete(uint64_t value);
+    void Wait(uint64_t value);
+
+    VkSemaphore GetTimelineSemaphore() const { return mTimeline; }
+    bool IsDedicated() const { return mTransferFamily != mGraphicsFamily; }
+
+private:
+    struct PendingUpload
+    {
+        VkBuffer buffer;            // VK_NULL_HANDLE for an image
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        VkImage image;              // VK_NULL_HANDLE for a buffer
+        VkImageLayout layout;       // the image's layout once acquired
+        VkPipelineStageFlags dstStage;
+        VkAccessFlags dstAccess;
+        uint64_t value;
+    };
+
+    struct Batch
+    {
+        VkCommandBuffer commandBuffer;
+        VkFence fence;              // only without timeline semaphores
+        VkDeviceSize stagingEnd;    // ring position the batch's staging data ends at
+        uint64_t value;
+    };
+
+    void BeginBatch();
+    // reserve size bytes (at most mStagingSize) in the staging ring, waiting for space if needed. returns the offset.
+    VkDeviceSize AllocateStaging(VkDeviceSize size);
+    uint64_t GetCompletedValue();
+
+    VkPhysicalDevice mPhysicalDevice;
+    VkDevice mDevice;
+    VkQueue mQueue;
+    uint32_t mTransferFamily;
+    uint32_t mGraphicsFamily;
+    bool mUseTimeline;
+
+    VkCommandPool mCommandPool = VK_NULL_HANDLE;
+    VkSemaphore mTimeline = VK_NULL_HANDLE;
+    std::vector<VkFence> mFreeFences;   // only used without timeline semaphores
+    uint64_t mSubmittedValue = 0;       // last value handed to vkQueueSubmit
+    uint64_t mCompletedValue = 0;       // fallback bookkeeping without timeline semaphores
+    uint64_t mRequiredValue = 0;        // highest value passed to Require()
+
+    VkBuffer mStagingBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory mStagingMemory = VK_NULL_HANDLE;
+    char* pStagingMapped = nullptr;
+    VkDeviceSize mStagingSize = 0;
+    // ever-increasing positions; the offset into the ring is position % mStagingSize.
+    VkDeviceSize mStagingHead = 0;      // where the next allocation starts
+    VkDeviceSize mStagingTail = 0;      // start of the oldest data a batch may still read
+
+    Batch mOpenBatch = {};
+    bool mBatchOpen = false;
+    std::vector<Batch> mInFlightBatches;
+    std::vector<PendingUpload> mRecordedUploads;    // recorded into the open batch
+    std::vector<PendingUpload> mSubmittedUploads;   // submitted, waiting on a graphics side acquire
+};
+
+#endif _TRANSFER_QUEUE_H_
@@ -0,0 +1,215 @@
+#include "transformhierarchy.h"
+#include "profiler.h"
+
+#include <algorithm>
+
+glm::mat4 ComposeTransform(const TransformComponent& transform)
+{
+    glm::mat3 rotation = glm::mat3_cast(transform.rotation);
+    glm::mat4 matrix;
+    matrix[0] = glm::vec4(rotation[0] * transform.scale.x, 0.0f);
+    matrix[1] = glm::vec4(rotation[1] * transform.scale.y, 0.0f);
+    matrix[2] = glm::vec4(rotation[2] * transform.scale.z, 0.0f);
+    matrix[3] = glm::vec4(transform.position, 1.0f);
+    return matrix;
+}
+
+void TransformHierarchy::Initialize(TransformHierarchyInfo* transformHierarchyInfo)
+{
+    Reserve(transformHierarchyInfo->initialCapacity);
+}
+
+void TransformHierarchy::Shutdown()
+{
+    mParents.clear();
+    mSubtreeSizes.clear();
+    mLocals.clear();
+    mWorlds.clear();
+    mEntities.clear();
+    mNodes.clear();
+    mRemoved.clear();
+    mOrderOfNode.clear();
+    mFreeNodes.clear();
+    mDirtyNodes.clear();
+    mUpdatedRanges.clear();
+    mUpdatedCount = 0;
+    mRemovedCount = 0;
+}
+
+void TransformHierarchy::Reserve(uint32_t count)
+{
+    size_t nodes = mNodes.size() + count;
+    mParents.reserve(nodes);
+    mSubtreeSizes.reserve(nodes);
+    mLocals.reserve(nodes);
+    mWorlds.reserve(nodes);
+    mEntities.reserve(nodes);
+    mNodes.reserve(nodes);
+    mRemoved.reserve(nodes);
+    mOrderOfNode.reserve(nodes);
+    mDirtyNodes.reserve(nodes);
+}
+
+TransformNode TransformHierarchy::Insert(const TransformComponent& local, TransformNode parent, Entity entity)
+{
+    TransformNode node;
+    if (!mFreeNodes.empty())
+    {
+        node = mFreeNodes.back();
+        mFreeNodes.pop_back();
+    }
+    else
+    {
+        node = static_cast<TransformNode>(mOrderOfNode.size());
+        mOrderOfNode.push_back(TRANSFORM_NODE_NONE);
+    }
+
+    // right after the parent's subtree, or at the very end for a root.
+    uint32_t parentPosition = parent != TRANSFORM_NODE_NONE ? mOrderOfNode[parent] : TRANSFORM_NODE_NONE;
+    uint32_t position = parent != TRANSFORM_NODE_NONE ? parentPosition + mSubtreeSizes[parentPosition] : static_cast<uint32_t>(mNodes.size());
+    uint32_t count = static_cast<uint32_t>(mNodes.size());
+
+    mParents.insert(mParents.begin() + position, parentPosition);
+    mSubtreeSizes.insert(mSubtreeSizes.begin() + position, 1);
+    mLocals.insert(mLocals.begin() + position, local);
+    mWorlds.insert(mWorlds.begin() + position, glm::mat4(1.0f));
+    mEntities.insert(mEntities.begin() + position, entity);
+    mNodes.insert(mNodes.begin() + position, node);
+    mRemoved.insert(mRemoved.begin() + position, 0);
+    mOrderOfNode[node] = position;
+
+    // everything after the new node moved up by one.
+    if (position != count)
+    {
+        for (uint32_t i = position + 1; i <= count; ++i)
+        {
+            mOrderOfNode[mNodes[i]] = i;
+            if (mParents[i] != TRANSFORM_NODE_NONE && mParents[i] >= position)
+            {
+                ++mParents[i];
+            }
+        }
+    }
+
+    for (uint32_t ancestor = parentPosition; ancestor != TRANSFORM_NODE_NONE; ancestor = mParents[ancestor])
+    {
+        ++mSubtreeSizes[ancestor];
+    }
+
+    mDirtyNodes.push_back(node);
+    return node;
+}
+
+void TransformHierarchy::Remove(TransformNode node)
+{
+    uint32_t position = mOrderOfNode[node];
+    for (uint32_t i = position, end = position + mSubtreeSizes[position]; i < end; ++i)
+    {
+        if (!mRemoved[i])
+        {
+            mRemoved[i] = 1;
+            ++mRemovedCount;
+        }
+    }
+}
+
+void TransformHierarchy::SetLocal(TransformNode node, const TransformComponent& local)
+{
+    mLocals[mOrderOfNode[node]] = local;
+    mDirtyNodes.push_back(node);
+}
+
+void TransformHierarchy::Compact()
+{
+    // parents come first, so by the time a node is moved its parent's new position is known.
+    // mSubtreeSizes is reused to hold the new positions, then rebuilt.
+    uint32_t count = static_cast<uint32_t>(mNodes.size());
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (mRemoved[i])
+        {
+            mOrderOfNode[mNodes[i]] = TRANSFORM_NODE_NONE;
+            mFreeNodes.push_back(mNodes[i]);
+            continue;
+        }
+
+        mParents[kept] = mParents[i] != TRANSFORM_NODE_NONE ? mSubtreeSizes[mParents[i]] : TRANSFORM_NODE_NONE;
+        mLocals[kept] = mLocals[i];
+        mWorlds[kept] = mWorlds[i];
+        mEntities[kept] = mEntities[i];
+        mNodes[kept] = mNodes[i];
+        mOrderOfNode[mNodes[kept]] = kept;
+        mSubtreeSizes[i] = kept;
+        ++kept;
+    }
+
+    mParents.resize(kept);
+    mLocals.resize(kept);
+    mWorlds.resize(kept);
+    mEntities.resize(kept);
+    mNodes.resize(kept);
+    mRemoved.assign(kept, 0);
+
+    // children come after parents, so walking backwards finishes every subtree before its parent adds it.
+    mSubtreeSizes.assign(kept, 1);
+    for (uint32_t i = kept; i-- > 0;)
+    {
+        if (mParents[i] != TRANSFORM_NODE_NONE)
+        {
+            mSubtreeSizes[mParents[i]] += mSubtreeSizes[i];
+        }
+    }
+    mRemovedCount = 0;
+}
+
+void TransformHierarchy::Update()
+{
+    PROFILE_FUNCTION();
+    if (mRemovedCount != 0)
+    {
+        Compact();
+    }
+
+    mUpdatedRanges.clear();
+    mUpdatedCount = 0;
+    if (mDirtyNodes.empty())
+    {
+        return;
+    }
+
+    for (TransformNode node : mDirtyNodes)
+    {
+        uint32_t position = mOrderOfNode[node];
+        // removed since it was marked.
+        if (position != TRANSFORM_NODE_NONE)
+        {
+            mUpdatedRanges.push_back({ position, position + mSubtreeSizes[position] });
+        }
+    }
+    mDirtyNodes.clear();
+
+    // subtrees either nest or don't touch, so after sorting a range is either inside the last kept one or after it.
+    std::sort(mUpdatedRanges.begin(), mUpdatedRanges.end(), [](const Range& a, const Range& b) { return a.begin < b.begin; });
+    uint32_t merged = 0;
+    for (const Range& range : mUpdatedRanges)
+    {
+        if (merged != 0 && range.begin < mUpdatedRanges[merged - 1].end)
+        {
+            continue;
+        }
+        mUpdatedRanges[merged++] = range;
+    }
+    mUpdatedRanges.resize(merged);
+
+    // a range's root has its parent outside the range, and that parent is either clean or was done in an earlier range.
+    for (const Range& range : mUpdatedRanges)
+    {
+        for (uint32_t i = range.begin; i < range.end; ++i)
+        {
+            glm::mat4 local = ComposeTransform(mLocals[i]);
+            mWorlds[i] = mParents[i] != TRANSFORM_NODE_NONE ? mWorlds[mParents[i]] * local : local;
+        }
+        mUpdatedCount += range.end - range.begin;
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef _TRANSFORM_HIERARCHY_H_
+#define _TRANSFORM_HIERARCHY_H_
+
+#include "entitystore.h"
+#include <cstdint>
+#include <vector>
+
+// stable node handle. never reused while the node is alive.
+typedef uint32_t TransformNode;
+
+const TransformNode TRANSFORM_NODE_NONE = 0xffffffff;
+
+/*
+Local to parent matrix: rotation and scale, then translation.
+*/
+glm::mat4 ComposeTransform(const TransformComponent& transform);
+
+typedef struct TransformHierarchyInfo {
+    uint32_t initialCapacity;   // nodes reserved up front
+} TransformHierarchyInfo;
+
+/*
+Parent/child transforms. Nodes are stored depth first, so a parent always comes before its
+children and every subtree is one contiguous range.
+
+SetLocal() only records the node as dirty. Update() turns the dirty nodes into subtree ranges,
+merges the ones that overlap, and recomputes world matrices for those ranges in one forward
+pass each; nodes nobody touched are never visited. A scene that is mostly static costs
+little more than the nodes that moved.
+
+Adding a node at the end of the last subtree is cheap, which is how scenes are usually built
+(parent, then its children). Adding anywhere else shifts the nodes after it. Removing is
+deferred: removed subtrees are dropped by the next Update() in a single compaction pass.
+*/
+class TransformHierarchy
+{
+public:
+    void Initialize(TransformHierarchyInfo* transformHierarchyInfo);
+    void Shutdown();
+
+    /*
+    New node under parent (TRANSFORM_NODE_NONE for a root), placed after the parent's existing
+    children. entity is the one whose world matrix follows the node, or NULL_ENTITY for a pure pivot.
+    */
+    TransformNode Insert(const TransformComponent& local, TransformNode parent, Entity entity);
+
+    /*
+    The node and everything under it. The entities are left alone.
+    */
+    void Remove(TransformNode node);
+
+    void SetLocal(TransformNode node, const TransformComponent& local);
+    const TransformComponent& GetLocal(TransformNode node) const { return mLocals[mOrderOfNode[node]]; }
+    // as of the last Update().
+    const glm::mat4& GetWorld(TransformNode node) const { return mWorlds[mOrderOfNode[node]]; }
+    Entity GetEntity(TransformNode node) const { return mEntities[mOrderOfNode[node]]; }
+
+    void Reserve(uint32_t count);
+
+    /*
+    Recompute the world matrices of every dirty subtree.
+    */
+    void Update();
+
+    /*
+    Depth first ranges [begin, end) Update() recomputed, in order. GetWorldAt()/GetEntityAt() take
+    positions in these ranges, which stay valid until the hierarchy changes again.
+    */
+    struct Range
+    {
+        uint32_t begin;
+        uint32_t end;
+    };
+    const std::vector<Range>& GetUpdatedRanges() const { return mUpdatedRanges; }
+    const glm::mat4& GetWorldAt(uint32_t position) const { return mWorlds[position]; }
+    Entity GetEntityAt(uint32_t position) const { return mEntities[position]; }
+
+    uint32_t GetNodeCount() const { return static_cast<uint32_t>(mNodes.size()) - mRemovedCount; }
+    uint32_t GetUpdatedCount() const { return mUpdatedCount; }
+
+private:
+    void Compact();
+
+    // one entry per node, in depth first order. parents are positions too.
+    std::vector<uint32_t> mParents;
+    std::vector<uint32_t> mSubtreeSizes;    // including the node itself
+    std::vector<TransformComponent> mLocals;
+    std::vector<glm::mat4> mWorlds;
+    std::vector<Entity> mEntities;
+    std::vector<TransformNode> mNodes;
+    std::vector<uint8_t> mRemoved;
+
+    // handle to position. TRANSFORM_NODE_NONE for free handles.
+    std::vector<uint32_t> mOrderOfNode;
+    std::vector<TransformNode> mFreeNodes;
+
+    std::vector<TransformNode> mDirtyNodes;
+    std::vector<Range> mUpdatedRanges;
+    uint32_t mUpdatedCount = 0;
+    uint32_t mRemovedCount = 0;
+};
+
+#endif _TRANSFORM_HIERARCHY_H_
@@ -0,0 +1,116 @@
+#include "uploadring.h"
+#include "logger.h"
+#include "memorybudget.h"
+#include "vkutil.h"
+
+#include <algorithm>
+
+void UploadRing::Initialize(UploadRingInfo* uploadRingInfo)
+{
+    mDevice = uploadRingInfo->device;
+    mFrameCount = uploadRingInfo->frameCount;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(uploadRingInfo->physicalDevice, &properties);
+    mUniformAlignment = properties.limits.minUniformBufferOffsetAlignment;
+    mStorageAlignment = properties.limits.minStorageBufferOffsetAlignment;
+
+    // every frame region has to start on an offset that's valid for any kind of binding.
+    VkDeviceSize regionAlignment = (std::max)({ mUniformAlignment, mStorageAlignment, properties.limits.nonCoherentAtomSize, (VkDeviceSize)256 });
+    mFrameSize = AlignUp(uploadRingInfo->frameSize, regionAlignment);
+
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = mFrameSize * mFrameCount;
+    bufferInfo.usage = uploadRingInfo->usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(mDevice, &bufferInfo, nullptr, &mBuffer) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to create upload ring buffer.");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(mDevice, mBuffer, &memRequirements);
+
+    // prefer memory the gpu can read directly (resizable BAR / UMA). fall back to plain host memory.
+    uint32_t memoryTypeIndex = 0;
+    if (!TryFindMemoryType(uploadRingInfo->physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &memoryTypeIndex))
+    {
+        memoryTypeIndex = FindMemoryType(uploadRingInfo->physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    }
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    if (vkAllocateMemory(mDevice, &allocInfo, nullptr, &mMemory) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to allocate upload ring memory.");
+    }
+    memoryBudget.TrackAllocation(mMemory, memoryTypeIndex, allocInfo.allocationSize, MEMORY_CATEGORY_UPLOAD);
+
+    vkBindBufferMemory(mDevice, mBuffer, mMemory, 0);
+
+    // mapped once and left mapped for the lifetime of the ring.
+    void* data;
+    if (vkMapMemory(mDevice, mMemory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to map upload ring memory.");
+    }
+    pMapped = static_cast<char*>(data);
+
+    mFrameBase = 0;
+    mHead = 0;
+
+    logger.debug("Upload ring created. %u frames x %llu bytes.", mFrameCount, (unsigned long long)mFrameSize);
+}
+
+void UploadRing::Shutdown()
+{
+    if (pMapped)
+    {
+        vkUnmapMemory(mDevice, mMemory);
+        pMapped = nullptr;
+    }
+    vkDestroyBuffer(mDevice, mBuffer, nullptr);
+    memoryBudget.TrackFree(mMemory);
+    vkFreeMemory(mDevice, mMemory, nullptr);
+    mBuffer = VK_NULL_HANDLE;
+    mMemory = VK_NULL_HANDLE;
+}
+
+void UploadRing::BeginFrame(uint32_t frameIndex)
+{
+    mFrameBase = mFrameSize * (frameIndex % mFrameCount);
+    mHead = 0;
+}
+
+UploadAllocation UploadRing::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    // mFrameBase is aligned to every alignment we hand out, so aligning the head is enough.
+    VkDeviceSize offset = AlignUp(mHead, alignment);
+    if (offset + size > mFrameSize)
+    {
+        logger.throw_error("upload ring is out of space for this frame. Requested %llu bytes with %llu of %llu used.",
+            (unsigned long long)size, (unsigned long long)mHead, (unsigned long long)mFrameSize);
+    }
+    mHead = offset + size;
+
+    UploadAllocation allocation = {};
+    allocation.buffer = mBuffer;
+    allocation.offset = mFrameBase + offset;
+    allocation.pData = pMapped + allocation.offset;
+    return allocation;
+}
+
+UploadAllocation UploadRing::AllocateUniform(VkDeviceSize size)
+{
+    return Allocate(size, mUniformAlignment);
+}
+
+UploadAllocation UploadRing::AllocateStorage(VkDeviceSize size)
+{
+    return Allocate(size, mStorageAlignment);
+}
@@ -0,0 +1,73 @@
+#ifndef _UPLOAD_RING_H_
+#define _UPLOAD_RING_H_
+
+#include "vulkanloader.h"
+#include <cstring>
+
+typedef struct UploadRingInfo {
+    VkPhysicalDevice physicalDevice;
+    VkDevice device;
+    VkDeviceSize frameSize;         // bytes each frame in flight can hand out
+    uint32_t frameCount;            // one region per frame in flight
+    VkBufferUsageFlags usage;       // e.g. VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+} UploadRingInfo;
+
+typedef struct UploadAllocation {
+    VkBuffer buffer;
+    VkDeviceSize offset;            // offset into buffer. use this as the dynamic offset.
+    void* pData;                    // cpu pointer to write to. stays valid until the frame comes back around.
+} UploadAllocation;
+
+/*
+A persistently mapped buffer split into one region per frame in flight.
+Each frame gets a bump allocator over its own region, so handing out memory
+for per-frame data (uniforms, per-draw constants, streaming vertices) is just
+an aligned pointer bump. There is no map/unmap and no per-allocation Vulkan call.
+
+The caller is responsible for only calling BeginFrame(frameIndex) once the
+in-flight fence for that frame has been waited on; that's what makes it safe
+to overwrite the region.
+*/
+class UploadRing
+{
+public:
+    void Initialize(UploadRingInfo* uploadRingInfo);
+    void Shutdown();
+
+    void BeginFrame(uint32_t frameIndex);
+
+    UploadAllocation Allocate(VkDeviceSize size, VkDeviceSize alignment);
+    UploadAllocation AllocateUniform(VkDeviceSize size);
+    UploadAllocation AllocateStorage(VkDeviceSize size);
+
+    /*
+    Copy value into the ring and return where it landed.
+    */
+    template <typename T>
+    UploadAllocation PushUniform(const T& value)
+    {
+        UploadAllocation allocation = AllocateUniform(sizeof(T));
+        memcpy(allocation.pData, &value, sizeof(T));
+        return allocation;
+    }
+
+    VkBuffer GetBuffer() const { return mBuffer; }
+    VkDeviceSize GetFrameSize() const { return mFrameSize; }
+    VkDeviceSize GetBytesUsed() const { return mHead; }
+
+private:
+    VkDevice mDevice;
+    VkBuffer mBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory mMemory = VK_NULL_HANDLE;
+    char* pMapped = nullptr;
+
+    VkDeviceSize mFrameSize = 0;
+    uint32_t mFrameCount = 0;
+    VkDeviceSize mUniformAlignment = 0;
+    VkDeviceSize mStorageAlignment = 0;
+
+    VkDeviceSize mFrameBase = 0;    // start of the current frame's region
+    VkDeviceSize mHead = 0;         // bytes handed out from the current frame's region
+};
+
+#endif _UPLOAD_RING_H_
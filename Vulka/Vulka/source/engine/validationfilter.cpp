@@ -0,0 +1,199 @@
+#include "validationfilter.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+// how many of the loudest messages make it into a summary.
+static const size_t REPORT_TOP_COUNT = 8;
+
+void ValidationFilter::Initialize(ValidationFilterInfo* validationFilterInfo)
+{
+    mSeverityMask = validationFilterInfo->severityMask;
+    mMaxRepeats = validationFilterInfo->maxRepeats;
+    mReportInterval = validationFilterInfo->reportInterval;
+    mLastReport = std::chrono::steady_clock::now();
+
+    logger.debug("Validation filter initialized. Showing %s, %u repeats per message.", GetSeverityName(mSeverityMask), mMaxRepeats);
+}
+
+void ValidationFilter::Shutdown()
+{
+    Report(true);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mMessages.clear();
+    mSuppressed = 0;
+}
+
+void ValidationFilter::Update()
+{
+    if (mReportInterval <= 0.0)
+    {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration<double>(now - mLastReport).count() < mReportInterval)
+    {
+        return;
+    }
+    mLastReport = now;
+    Report(false);
+}
+
+void ValidationFilter::Submit(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData)
+{
+    // cheapest check first; filtered messages never take the lock.
+    if ((mSeverityMask.load(std::memory_order_relaxed) & severity) == 0)
+    {
+        return;
+    }
+
+    // some messages (loader, general) come without an id number.
+    uint64_t key = static_cast<uint32_t>(pCallbackData->messageIdNumber);
+    if (key == 0)
+    {
+        const char* name = pCallbackData->pMessageIdName != nullptr ? pCallbackData->pMessageIdName : pCallbackData->pMessage;
+        key = std::hash<std::string>()(name != nullptr ? name : "") | (1ull << 32);
+    }
+
+    uint64_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        MessageStats& stats = mMessages[key];
+        if (stats.count == 0)
+        {
+            stats.name = pCallbackData->pMessageIdName != nullptr ? pCallbackData->pMessageIdName : "(unnamed)";
+            stats.severity = severity;
+        }
+        count = ++stats.count;
+        if (count > mMaxRepeats)
+        {
+            ++mSuppressed;
+            return;
+        }
+    }
+
+    if (count == mMaxRepeats)
+    {
+        logger.validation("[Validation Layer] %s", pCallbackData->pMessage);
+        logger.validation("[Validation Layer] (seen %u times, further copies are only counted)", mMaxRepeats);
+    }
+    else
+    {
+        logger.validation("[Validation Layer] %s", pCallbackData->pMessage);
+    }
+}
+
+void ValidationFilter::SetSeverityMask(VkDebugUtilsMessageSeverityFlagsEXT severityMask)
+{
+    mSeverityMask = severityMask;
+}
+
+VkDebugUtilsMessageSeverityFlagsEXT ValidationFilter::GetSeverityMask() const
+{
+    return mSeverityMask;
+}
+
+VkDebugUtilsMessageSeverityFlagsEXT ValidationFilter::CycleSeverity()
+{
+    const VkDebugUtilsMessageSeverityFlagsEXT ERRORS = VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    const VkDebugUtilsMessageSeverityFlagsEXT WARNINGS = ERRORS | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+    const VkDebugUtilsMessageSeverityFlagsEXT INFO = WARNINGS | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT;
+    const VkDebugUtilsMessageSeverityFlagsEXT VERBOSE = INFO | VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+
+    VkDebugUtilsMessageSeverityFlagsEXT mask = mSeverityMask;
+    if (mask & VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT)
+    {
+        mask = ERRORS;
+    }
+    else if (mask & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT)
+    {
+        mask = VERBOSE;
+    }
+    else if (mask & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+    {
+        mask = INFO;
+    }
+    else
+    {
+        mask = WARNINGS;
+    }
+    mSeverityMask = mask;
+    return mask;
+}
+
+const char* ValidationFilter::GetSeverityName(VkDebugUtilsMessageSeverityFlagsEXT severityMask)
+{
+    // named after the least severe level that gets through.
+    if (severityMask & VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT)
+    {
+        return "verbose and up";
+    }
+    if (severityMask & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT)
+    {
+        return "info and up";
+    }
+    if (severityMask & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+    {
+        return "warnings and errors";
+    }
+    if (severityMask & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+    {
+        return "errors only";
+    }
+    return "nothing";
+}
+
+void ValidationFilter::Report(bool final)
+{
+    struct Line
+    {
+        std::string name;
+        uint64_t count;
+    };
+    std::vector<Line> lines;
+    uint64_t suppressed = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        suppressed = mSuppressed;
+        mSuppressed = 0;
+        if (!final && suppressed == 0)
+        {
+            return;
+        }
+        for (auto& entry : mMessages)
+        {
+            MessageStats& stats = entry.second;
+            uint64_t count = final ? stats.count : stats.count - stats.reportedCount;
+            stats.reportedCount = stats.count;
+            if (count > 0)
+            {
+                lines.push_back({ stats.name, count });
+            }
+        }
+    }
+    if (lines.empty())
+    {
+        return;
+    }
+
+    std::sort(lines.begin(), lines.end(), [](const Line& a, const Line& b) { return a.count > b.count; });
+    if (final)
+    {
+        logger.validation("[Validation Layer] %zu distinct messages this run:", lines.size());
+    }
+    else
+    {
+        logger.validation("[Validation Layer] %llu repeats suppressed since the last report. Most frequent since then:", (unsigned long long)suppressed);
+    }
+    for (size_t i = 0, count = (std::min)(lines.size(), REPORT_TOP_COUNT); i < count; ++i)
+    {
+        logger.validation("    %8llu  %s", (unsigned long long)lines[i].count, lines[i].name.c_str());
+    }
+    if (lines.size() > REPORT_TOP_COUNT)
+    {
+        logger.validation("    ...and %zu more.", lines.size() - REPORT_TOP_COUNT);
+    }
+}
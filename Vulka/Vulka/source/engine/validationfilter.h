@@ -0,0 +1,74 @@
+#ifndef _VALIDATION_FILTER_H_
+#define _VALIDATION_FILTER_H_
+
+#include "vulkanloader.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+typedef struct ValidationFilterInfo {
+    VkDebugUtilsMessageSeverityFlagsEXT severityMask;   // severities that get through at all
+    uint32_t maxRepeats;                                // copies of one message printed before it's only counted
+    double reportInterval;                              // seconds between suppression summaries. 0 = only at shutdown
+} ValidationFilterInfo;
+
+/*
+Sits between the debug messenger and the logger so a validation error that fires
+every draw doesn't turn into thousands of console writes per frame.
+
+Messages are keyed by messageIdNumber (or a hash of the id name when the layer
+doesn't give a number). The first maxRepeats copies of each are logged; after that
+they're only counted, and Update() logs a summary of what was suppressed every
+reportInterval seconds. Shutdown() logs totals for everything seen.
+
+Submit() is safe to call from any thread, which matters because the layers call
+back on whatever thread made the Vulkan call.
+*/
+class ValidationFilter
+{
+public:
+    void Initialize(ValidationFilterInfo* validationFilterInfo);
+    void Shutdown();
+
+    /*
+    Call once per frame from the main thread.
+    */
+    void Update();
+
+    void Submit(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData);
+
+    void SetSeverityMask(VkDebugUtilsMessageSeverityFlagsEXT severityMask);
+    VkDebugUtilsMessageSeverityFlagsEXT GetSeverityMask() const;
+
+    /*
+    Step the mask down to the next least severe level, wrapping back to errors only.
+    Returns the new mask.
+    */
+    VkDebugUtilsMessageSeverityFlagsEXT CycleSeverity();
+
+    static const char* GetSeverityName(VkDebugUtilsMessageSeverityFlagsEXT severityMask);
+
+private:
+    struct MessageStats
+    {
+        std::string name;
+        VkDebugUtilsMessageSeverityFlagBitsEXT severity;
+        uint64_t count = 0;
+        uint64_t reportedCount = 0;     // count at the last summary
+    };
+
+    void Report(bool final);
+
+    std::atomic<uint32_t> mSeverityMask;
+    uint32_t mMaxRepeats = 0;
+    double mReportInterval = 0.0;
+    std::chrono::steady_clock::time_point mLastReport;
+
+    std::mutex mMutex;
+    std::unordered_map<uint64_t, MessageStats> mMessages;
+    uint64_t mSuppressed = 0;           // since the last summary
+};
+
+#endif _VALIDATION_FILTER_H_
@@ -0,0 +1,95 @@
+#include "vkutil.h"
+#include "logger.h"
+
+bool TryFindMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t* pMemoryTypeIndex)
+{
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+    for (uint32_t i = 0, count = memProperties.memoryTypeCount; i < count; ++i)
+    {
+        if (typeFilter & (1 << i) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            *pMemoryTypeIndex = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t FindMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+{
+    uint32_t memoryTypeIndex = 0;
+    if (!TryFindMemoryType(physicalDevice, typeFilter, properties, &memoryTypeIndex))
+    {
+        logger.throw_error("failed to find suitable memory type.");
+    }
+    return memoryTypeIndex;
+}
+
+void CreateBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, MemoryCategory category, VkBuffer* pBuffer, VkDeviceMemory* pMemory)
+{
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, pBuffer) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to create a buffer.");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, *pBuffer, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = FindMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, pMemory) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to allocate buffer memory.");
+    }
+    memoryBudget.TrackAllocation(*pMemory, allocInfo.memoryTypeIndex, allocInfo.allocationSize, category);
+
+    vkBindBufferMemory(device, *pBuffer, *pMemory, 0);
+}
+
+void CreateImage(VkPhysicalDevice physicalDevice, VkDevice device, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, MemoryCategory category, VkImage* pImage, VkDeviceMemory* pMemory)
+{
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = format;
+    imageInfo.extent = { extent.width, extent.height, 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = usage;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(device, &imageInfo, nullptr, pImage) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to create an image.");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, *pImage, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = FindMemoryType(physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, pMemory) != VK_SUCCESS)
+    {
+        logger.throw_error("failed to allocate image memory.");
+    }
+    memoryBudget.TrackAllocation(*pMemory, allocInfo.memoryTypeIndex, allocInfo.allocationSize, category);
+
+    vkBindImageMemory(device, *pImage, *pMemory, 0);
+}
@@ -0,0 +1,48 @@
+#ifndef _VKUTIL_H_
+#define _VKUTIL_H_
+
+#include "memorybudget.h"
+#include "vulkanloader.h"
+
+/*
+Small helpers shared by Game and the engine systems that own Vulkan memory.
+*/
+
+/*
+Find a memory type that matches typeFilter and has all of the requested properties.
+Returns false if nothing matches.
+*/
+bool TryFindMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t* pMemoryTypeIndex);
+
+/*
+Same as TryFindMemoryType() but throws if nothing matches.
+*/
+uint32_t FindMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+/*
+Create an exclusive buffer with memory of its own, allocated from the first type that has all of
+properties and tracked in memoryBudget under category. Throws on failure.
+Free with vkDestroyBuffer, memoryBudget.TrackFree and vkFreeMemory (or the deletion queue).
+*/
+void CreateBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, MemoryCategory category, VkBuffer* pBuffer, VkDeviceMemory* pMemory);
+
+/*
+Create an exclusive, optimally tiled 2D image with one mip level and one layer in device local memory
+of its own, tracked in memoryBudget under category. It starts out in VK_IMAGE_LAYOUT_UNDEFINED. Throws on failure.
+Free with vkDestroyImage, memoryBudget.TrackFree and vkFreeMemory.
+*/
+void CreateImage(VkPhysicalDevice physicalDevice, VkDevice device, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, MemoryCategory category, VkImage* pImage, VkDeviceMemory* pMemory);
+
+/*
+Round value up to the next multiple of alignment. alignment must be a power of two (or zero).
+*/
+inline VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    if (alignment == 0)
+    {
+        return value;
+    }
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+#endif _VKUTIL_H_
@@ -0,0 +1,51 @@
+#include "vulkanloader.h"
+#include "logger.h"
+
+#define VULKA_DEFINE_FUNCTION(name) PFN_##name name = nullptr;
+PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr = nullptr;
+VULKA_GLOBAL_FUNCTIONS(VULKA_DEFINE_FUNCTION)
+VULKA_INSTANCE_FUNCTIONS(VULKA_DEFINE_FUNCTION)
+VULKA_DEVICE_FUNCTIONS(VULKA_DEFINE_FUNCTION)
+#undef VULKA_DEFINE_FUNCTION
+
+void LoadVulkanGlobalFunctions(PFN_vkGetInstanceProcAddr getInstanceProcAddr)
+{
+    if (getInstanceProcAddr == nullptr)
+    {
+        logger.throw_error("vkGetInstanceProcAddr not found. Is the Vulkan runtime installed?");
+    }
+    vkGetInstanceProcAddr = getInstanceProcAddr;
+
+#define VULKA_LOAD_FUNCTION(name) name = (PFN_##name)vkGetInstanceProcAddr(VK_NULL_HANDLE, #name);
+    VULKA_GLOBAL_FUNCTIONS(VULKA_LOAD_FUNCTION)
+#undef VULKA_LOAD_FUNCTION
+
+    if (vkCreateInstance == nullptr)
+    {
+        logger.throw_error("failed to load the global Vulkan functions.");
+    }
+}
+
+void LoadVulkanInstanceFunctions(VkInstance instance)
+{
+#define VULKA_LOAD_FUNCTION(name) name = (PFN_##name)vkGetInstanceProcAddr(instance, #name);
+    VULKA_INSTANCE_FUNCTIONS(VULKA_LOAD_FUNCTION)
+#undef VULKA_LOAD_FUNCTION
+
+    if (vkGetDeviceProcAddr == nullptr)
+    {
+        logger.throw_error("failed to load the instance Vulkan functions.");
+    }
+}
+
+void LoadVulkanDeviceFunctions(VkDevice device)
+{
+#define VULKA_LOAD_FUNCTION(name) name = (PFN_##name)vkGetDeviceProcAddr(device, #name);
+    VULKA_DEVICE_FUNCTIONS(VULKA_LOAD_FUNCTION)
+#undef VULKA_LOAD_FUNCTION
+
+    if (vkQueueSubmit == nullptr)
+    {
+        logger.throw_error("failed to load the device Vulkan functions.");
+    }
+}
@@ -0,0 +1,153 @@
+#ifndef _VULKAN_LOADER_H_
+#define _VULKAN_LOADER_H_
+
+// the project defines VK_NO_PROTOTYPES, so vulkan.h only gives us the types.
+// every entry point below is a function pointer with the same name as the real function,
+// which keeps call sites looking exactly like plain vulkan.
+#ifndef VK_NO_PROTOTYPES
+#error "Vulka must be built with VK_NO_PROTOTYPES defined (see the project's preprocessor definitions)."
+#endif
+#include <vulkan/vulkan.h>
+
+/*
+The dispatch table, as X-macro lists. Anything the engine calls has to be listed here,
+under the level it gets loaded at:
+  - global: no instance needed, loaded through vkGetInstanceProcAddr(NULL, ...).
+  - instance: loaded once the instance exists.
+  - device: loaded straight from the driver with vkGetDeviceProcAddr once the device exists,
+    so hot-path calls (command recording, submits) skip the loader's trampolines.
+Entry points from extensions or newer core versions load as NULL when unavailable;
+check before calling them.
+*/
+#define VULKA_GLOBAL_FUNCTIONS(X) \
+    X(vkCreateInstance) \
+    X(vkEnumerateInstanceExtensionProperties) \
+    X(vkEnumerateInstanceLayerProperties)
+
+#define VULKA_INSTANCE_FUNCTIONS(X) \
+    X(vkCreateDevice) \
+    X(vkDestroyInstance) \
+    X(vkDestroySurfaceKHR) \
+    X(vkEnumerateDeviceExtensionProperties) \
+    X(vkEnumeratePhysicalDevices) \
+    X(vkGetDeviceProcAddr) \
+    X(vkGetPhysicalDeviceFeatures) \
+    X(vkGetPhysicalDeviceFeatures2) \
+    X(vkGetPhysicalDeviceFormatProperties) \
+    X(vkGetPhysicalDeviceMemoryProperties) \
+    X(vkGetPhysicalDeviceMemoryProperties2) \
+    X(vkGetPhysicalDeviceProperties) \
+    X(vkGetPhysicalDeviceQueueFamilyProperties) \
+    X(vkGetPhysicalDeviceSurfaceCapabilitiesKHR) \
+    X(vkGetPhysicalDeviceSurfaceFormatsKHR) \
+    X(vkGetPhysicalDeviceSurfacePresentModesKHR) \
+    X(vkGetPhysicalDeviceSurfaceSupportKHR)
+
+#define VULKA_DEVICE_FUNCTIONS(X) \
+    X(vkAcquireNextImageKHR) \
+    X(vkAllocateCommandBuffers) \
+    X(vkAllocateDescriptorSets) \
+    X(vkAllocateMemory) \
+    X(vkBeginCommandBuffer) \
+    X(vkBindBufferMemory) \
+    X(vkBindImageMemory) \
+    X(vkCmdBeginRenderPass) \
+    X(vkCmdBeginRenderingKHR) \
+    X(vkCmdBindDescriptorSets) \
+    X(vkCmdBindPipeline) \
+    X(vkCmdBindVertexBuffers) \
+    X(vkCmdCopyBuffer) \
+    X(vkCmdCopyBufferToImage) \
+    X(vkCmdDispatch) \
+    X(vkCmdDispatchIndirect) \
+    X(vkCmdDraw) \
+    X(vkCmdDrawIndirect) \
+    X(vkCmdEndRenderPass) \
+    X(vkCmdEndRenderingKHR) \
+    X(vkCmdFillBuffer) \
+    X(vkCmdPipelineBarrier) \
+    X(vkCmdPushConstants) \
+    X(vkCmdResetQueryPool) \
+    X(vkCmdSetScissor) \
+    X(vkCmdSetViewport) \
+    X(vkCmdWriteTimestamp) \
+    X(vkCreateBuffer) \
+    X(vkCreateCommandPool) \
+    X(vkCreateComputePipelines) \
+    X(vkCreateDescriptorPool) \
+    X(vkCreateDescriptorSetLayout) \
+    X(vkCreateFence) \
+    X(vkCreateFramebuffer) \
+    X(vkCreateGraphicsPipelines) \
+    X(vkCreateImage) \
+    X(vkCreateImageView) \
+    X(vkCreatePipelineLayout) \
+    X(vkCreateQueryPool) \
+    X(vkCreateRenderPass) \
+    X(vkCreateSampler) \
+    X(vkCreateSemaphore) \
+    X(vkCreateShaderModule) \
+    X(vkCreateSwapchainKHR) \
+    X(vkDestroyBuffer) \
+    X(vkDestroyCommandPool) \
+    X(vkDestroyDescriptorPool) \
+    X(vkDestroyDescriptorSetLayout) \
+    X(vkDestroyDevice) \
+    X(vkDestroyFence) \
+    X(vkDestroyFramebuffer) \
+    X(vkDestroyImage) \
+    X(vkDestroyImageView) \
+    X(vkDestroyPipeline) \
+    X(vkDestroyPipelineLayout) \
+    X(vkDestroyQueryPool) \
+    X(vkDestroyRenderPass) \
+    X(vkDestroySampler) \
+    X(vkDestroySemaphore) \
+    X(vkDestroyShaderModule) \
+    X(vkDestroySwapchainKHR) \
+    X(vkDeviceWaitIdle) \
+    X(vkEndCommandBuffer) \
+    X(vkFreeCommandBuffers) \
+    X(vkFreeMemory) \
+    X(vkGetBufferMemoryRequirements) \
+    X(vkGetDeviceQueue) \
+    X(vkGetImageMemoryRequirements) \
+    X(vkGetQueryPoolResults) \
+    X(vkGetSemaphoreCounterValue) \
+    X(vkGetSwapchainImagesKHR) \
+    X(vkMapMemory) \
+    X(vkQueuePresentKHR) \
+    X(vkQueueSubmit) \
+    X(vkQueueWaitIdle) \
+    X(vkResetCommandBuffer) \
+    X(vkResetFences) \
+    X(vkUnmapMemory) \
+    X(vkUpdateDescriptorSets) \
+    X(vkWaitForFences) \
+    X(vkWaitSemaphores)
+
+#define VULKA_DECLARE_FUNCTION(name) extern PFN_##name name;
+extern PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr;
+VULKA_GLOBAL_FUNCTIONS(VULKA_DECLARE_FUNCTION)
+VULKA_INSTANCE_FUNCTIONS(VULKA_DECLARE_FUNCTION)
+VULKA_DEVICE_FUNCTIONS(VULKA_DECLARE_FUNCTION)
+#undef VULKA_DECLARE_FUNCTION
+
+/*
+Load the global entry points. getInstanceProcAddr comes from whoever found the Vulkan
+library (glfw, for us). Throws if it's missing.
+*/
+void LoadVulkanGlobalFunctions(PFN_vkGetInstanceProcAddr getInstanceProcAddr);
+
+/*
+Load the instance-level entry points for instance.
+*/
+void LoadVulkanInstanceFunctions(VkInstance instance);
+
+/*
+Load the device-level entry points for device, bypassing the loader's dispatch.
+There's only ever one device, so the table is global rather than per-device.
+*/
+void LoadVulkanDeviceFunctions(VkDevice device);
+
+#endif _VULKAN_LOADER_H_
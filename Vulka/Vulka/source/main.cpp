@@ -4,9 +4,13 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <map>
 #include <optional>
@@ -14,17 +18,119 @@
 #include <stdexcept>
 #include <vector>
 
+#include "engine/asynccompute.h"
+#include "engine/benchmark.h"
+#include "engine/culling.h"
+#include "engine/deletionqueue.h"
+#include "engine/entitystore.h"
+#include "engine/framecapture.h"
+#include "engine/hud.h"
 #include "engine/input.h"
 #include "engine/logger.h"
+#include "engine/memorybudget.h"
+#include "engine/particlesystem.h"
+#include "engine/pipelinelibrary.h"
+#include "engine/pipelinevariants.h"
+#include "engine/profiler.h"
+#include "engine/rendergraph.h"
+#include "engine/scenesystems.h"
+#include "engine/spritebatch.h"
+#include "engine/transferqueue.h"
+#include "engine/transformhierarchy.h"
+#include "engine/uploadring.h"
+#include "engine/validationfilter.h"
+#include "engine/vkutil.h"
+#include "engine/vulkanloader.h"
+
+// process memory counters for benchmark results.
+#include <psapi.h>
 
 const int WINDOW_WIDTH = 1024;
 const int WINDOW_HEIGHT = 768;
 
+// warn once a memory heap gets this close to its budget.
+const float MEMORY_BUDGET_WARNING_THRESHOLD = 0.9f;
+
 const int VERSION_MAJOR = 0;
 const int VERSION_MINOR = 1;
 const int VERSION_PATCH = 0;
 
-const int MAX_FRAMES_IN_FLIGHT = 2;
+// how many frames the cpu may queue up ahead of the gpu. more hides cpu spikes, fewer means less latency.
+// the actual count is picked at startup (see GameSettings::framesInFlight).
+const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+const uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+// world matrices the vertex shader can see in one frame, through the storage binding. enough for the instancing
+// scene. shared with the replayer, which has to bind as many for every captured instance to find its matrix.
+const uint32_t MAX_DRAW_INSTANCES = FRAME_CAPTURE_MAX_INSTANCES;
+const VkDeviceSize INSTANCE_STORAGE_RANGE = FRAME_CAPTURE_INSTANCE_RANGE;
+static_assert(FRAME_CAPTURE_INSTANCE_RANGE == FRAME_CAPTURE_MAX_INSTANCES * sizeof(glm::mat4), "one mat4 per instance");
+// bytes of per-frame data each frame in flight can push through the upload ring: the uniforms, then the
+// world matrices. the binding's range is fixed, so the frame has room for all of it past the uniforms.
+const VkDeviceSize UPLOAD_RING_FRAME_SIZE = INSTANCE_STORAGE_RANGE + 64 * 1024;
+// staging space for the transfer queue. the benchmark grid (the biggest upload) fits in one piece.
+const VkDeviceSize TRANSFER_STAGING_SIZE = 16 * 1024 * 1024;
+
+// benchmark scenes. every scene renders a fixed amount of work so runs can be compared across builds and machines.
+// the frames before measurement starts let pipelines, caches and swapchain recreation settle.
+const uint32_t BENCHMARK_WARMUP_FRAMES = 30;
+const uint32_t BENCHMARK_SMALL_DRAW_COUNT = 10000;
+const uint32_t BENCHMARK_INSTANCE_COUNT = 100000;
+static_assert(BENCHMARK_INSTANCE_COUNT <= MAX_DRAW_INSTANCES, "every instance needs its world matrix");
+// the large vertex buffer is a grid of small triangles, one per cell, covering the screen.
+const uint32_t BENCHMARK_GRID_SIZE = 512;
+const uint32_t BENCHMARK_RESIZE_INTERVAL = 10;
+// the entity scene scatters this many triangles over twice the view in x and y, so most of them get culled.
+const uint32_t BENCHMARK_ENTITY_COUNT = 200000;
+const uint32_t BENCHMARK_ENTITY_MATERIALS = 4;
+// entities hang off pivots in groups of this many. only the first few pivots spin, the rest of the scene stays put.
+const uint32_t BENCHMARK_ENTITY_GROUP_SIZE = 100;
+const uint32_t BENCHMARK_MOVING_GROUPS = 20;
+// the sprite scene moves every sprite every frame, spread over a couple of layers and textures.
+const uint32_t BENCHMARK_SPRITE_COUNT = 100000;
+const uint32_t BENCHMARK_SPRITE_LAYERS = 2;
+const uint32_t BENCHMARK_SPRITE_TEXTURES = 4;
+
+// sprites per frame. their vertices get a streaming ring of their own, sized for this many.
+const uint32_t SPRITE_MAX_PER_FRAME = 131072;
+
+// the overlay shares the sprite ring. a few thousand quads is plenty for its text and graph.
+const uint32_t HUD_MAX_QUADS = 4096;
+const uint32_t HUD_HISTORY_FRAMES = 120;
+
+// entity slots reserved when the scene is created.
+const uint32_t SCENE_INITIAL_CAPACITY = 1024;
+
+// --cull-benchmark: spheres per run, and runs per path/thread combination after the warmup ones.
+const uint32_t CULL_BENCHMARK_OBJECTS = 1000000;
+const uint32_t CULL_BENCHMARK_WARMUP_RUNS = 5;
+const uint32_t CULL_BENCHMARK_RUNS = 50;
+
+// profiler limits. a zone is ~24 bytes, so a million per thread covers a long session.
+const uint32_t PROFILER_MAX_EVENTS_PER_THREAD = 1000000;
+const uint32_t PROFILER_MAX_GPU_ZONES_PER_FRAME = 64;
+
+enum BenchmarkScene
+{
+    BENCHMARK_SCENE_NONE,
+    BENCHMARK_SCENE_SMALL_DRAWS,
+    BENCHMARK_SCENE_INSTANCING,
+    BENCHMARK_SCENE_LARGE_VERTEX_BUFFER,
+    BENCHMARK_SCENE_ENTITIES,
+    BENCHMARK_SCENE_SPRITES,
+    BENCHMARK_SCENE_RESIZE_STORM,
+    BENCHMARK_SCENE_COUNT
+};
+
+const char* const benchmarkSceneNames[BENCHMARK_SCENE_COUNT] = {
+    "none",
+    "small-draws",
+    "instancing",
+    "large-vertex-buffer",
+    "entities",
+    "sprites",
+    "resize-storm"
+};
 
 const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
@@ -66,6 +172,10 @@ struct QueueFamilyIndices
 {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    // only set when the device has a transfer-only family (usually dedicated DMA/copy engines).
+    std::optional<uint32_t> transferFamily;
+    // only set when the device has a compute family that can't do graphics, so compute can run alongside raster work.
+    std::optional<uint32_t> computeFamily;
 
     bool isComplete()
     {
@@ -118,11 +228,117 @@ const std::vector<Vertex> vertices = {
     { { -0.5f, 0.5f }, { 0.0f, 0.0f, 1.0f } }
 };
 
+// fields of a PipelineVariantKey, in the order initPipelineVariants() declares them.
+enum PipelineField
+{
+    PIPELINE_FIELD_PASS,
+    PIPELINE_FIELD_VERTEX_COLOR,
+    PIPELINE_FIELD_COLOR_LEVELS
+};
+
+// the fixed function setup a variant is built for.
+enum PipelinePass
+{
+    PIPELINE_PASS_SHADING,
+    PIPELINE_PASS_DEPTH_PREPASS,
+    PIPELINE_PASS_SPRITES,
+    PIPELINE_PASS_HUD,          // the overlay's own pass: one sample, no depth
+    PIPELINE_PASS_PARTICLES     // particle.vert, one instance per particle
+};
+
+static_assert(sizeof(SpriteVertex) == sizeof(Vertex) && offsetof(SpriteVertex, color) == offsetof(Vertex, color), "sprites use the main vertex layout");
+
+// per-frame data visible to every shader through set 0, binding 0 (a dynamic uniform buffer).
+// layout matches std140 so it can be mirrored 1:1 in glsl:
+//     layout(set = 0, binding = 0) uniform FrameUniforms { mat4 viewProj; vec4 time; } frame;
+struct FrameUniforms
+{
+    glm::mat4 viewProj;
+    glm::vec4 time; // x = seconds since startup, y = delta seconds, z = frame number
+};
+
+// a range of vertices the scene's MeshComponent::mesh indices point at.
+struct SceneMesh
+{
+    VkBuffer buffer;
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+};
+
+// fixed seed xorshift for the benchmarks, so every run generates the same scene. returns [0, 1):
+// the top 24 bits are exactly representable in a float, so it can never round up to 1.
+struct BenchmarkRandom
+{
+    uint32_t state;
+
+    explicit BenchmarkRandom(uint32_t seed) : state(seed) {}
+
+    float operator()()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return (state >> 8) * (1.0f / 16777216.0f);
+    }
+};
+
+// no TransformComponent: renderables are placed through the transform hierarchy.
+const ComponentMask RENDERABLE_COMPONENTS =
+    ComponentBit(COMPONENT_WORLD_MATRIX) |
+    ComponentBit(COMPONENT_BOUNDS) | ComponentBit(COMPONENT_WORLD_BOUNDS) |
+    ComponentBit(COMPONENT_MESH) | ComponentBit(COMPONENT_MATERIAL);
+
+// everything that can be changed from the command line. see parseSettings() at the bottom.
+struct GameSettings
+{
+    // lay down depth for the whole scene first, then shade with an EQUAL depth test so
+    // every pixel runs the fragment shader at most once. worth it once overdraw gets heavy.
+    bool depthPrepass = false;
+    // requested msaa sample count (1, 2, 4 or 8). clamped to what the device can do.
+    uint32_t msaaSamples = 1;
+    // 1 to MAX_FRAMES_IN_FLIGHT.
+    uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+    // validation messages that get through the filter. can also be cycled at runtime (F2).
+    VkDebugUtilsMessageSeverityFlagsEXT validationSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    // copies of the same validation message that get printed before it's only counted.
+    uint32_t validationMaxRepeats = 5;
+    // run every benchmark scene for benchmarkFrames measured frames, write the results and exit.
+    bool benchmark = false;
+    uint32_t benchmarkFrames = 500;
+    std::string benchmarkOutput = "benchmark.json";
+    // chrome trace of cpu and gpu zones for the whole run. empty means the profiler stays off.
+    std::string profileOutput;
+    // record the render commands of the first captureFrames frames for VulkaReplay. empty means off.
+    std::string captureOutput;
+    uint32_t captureFrames = 60;
+    // frames between gpu memory reports. 0 only reports on exit; F3 prints one any time.
+    uint32_t memoryReportInterval = 0;
+    // show the performance overlay from the start. F4 toggles it either way.
+    bool hud = false;
+    // snap the scene's colors to this many steps per channel (1 to 15), compiled into the shader
+    // as a specialization constant. 0 is off.
+    uint32_t colorLevels = 0;
+    // most gpu particles alive at once (a fountain in the middle of the screen). 0 is off.
+    uint32_t particles = 0;
+    // link pipeline variants from VK_EXT_graphics_pipeline_library parts where the device has it.
+    // off forces the monolithic path, e.g. to compare the two.
+    bool pipelineLibrary = true;
+    // time frustum culling on every simd path with and without threads, write the results and exit. no window or device.
+    bool cullBenchmark = false;
+};
+
 class Game
 {
 public:
+    Game(const GameSettings& settings) : mSettings(settings)
+    {
+        mFramesInFlight = (std::min)((std::max)(settings.framesInFlight, 1u), MAX_FRAMES_IN_FLIGHT);
+    }
+
     void run()
     {
+        initProfiler();
+        initCapture();
         logger.vulkawarn(" ... VULKA IS WARMING UP ... ");
         initWindow();
         initInput();
@@ -131,10 +347,41 @@ public:
         mainLoop();
         logger.vulkawarn(" ... VULKA IS SHUTTING DOWN ... ");
         cleanup();
+        profiler.Shutdown();
         logger.vulkawarn(" ... VULKA IS OFFLINE ... ");
     }
 
 private:
+    void initProfiler()
+    {
+        if (mSettings.profileOutput.empty())
+        {
+            return;
+        }
+
+        ProfilerInfo profilerInfo = {};
+        profilerInfo.outputPath = mSettings.profileOutput;
+        profilerInfo.maxEventsPerThread = PROFILER_MAX_EVENTS_PER_THREAD;
+        profiler.Initialize(&profilerInfo);
+        profiler.SetThreadName("main");
+    }
+
+    /*
+    Armed before any Vulkan object exists so every buffer and pipeline a captured frame uses is in the file.
+    */
+    void initCapture()
+    {
+        if (mSettings.captureOutput.empty())
+        {
+            return;
+        }
+
+        FrameCaptureInfo captureInfo = {};
+        captureInfo.path = mSettings.captureOutput;
+        captureInfo.frameCount = mSettings.captureFrames;
+        mCapture.Initialize(&captureInfo);
+    }
+
     void initWindow()
     {
         glfwInit();
@@ -157,28 +404,114 @@ private:
 
         mInput.AddKeybinding('JUMP', GLFW_KEY_SPACE);
         mInput.AddKeybinding('EXIT', GLFW_KEY_ESCAPE);
+        mInput.AddKeybinding('VSEV', GLFW_KEY_F2);
+        mInput.AddKeybinding('MEMR', GLFW_KEY_F3);
+        mInput.AddKeybinding('HUD_', GLFW_KEY_F4);
+        mInput.AddKeybinding('VCOL', GLFW_KEY_F5);
     }
 
     void initVulkan()
     {
-        createInstance();
-        setupDebugCallback();
-        createSurface();
-        pickPhysicalDevice();
-        createLogicalDevice();
-        createSwapChain();
-        createImageViews();
-        createRenderPass();
-        createGraphicsPipeline();
-        createFramebuffers();
-        createCommandPool();
-        createVertexBuffer();
-        createCommandBuffers();
-        createSyncObjects();
+        auto initStart = std::chrono::steady_clock::now();
+
+        // shader bytecode doesn't need vulkan at all, so start reading it before the instance even exists.
+        mShaderLoad = std::async(std::launch::async, [this]
+        {
+            profiler.SetThreadName("shader load");
+            loadShaderCode();
+        });
+
+        timeStage("createInstance", [this] { createInstance(); });
+        timeStage("setupDebugCallback", [this] { setupDebugCallback(); });
+        timeStage("createSurface", [this] { createSurface(); });
+        timeStage("pickPhysicalDevice", [this] { pickPhysicalDevice(); });
+        timeStage("createLogicalDevice", [this] { createLogicalDevice(); });
+        timeStage("initMemoryBudget", [this] { initMemoryBudget(); });
+        timeStage("createDeletionQueue", [this] { createDeletionQueue(); });
+        timeStage("createSwapChain", [this] { createSwapChain(); });
+        timeStage("createImageViews", [this] { createImageViews(); });
+        timeStage("createRenderPass", [this] { createRenderPass(); });
+        timeStage("createDescriptorSetLayout", [this] { createDescriptorSetLayout(); });
+        timeStage("initPipelineVariants", [this] { initPipelineVariants(); });
+
+        // pipeline compile is the slowest step by far, and it only needs the device, render pass
+        // and set layout. everything below runs on this thread while the driver compiles.
+        // nothing below may touch the pipeline or its layout until the join.
+        double pipelineMs = 0.0;
+        std::future<void> pipelineBuild = std::async(std::launch::async, [this, &pipelineMs]
+        {
+            profiler.SetThreadName("pipeline build");
+            auto begin = std::chrono::steady_clock::now();
+            createGraphicsPipeline();
+            pipelineMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        });
+
+        timeStage("createRenderGraph", [this] { createRenderGraph(); });
+        timeStage("createFramebuffers", [this] { createFramebuffers(); });
+        timeStage("createCommandPool", [this] { createCommandPool(); });
+        timeStage("createTransferQueue", [this] { createTransferQueue(); });
+        timeStage("createAsyncCompute", [this] { createAsyncCompute(); });
+        // the upload itself runs on the transfer queue; the first frame's submit is what waits for it.
+        timeStage("createVertexBuffer", [this] { createVertexBuffer(); });
+        timeStage("createScene", [this] { createScene(); });
+        timeStage("createUploadRing", [this] { createUploadRing(); });
+        timeStage("createParticles", [this] { createParticles(); });
+        timeStage("createSpriteBatch", [this] { createSpriteBatch(); });
+        timeStage("createHud", [this] { createHud(); });
+        timeStage("createDescriptorPool", [this] { createDescriptorPool(); });
+        timeStage("createDescriptorSet", [this] { createDescriptorSet(); });
+        timeStage("createCommandBuffers", [this] { createCommandBuffers(); });
+        timeStage("createSyncObjects", [this] { createSyncObjects(); });
+        timeStage("initProfilerGpu", [this] { initProfilerGpu(); });
+
+        // rethrows anything the worker threw.
+        timeStage("waitForPipelines", [&pipelineBuild] { pipelineBuild.get(); });
+        mStartupTimings.push_back({ "createGraphicsPipeline (worker)", pipelineMs });
+
+        logger.debug("Startup timings:");
+        for (const auto& timing : mStartupTimings)
+        {
+            logger.debug("    %-34s %8.2f ms", timing.first.c_str(), timing.second);
+        }
+        logger.debug("Vulkan initialized in %.2f ms.", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - initStart).count());
+    }
+
+    /*
+    Run one init step and remember how long it took. The timings are logged together
+    at the end of initVulkan() so they aren't lost between the creation messages.
+    */
+    void timeStage(const char* name, const std::function<void()>& stage)
+    {
+        PROFILE_ZONE(name);
+        auto begin = std::chrono::steady_clock::now();
+        stage();
+        mStartupTimings.push_back({ name, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() });
+    }
+
+    void loadShaderCode()
+    {
+        PROFILE_FUNCTION();
+        mVertShaderCode = readFile("Shader/vert.spv");
+        mSpriteVertShaderCode = readFile("Shader/sprite_vert.spv");
+        mFragShaderCode = readFile("Shader/frag.spv");
+        mHudVertShaderCode = readFile("Shader/hud_vert.spv");
+        mHudFragShaderCode = readFile("Shader/hud_frag.spv");
+        if (mSettings.particles > 0)
+        {
+            mParticleVertShaderCode = readFile("Shader/particle_vert.spv");
+        }
     }
 
     void createInstance()
     {
+        // nothing links against the vulkan prototypes, so bootstrap through glfw,
+        // which already found the vulkan library.
+        if (!glfwVulkanSupported())
+        {
+            logger.throw_error("Vulkan runtime not found. Terminating.");
+        }
+        LoadVulkanGlobalFunctions((PFN_vkGetInstanceProcAddr)glfwGetInstanceProcAddress(VK_NULL_HANDLE, "vkGetInstanceProcAddr"));
+
         if (enableValidationLayers && !checkValidationSupport())
         {
             logger.throw_error("validation layers requested but not available!");
@@ -190,7 +523,8 @@ private:
         appInfo.applicationVersion = VK_MAKE_VERSION(VERSION_MAJOR, VERSION_MINOR, VERSION_PATCH);
         appInfo.pEngineName = "No Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_1;
+        // 1.2 for timeline semaphores. devices that only do 1.1 still work; we just check before using 1.2 features.
+        appInfo.apiVersion = VK_API_VERSION_1_2;
         
         // this struct is required
         VkInstanceCreateInfo createInfo = {};
@@ -216,6 +550,7 @@ private:
         switch (result)
         {
         case VK_SUCCESS:
+            LoadVulkanInstanceFunctions(mInstance);
             logger.debug("Vulkan instance created.");
             break;
         case VK_ERROR_INCOMPATIBLE_DRIVER:
@@ -234,16 +569,24 @@ private:
             return;
         }
 
+        ValidationFilterInfo validationFilterInfo = {};
+        validationFilterInfo.severityMask = mSettings.validationSeverity;
+        validationFilterInfo.maxRepeats = mSettings.validationMaxRepeats;
+        validationFilterInfo.reportInterval = 10.0;
+        mValidationFilter.Initialize(&validationFilterInfo);
+
+        // the messenger asks for everything; the filter decides what gets through so it can change at runtime.
         VkDebugUtilsMessengerCreateInfoEXT createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
         createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT
+                                     | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT
                                      | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT
                                      | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
         createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT
                                  | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT
                                  | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
         createInfo.pfnUserCallback = debugCallback;
-        createInfo.pUserData = nullptr; // Optional
+        createInfo.pUserData = &mValidationFilter;
 
         if (CreateDebugUtilsMessengerEXT(mInstance, &createInfo, nullptr, &mCallback) != VK_SUCCESS)
         {
@@ -304,7 +647,9 @@ private:
         QueueFamilyIndices indices = findQueueFamilies(mPhysicalDevice);
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+        uint32_t transferFamily = indices.transferFamily.value_or(indices.graphicsFamily.value());
+        uint32_t computeFamily = indices.computeFamily.value_or(indices.graphicsFamily.value());
+        std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value(), transferFamily, computeFamily };
 
         float queuePriority = 1.f;
         for (uint32_t queueFamily : uniqueQueueFamilies)
@@ -320,14 +665,58 @@ private:
 
         VkPhysicalDeviceFeatures deviceFeatures = {};
 
+        // optional features get pushed onto the front of this chain as we find them.
+        void* pFeatureChain = nullptr;
+        std::vector<const char*> enabledExtensions(deviceExtensions.begin(), deviceExtensions.end());
+
+        mTimelineSemaphoresSupported = checkTimelineSemaphoreSupport(mPhysicalDevice);
+        VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+        vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        vulkan12Features.timelineSemaphore = mTimelineSemaphoresSupported ? VK_TRUE : VK_FALSE;
+        if (mTimelineSemaphoresSupported)
+        {
+            vulkan12Features.pNext = pFeatureChain;
+            pFeatureChain = &vulkan12Features;
+        }
+
+        mUseDynamicRendering = checkDynamicRenderingSupport(mPhysicalDevice);
+        VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = {};
+        dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+        dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+        if (mUseDynamicRendering)
+        {
+            dynamicRenderingFeatures.pNext = pFeatureChain;
+            pFeatureChain = &dynamicRenderingFeatures;
+            enabledExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+        }
+
+        mUsePipelineLibrary = mSettings.pipelineLibrary && checkGraphicsPipelineLibrarySupport(mPhysicalDevice);
+        VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures = {};
+        pipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+        pipelineLibraryFeatures.graphicsPipelineLibrary = VK_TRUE;
+        if (mUsePipelineLibrary)
+        {
+            pipelineLibraryFeatures.pNext = pFeatureChain;
+            pFeatureChain = &pipelineLibraryFeatures;
+            enabledExtensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+            enabledExtensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+        }
+
+        mMemoryBudgetSupported = checkDeviceExtensionSupport(mPhysicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        if (mMemoryBudgetSupported)
+        {
+            enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
+
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext = pFeatureChain;
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pEnabledFeatures = &deviceFeatures;
 
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+        createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
         if (enableValidationLayers)
         {
@@ -343,9 +732,34 @@ private:
         {
             logger.throw_error("Failed to create logical device!");
         }
+        // everything from here on calls straight into the driver.
+        LoadVulkanDeviceFunctions(mDevice);
 
         vkGetDeviceQueue(mDevice, indices.graphicsFamily.value(), 0, &mGraphicsQueue);
         vkGetDeviceQueue(mDevice, indices.presentFamily.value(), 0, &mPresentationQueue);
+        vkGetDeviceQueue(mDevice, transferFamily, 0, &mTransferQueue);
+        vkGetDeviceQueue(mDevice, computeFamily, 0, &mComputeQueue);
+
+        if (mUseDynamicRendering)
+        {
+            if (vkCmdBeginRenderingKHR == nullptr || vkCmdEndRenderingKHR == nullptr)
+            {
+                logger.warn("VK_KHR_dynamic_rendering enabled but its entry points are missing. Using render passes.");
+                mUseDynamicRendering = false;
+            }
+        }
+        logger.debug("Rendering path: %s.", mUseDynamicRendering ? "dynamic rendering" : "render pass + framebuffers");
+        logger.debug("Pipeline creation: %s.", mUsePipelineLibrary ? "linked from pipeline libraries" : "monolithic");
+
+        mDepthFormat = findDepthFormat();
+        logger.debug("Depth format: %d. Depth pre-pass: %s.", mDepthFormat, mSettings.depthPrepass ? "on" : "off");
+
+        mMsaaSamples = chooseMsaaSamples(mSettings.msaaSamples);
+        if (mMsaaSamples != mSettings.msaaSamples)
+        {
+            logger.warn("%ux MSAA requested but the device only supports up to %ux. Using %ux.", mSettings.msaaSamples, mMsaaSamples, mMsaaSamples);
+        }
+        logger.debug("MSAA: %ux.", mMsaaSamples);
 
         logger.debug("Logical device created.");
     }
@@ -356,6 +770,7 @@ private:
         VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
         mSwapchainImageFormat = surfaceFormat.format;
         VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+        mPresentMode = presentMode;
         mSwapchainExtent = chooseSwapExtent(swapChainSupport.capabilities);
 
         uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
@@ -396,12 +811,16 @@ private:
         createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
         createInfo.presentMode = presentMode;
         createInfo.clipped = VK_TRUE;
-        createInfo.oldSwapchain = VK_NULL_HANDLE;
+        // handing over the old swapchain lets the driver reuse its images and keeps presentation going during a resize.
+        VkSwapchainKHR oldSwapchain = mSwapchain;
+        createInfo.oldSwapchain = oldSwapchain;
 
         if (vkCreateSwapchainKHR(mDevice, &createInfo, nullptr, &mSwapchain) != VK_SUCCESS)
         {
             logger.throw_error("failed to create swap chain!");
         }
+        // frames still in flight may have images from the old one acquired.
+        mDeletionQueue.DestroySwapchain(oldSwapchain);
 
         // the swapchain was created with minImageCount set, but it could have used something larger, so we must query the count again.
         vkGetSwapchainImagesKHR(mDevice, mSwapchain, &imageCount, nullptr);
@@ -413,7 +832,9 @@ private:
  
     void recreateSwapChain()
     {
+        PROFILE_FUNCTION();
         logger.debug("Recreating swapchain.");
+        ++mSwapchainRecreateCount;
 
         int width = 0, height = 0;
         while (width == 0 || height == 0)
@@ -421,16 +842,25 @@ private:
             glfwGetFramebufferSize(pWindow, &width, &height);
             glfwWaitEvents();
         }
-        vkDeviceWaitIdle(mDevice);
+        // no vkDeviceWaitIdle: everything that frames in flight might still use goes through
+        // the deletion queue and is destroyed once those frames have completed.
 
         cleanupSwapChain();
 
         createSwapChain();
         createImageViews();
-        createRenderPass();
-        createGraphicsPipeline();
+        // viewport and scissor are dynamic, so neither the render passes nor the pipelines depend on
+        // the extent. a resize only rebuilds what's sized to the swapchain: its views, the graph's
+        // transient images and the framebuffers.
+        if (mSwapchainImageFormat != mRenderPassFormat || mMsaaSamples != mRenderPassSamples)
+        {
+            cleanupPipeline();
+            createRenderPass();
+            createGraphicsPipeline();
+        }
+        // the framebuffers need the depth view, which the graph owns.
+        createRenderGraph();
         createFramebuffers();
-        createCommandBuffers();
 
         logger.debug("Swapchain recreated. Width: %d - Height: %d", width, height);
     }
@@ -467,70 +897,275 @@ private:
 
     void createRenderPass()
     {
+        // what the render passes and every pipeline were built for. a swapchain with anything else needs new ones.
+        mRenderPassFormat = mSwapchainImageFormat;
+        mRenderPassSamples = mMsaaSamples;
+
+        if (mUseDynamicRendering)
+        {
+            // attachments are described at record time instead.
+            mRenderPass = VK_NULL_HANDLE;
+            mHudRenderPass = VK_NULL_HANDLE;
+            return;
+        }
+
+        // with msaa, attachment 0 is the multisampled target and the swapchain image is only
+        // ever written by the resolve at the end of the subpass. the samples themselves never get stored.
+        bool multisampled = mMsaaSamples != VK_SAMPLE_COUNT_1_BIT;
+
         VkAttachmentDescription colorAttachment = {};
         colorAttachment.format = mSwapchainImageFormat;
-        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        colorAttachment.samples = mMsaaSamples;
         colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.storeOp = multisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        // the render graph moves the image in and out of this layout (and handles
+        // the wait on the acquire), so the render pass itself doesn't transition anything.
+        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        // depth only lives for the length of the pass, so it's never stored.
+        VkAttachmentDescription depthAttachment = {};
+        depthAttachment.format = mDepthFormat;
+        depthAttachment.samples = mMsaaSamples;
+        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
         VkAttachmentReference colorAttachmentRef = {};
         colorAttachmentRef.attachment = 0;
         colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+        VkAttachmentReference depthAttachmentRef = {};
+        depthAttachmentRef.attachment = 1;
+        depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentDescription resolveAttachment = {};
+        resolveAttachment.format = mSwapchainImageFormat;
+        resolveAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        resolveAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        resolveAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        resolveAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        resolveAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        resolveAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        resolveAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentReference resolveAttachmentRef = {};
+        resolveAttachmentRef.attachment = 2;
+        resolveAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        // the pre-pass and the shading pass share this one subpass; they're just two pipelines
+        // drawn back to back, so depth stays on chip in between.
         VkSubpassDescription subpass = {};
         subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
         subpass.colorAttachmentCount = 1;
         subpass.pColorAttachments = &colorAttachmentRef;
+        subpass.pDepthStencilAttachment = &depthAttachmentRef;
+        subpass.pResolveAttachments = multisampled ? &resolveAttachmentRef : nullptr;
 
-        VkSubpassDependency dependency = {};
-        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-        dependency.dstSubpass = 0;
-        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.srcAccessMask = 0;
-        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
+        std::vector<VkAttachmentDescription> attachments = { colorAttachment, depthAttachment };
+        if (multisampled)
+        {
+            attachments.push_back(resolveAttachment);
+        }
         VkRenderPassCreateInfo renderPassInfo = {};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-        renderPassInfo.attachmentCount = 1;
-        renderPassInfo.pAttachments = &colorAttachment;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
         renderPassInfo.subpassCount = 1;
         renderPassInfo.pSubpasses = &subpass;
-        renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies = &dependency;
+        renderPassInfo.dependencyCount = 0; // external dependencies come from the render graph's barriers
+        renderPassInfo.pDependencies = nullptr;
 
         if (vkCreateRenderPass(mDevice, &renderPassInfo, nullptr, &mRenderPass) != VK_SUCCESS) {
             logger.throw_error("failed to create render pass!");
         }
 
-        logger.debug("Render pass created.");
+        // the hud is drawn over the finished (already resolved) swapchain image, so it loads
+        // what the main pass stored and needs neither depth nor samples.
+        VkAttachmentDescription hudAttachment = {};
+        hudAttachment.format = mSwapchainImageFormat;
+        hudAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        hudAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        hudAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        hudAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        hudAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        hudAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        hudAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        VkSubpassDescription hudSubpass = {};
+        hudSubpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        hudSubpass.colorAttachmentCount = 1;
+        hudSubpass.pColorAttachments = &colorAttachmentRef;
+
+        renderPassInfo.attachmentCount = 1;
+        renderPassInfo.pAttachments = &hudAttachment;
+        renderPassInfo.pSubpasses = &hudSubpass;
+
+        if (vkCreateRenderPass(mDevice, &renderPassInfo, nullptr, &mHudRenderPass) != VK_SUCCESS) {
+            logger.throw_error("failed to create the hud render pass!");
+        }
+
+        logger.debug("Render passes created.");
+    }
+
+    void initPipelineVariants()
+    {
+        // every variant of the scene shaders. the pass is fixed function state, the rest are
+        // constant_ids in shader.frag.
+        PipelineVariantsInfo pipelineVariantsInfo = {};
+        pipelineVariantsInfo.fields = {
+            { "pass", 3, PIPELINE_VARIANT_NO_CONSTANT, PIPELINE_PASS_SHADING },
+            { "vertexColor", 1, 0, 1 },
+            { "colorLevels", 4, 1, 0 }
+        };
+        pipelineVariantsInfo.create = [this](PipelineVariantKey key, const VkSpecializationInfo* pSpecialization)
+        {
+            return createPipelineVariant(key, pSpecialization);
+        };
+        pipelineVariantsInfo.destroy = [this](VkPipeline pipeline)
+        {
+            mCapture.DestroyPipeline(pipeline);
+            mDeletionQueue.DestroyPipeline(pipeline);
+        };
+        mPipelineVariants.Initialize(&pipelineVariantsInfo);
+
+        if (mUsePipelineLibrary)
+        {
+            PipelineLibraryInfo pipelineLibraryInfo = {};
+            pipelineLibraryInfo.device = mDevice;
+            mPipelineLibrary.Initialize(&pipelineLibraryInfo);
+        }
+    }
+
+    PipelineVariantKey getShadingVariant() const
+    {
+        PipelineVariantKey key = mPipelineVariants.GetDefaultKey();
+        key = mPipelineVariants.With(key, PIPELINE_FIELD_VERTEX_COLOR, mVertexColor ? 1 : 0);
+        return mPipelineVariants.With(key, PIPELINE_FIELD_COLOR_LEVELS, mSettings.colorLevels);
     }
 
     void createGraphicsPipeline()
     {
-        VkShaderModule vertShaderModule = createShaderModule(readFile("Shader/vert.spv"));
-        VkShaderModule fragShaderModule = createShaderModule(readFile("Shader/frag.spv"));
+        PROFILE_FUNCTION();
+        // only the first build ever waits here; after that the bytecode is kept around for rebuilds.
+        if (mShaderLoad.valid())
+        {
+            mShaderLoad.get();
+        }
+        // kept for as long as the variants are, so one asked for later can still be created.
+        mVertShaderModule = createShaderModule(mVertShaderCode);
+        mFragShaderModule = createShaderModule(mFragShaderCode);
+        mSpriteVertShaderModule = createShaderModule(mSpriteVertShaderCode);
+        mHudVertShaderModule = createShaderModule(mHudVertShaderCode);
+        mHudFragShaderModule = createShaderModule(mHudFragShaderCode);
+        if (mSettings.particles > 0)
+        {
+            mParticleVertShaderModule = createShaderModule(mParticleVertShaderCode);
+        }
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &mDescriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
+        pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
+
+        if (vkCreatePipelineLayout(mDevice, &pipelineLayoutInfo, nullptr, &mPipelineLayout) != VK_SUCCESS) {
+            logger.throw_error("failed to create pipeline layout!");
+        }
+
+        // everything the game can switch to without a rebuild: both vertex color settings, so F5
+        // never waits on the driver, the pre-pass if it's on, the sprites and the hud.
+        PipelineVariantKey shadingKey = getShadingVariant();
+        PipelineVariantKey spriteKey = mPipelineVariants.With(mPipelineVariants.GetDefaultKey(), PIPELINE_FIELD_PASS, PIPELINE_PASS_SPRITES);
+        PipelineVariantKey hudKey = mPipelineVariants.With(mPipelineVariants.GetDefaultKey(), PIPELINE_FIELD_PASS, PIPELINE_PASS_HUD);
+        std::vector<PipelineVariantKey> keys = {
+            mPipelineVariants.With(shadingKey, PIPELINE_FIELD_VERTEX_COLOR, 1),
+            mPipelineVariants.With(shadingKey, PIPELINE_FIELD_VERTEX_COLOR, 0),
+            spriteKey,
+            hudKey
+        };
+        PipelineVariantKey prepassKey = mPipelineVariants.With(shadingKey, PIPELINE_FIELD_PASS, PIPELINE_PASS_DEPTH_PREPASS);
+        if (mSettings.depthPrepass)
+        {
+            keys.push_back(prepassKey);
+        }
+        PipelineVariantKey particleKey = mPipelineVariants.With(mPipelineVariants.GetDefaultKey(), PIPELINE_FIELD_PASS, PIPELINE_PASS_PARTICLES);
+        if (mSettings.particles > 0)
+        {
+            keys.push_back(particleKey);
+        }
+        mPipelineVariants.Prebuild(keys);
+
+        mGraphicsPipeline = mPipelineVariants.Get(shadingKey);
+        mDepthPrepassPipeline = mSettings.depthPrepass ? mPipelineVariants.Get(prepassKey) : VK_NULL_HANDLE;
+        mSpritePipeline = mPipelineVariants.Get(spriteKey);
+        mHudPipeline = mPipelineVariants.Get(hudKey);
+        mParticlePipeline = mSettings.particles > 0 ? mPipelineVariants.Get(particleKey) : VK_NULL_HANDLE;
+
+        logger.debug("Graphics pipeline created.");
+    }
+
+    /*
+    One pipeline for one variant key. Called by mPipelineVariants, both from Prebuild() and for
+    a variant first asked for later.
+    */
+    VkPipeline createPipelineVariant(PipelineVariantKey key, const VkSpecializationInfo* pSpecialization)
+    {
+        uint32_t pass = mPipelineVariants.GetField(key, PIPELINE_FIELD_PASS);
+        // sprites and the hud are built in clip space, so they have a vertex shader of their own.
+        // the hud's also carries atlas uvs, for a fragment shader of its own.
+        bool clipSpace = pass == PIPELINE_PASS_SPRITES || pass == PIPELINE_PASS_HUD;
 
         VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
         vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-        vertShaderStageInfo.module = vertShaderModule;
+        vertShaderStageInfo.module = clipSpace ? mSpriteVertShaderModule : mVertShaderModule;
+        if (pass == PIPELINE_PASS_PARTICLES)
+        {
+            vertShaderStageInfo.module = mParticleVertShaderModule;
+        }
+        else if (pass == PIPELINE_PASS_HUD)
+        {
+            vertShaderStageInfo.module = mHudVertShaderModule;
+        }
         vertShaderStageInfo.pName = "main";
+        vertShaderStageInfo.pSpecializationInfo = pSpecialization;
 
         VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
         fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        fragShaderStageInfo.module = fragShaderModule;
+        fragShaderStageInfo.module = pass == PIPELINE_PASS_HUD ? mHudFragShaderModule : mFragShaderModule;
         fragShaderStageInfo.pName = "main";
+        fragShaderStageInfo.pSpecializationInfo = pSpecialization;
 
         VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
-        auto bindingDescription = Vertex::getBindingDescription();
-        auto attributeDescriptions = Vertex::getAttributeDescriptions();
+        // particles are read per instance straight out of the simulation's buffer.
+        VkVertexInputBindingDescription bindingDescription = Vertex::getBindingDescription();
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+        if (pass == PIPELINE_PASS_PARTICLES)
+        {
+            auto particleAttributes = ParticleSystem::GetAttributeDescriptions();
+            bindingDescription = ParticleSystem::GetBindingDescription();
+            attributeDescriptions.assign(particleAttributes.begin(), particleAttributes.end());
+        }
+        else if (pass == PIPELINE_PASS_HUD)
+        {
+            auto hudAttributes = Hud::GetAttributeDescriptions();
+            bindingDescription = Hud::GetBindingDescription();
+            attributeDescriptions.assign(hudAttributes.begin(), hudAttributes.end());
+        }
+        else
+        {
+            auto vertexAttributes = Vertex::getAttributeDescriptions();
+            attributeDescriptions.assign(vertexAttributes.begin(), vertexAttributes.end());
+        }
 
         VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -556,6 +1191,13 @@ private:
         scissor.offset = {0, 0};
         scissor.extent = mSwapchainExtent;
 
+        // viewport and scissor are set while recording so a resize doesn't need a new pipeline.
+        std::array<VkDynamicState, 2> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+        VkPipelineDynamicStateCreateInfo dynamicStateInfo = {};
+        dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+        dynamicStateInfo.pDynamicStates = dynamicStates.data();
+
         VkPipelineViewportStateCreateInfo viewportStateInfo = {};
         viewportStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
         viewportStateInfo.viewportCount = 1;
@@ -579,12 +1221,22 @@ private:
         VkPipelineMultisampleStateCreateInfo multisamplingInfo = {};
         multisamplingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
         multisamplingInfo.sampleShadingEnable = VK_FALSE;
-        multisamplingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+        multisamplingInfo.rasterizationSamples = pass == PIPELINE_PASS_HUD ? VK_SAMPLE_COUNT_1_BIT : mMsaaSamples;
         multisamplingInfo.minSampleShading = 1.0f; // optional
         multisamplingInfo.pSampleMask = nullptr; // optional
         multisamplingInfo.alphaToCoverageEnable = VK_FALSE; // optional
         multisamplingInfo.alphaToOneEnable = VK_FALSE; // optional
 
+        // with a pre-pass, depth is already final by the time we shade, so only the
+        // front-most fragment passes EQUAL and nothing needs writing.
+        VkPipelineDepthStencilStateCreateInfo depthStencilInfo = {};
+        depthStencilInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depthStencilInfo.depthTestEnable = VK_TRUE;
+        depthStencilInfo.depthWriteEnable = mSettings.depthPrepass ? VK_FALSE : VK_TRUE;
+        depthStencilInfo.depthCompareOp = mSettings.depthPrepass ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS;
+        depthStencilInfo.depthBoundsTestEnable = VK_FALSE;
+        depthStencilInfo.stencilTestEnable = VK_FALSE;
+
         VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
         colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
         colorBlendAttachment.blendEnable = VK_FALSE;
@@ -595,6 +1247,25 @@ private:
         colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO; // optional
         colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD; // optional
 
+        uint32_t stageCount = 2;
+        if (pass == PIPELINE_PASS_DEPTH_PREPASS)
+        {
+            // same vertex stage and layout, no fragment shader and no color writes.
+            // the vertex shader has to be the one the shading pass uses or EQUAL won't match.
+            depthStencilInfo.depthWriteEnable = VK_TRUE;
+            depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+            colorBlendAttachment.colorWriteMask = 0;
+            stageCount = 1;
+        }
+        else if (clipSpace || pass == PIPELINE_PASS_PARTICLES)
+        {
+            // sprites (and the hud, and particles) are flat and drawn back to front in submission order, so no depth at all.
+            // no culling either, so mirrored sprites (negative size) still show.
+            depthStencilInfo.depthTestEnable = VK_FALSE;
+            depthStencilInfo.depthWriteEnable = VK_FALSE;
+            rasterizerInfo.cullMode = VK_CULL_MODE_NONE;
+        }
+
         VkPipelineColorBlendStateCreateInfo colorBlendInfo = {};
         colorBlendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
         colorBlendInfo.logicOpEnable = VK_FALSE;
@@ -606,66 +1277,116 @@ private:
         colorBlendInfo.blendConstants[2] = 0.0f; // optional
         colorBlendInfo.blendConstants[3] = 0.0f; // optional
 
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 0; // Optional
-        pipelineLayoutInfo.pSetLayouts = nullptr; // Optional
-        pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-        pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
-
-        if (vkCreatePipelineLayout(mDevice, &pipelineLayoutInfo, nullptr, &mPipelineLayout) != VK_SUCCESS) {
-            logger.throw_error("failed to create pipeline layout!");
-        }
-        logger.debug("Fixed function pipeline setup.");
-
         VkGraphicsPipelineCreateInfo pipelineInfo = {};
         pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineInfo.stageCount = 2;
+        pipelineInfo.stageCount = stageCount;
         pipelineInfo.pStages = shaderStages;
         pipelineInfo.pVertexInputState = &vertexInputInfo;
         pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
         pipelineInfo.pViewportState = &viewportStateInfo;
         pipelineInfo.pRasterizationState = &rasterizerInfo;
         pipelineInfo.pMultisampleState = &multisamplingInfo;
-        pipelineInfo.pDepthStencilState = nullptr; // optional
+        pipelineInfo.pDepthStencilState = &depthStencilInfo;
         pipelineInfo.pColorBlendState = &colorBlendInfo;
-        pipelineInfo.pDynamicState = nullptr; // optional
+        pipelineInfo.pDynamicState = &dynamicStateInfo;
         pipelineInfo.layout = mPipelineLayout;
-        pipelineInfo.renderPass = mRenderPass;
+        pipelineInfo.renderPass = pass == PIPELINE_PASS_HUD ? mHudRenderPass : mRenderPass;
         pipelineInfo.subpass = 0;
+
+        // with dynamic rendering the pipeline only needs to know the attachment formats.
+        VkPipelineRenderingCreateInfoKHR renderingInfo = {};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachmentFormats = &mSwapchainImageFormat;
+        renderingInfo.depthAttachmentFormat = mDepthFormat;
+        renderingInfo.stencilAttachmentFormat = hasStencilComponent(mDepthFormat) ? mDepthFormat : VK_FORMAT_UNDEFINED;
+        if (pass == PIPELINE_PASS_HUD)
+        {
+            renderingInfo.depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+            renderingInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+        }
+        if (mUseDynamicRendering)
+        {
+            pipelineInfo.pNext = &renderingInfo;
+            pipelineInfo.renderPass = VK_NULL_HANDLE;
+        }
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // optional
         pipelineInfo.basePipelineIndex = -1; // optional
 
-        if (vkCreateGraphicsPipelines(mDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &mGraphicsPipeline) != VK_SUCCESS)
+        VkPipeline pipeline;
+        if (mUsePipelineLibrary)
         {
-            logger.throw_error("failed to create graphics pipeline!");
+            // particles and the hud have vertex layouts of their own. the pass decides the vertex shader, cull mode,
+            // depth state, color writes and the render pass; the shading and pre-pass passes share their
+            // pre-rasterization state. the constants only reach the fragment shader (the vertex shaders
+            // declare none), so only that part sees the whole key.
+            uint32_t vertexInput = pass == PIPELINE_PASS_PARTICLES ? 1 : (pass == PIPELINE_PASS_HUD ? 2 : 0);
+            uint32_t sharedPass = pass == PIPELINE_PASS_DEPTH_PREPASS ? PIPELINE_PASS_SHADING : pass;
+            uint32_t partKeys[PIPELINE_LIBRARY_PART_COUNT] = { vertexInput, sharedPass, key, pass };
+            pipeline = mPipelineLibrary.Create(pipelineInfo, partKeys);
+        }
+        else if (vkCreateGraphicsPipelines(mDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create graphics pipeline (%s)!", mPipelineVariants.Describe(key).c_str());
         }
 
-        logger.debug("Graphics pipeline created.");
-
-        // cleanup now that the pipeline is created.
-        // ...the fact that this one function has a section for cleanup
-        // heavily implies this should be in its own class.
-        vkDestroyShaderModule(mDevice, vertShaderModule, nullptr);
-        vkDestroyShaderModule(mDevice, fragShaderModule, nullptr);
+        // what the replayer needs to rebuild this pipeline. ignored unless a capture is recording.
+        FrameCapturePipelineDesc captureDesc = {};
+        captureDesc.vertexStride = bindingDescription.stride;
+        captureDesc.attributeCount = static_cast<uint32_t>(attributeDescriptions.size());
+        std::copy(attributeDescriptions.begin(), attributeDescriptions.end(), captureDesc.attributes);
+        captureDesc.topology = inputAssemblyInfo.topology;
+        captureDesc.cullMode = rasterizerInfo.cullMode;
+        captureDesc.frontFace = rasterizerInfo.frontFace;
+        captureDesc.depthTest = depthStencilInfo.depthTestEnable;
+        captureDesc.depthWrite = depthStencilInfo.depthWriteEnable;
+        captureDesc.depthCompareOp = depthStencilInfo.depthCompareOp;
+        captureDesc.colorWriteMask = colorBlendAttachment.colorWriteMask;
+        captureDesc.samples = mMsaaSamples;
+        captureDesc.colorFormat = mSwapchainImageFormat;
+        captureDesc.depthFormat = mDepthFormat;
+        // the variants only ever use 32-bit constants, packed in entry order.
+        captureDesc.constantCount = (std::min)(pSpecialization->mapEntryCount, FRAME_CAPTURE_MAX_CONSTANTS);
+        for (uint32_t i = 0; i < captureDesc.constantCount; ++i)
+        {
+            captureDesc.constantIds[i] = pSpecialization->pMapEntries[i].constantID;
+            memcpy(&captureDesc.constantValues[i], static_cast<const char*>(pSpecialization->pData) + pSpecialization->pMapEntries[i].offset, sizeof(uint32_t));
+        }
+        // particles and the hud are never captured (see recordParticles() and recordHudPass()).
+        if (pass != PIPELINE_PASS_PARTICLES && pass != PIPELINE_PASS_HUD)
+        {
+            mCapture.CreatePipeline(pipeline, captureDesc, clipSpace ? mSpriteVertShaderCode : mVertShaderCode, stageCount == 2 ? &mFragShaderCode : nullptr);
+        }
 
-        logger.debug("Graphics pipeline creation cleaned up.");
+        return pipeline;
     }
 
     void createFramebuffers()
     {
+        if (mUseDynamicRendering)
+        {
+            return;
+        }
+
         mSwapchainFramebuffers.resize(mSwapchainImageViews.size());
 
         for (size_t i = 0, count = mSwapchainImageViews.size(); i < count; i++) {
-            VkImageView attachments[] = {
-                mSwapchainImageViews[i]
-            };
+            // same order as the render pass: color, depth, then the resolve target when multisampled.
+            std::vector<VkImageView> attachments;
+            if (mMsaaColorResource != RENDER_GRAPH_INVALID_RESOURCE)
+            {
+                attachments = { mRenderGraph.GetImageView(mMsaaColorResource), mRenderGraph.GetImageView(mDepthResource), mSwapchainImageViews[i] };
+            }
+            else
+            {
+                attachments = { mSwapchainImageViews[i], mRenderGraph.GetImageView(mDepthResource) };
+            }
 
             VkFramebufferCreateInfo framebufferInfo = {};
             framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
             framebufferInfo.renderPass = mRenderPass;
-            framebufferInfo.attachmentCount = 1;
-            framebufferInfo.pAttachments = attachments;
+            framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+            framebufferInfo.pAttachments = attachments.data();
             framebufferInfo.width = mSwapchainExtent.width;
             framebufferInfo.height = mSwapchainExtent.height;
             framebufferInfo.layers = 1;
@@ -675,16 +1396,136 @@ private:
             }
         }
 
+        // the hud pass only ever touches the swapchain image.
+        mHudFramebuffers.resize(mSwapchainImageViews.size());
+        for (size_t i = 0, count = mSwapchainImageViews.size(); i < count; i++) {
+            VkFramebufferCreateInfo framebufferInfo = {};
+            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass = mHudRenderPass;
+            framebufferInfo.attachmentCount = 1;
+            framebufferInfo.pAttachments = &mSwapchainImageViews[i];
+            framebufferInfo.width = mSwapchainExtent.width;
+            framebufferInfo.height = mSwapchainExtent.height;
+            framebufferInfo.layers = 1;
+
+            if (vkCreateFramebuffer(mDevice, &framebufferInfo, nullptr, &mHudFramebuffers[i]) != VK_SUCCESS) {
+                logger.throw_error("failed to create a hud framebuffer!");
+            }
+        }
+
         logger.debug("Framebuffers created.");
     }
 
+    void createRenderGraph()
+    {
+        QueueFamilyIndices indices = findQueueFamilies(mPhysicalDevice);
+        uint32_t graphicsFamily = indices.graphicsFamily.value();
+
+        RenderGraphImportInfo swapchainInfo = {};
+        swapchainInfo.format = mSwapchainImageFormat;
+        swapchainInfo.extent = mSwapchainExtent;
+        swapchainInfo.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+        // whatever was presented last time around is never needed again.
+        swapchainInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        // the image available semaphore is waited on at this stage, so the first barrier has to chain off it.
+        swapchainInfo.initialStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        swapchainInfo.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        mSwapchainResource = mRenderGraph.ImportImage("swapchain", &swapchainInfo);
+
+        // depth never leaves the main pass, so on tilers it doesn't need real memory at all.
+        RenderGraphImageDesc depthDesc = {};
+        depthDesc.format = mDepthFormat;
+        depthDesc.extent = mSwapchainExtent;
+        depthDesc.samples = mMsaaSamples;
+        depthDesc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencilComponent(mDepthFormat) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+        depthDesc.extraUsage = 0;
+        depthDesc.lazilyAllocated = true;
+        mDepthResource = mRenderGraph.CreateImage("depth", &depthDesc);
+
+        // the multisampled color target is resolved into the swapchain before the pass ends,
+        // so like depth it only has to exist in tile memory.
+        mMsaaColorResource = RENDER_GRAPH_INVALID_RESOURCE;
+        if (mMsaaSamples != VK_SAMPLE_COUNT_1_BIT)
+        {
+            RenderGraphImageDesc colorDesc = {};
+            colorDesc.format = mSwapchainImageFormat;
+            colorDesc.extent = mSwapchainExtent;
+            colorDesc.samples = mMsaaSamples;
+            colorDesc.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+            colorDesc.extraUsage = 0;
+            colorDesc.lazilyAllocated = true;
+            mMsaaColorResource = mRenderGraph.CreateImage("msaa color", &colorDesc);
+        }
+
+        uint32_t mainPass = mRenderGraph.AddPass("main", [this](VkCommandBuffer commandBuffer, const RenderGraph& graph)
+        {
+            recordMainPass(commandBuffer);
+        });
+        mRenderGraph.Use(mainPass, mSwapchainResource, RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT);
+        mRenderGraph.Use(mainPass, mDepthResource, RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT);
+        if (mMsaaColorResource != RENDER_GRAPH_INVALID_RESOURCE)
+        {
+            mRenderGraph.Use(mainPass, mMsaaColorResource, RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT);
+        }
+
+        // the simulation's output comes over from the compute queue (see createParticles()) and goes back after the draw.
+        mParticleResource = RENDER_GRAPH_INVALID_RESOURCE;
+        mParticleStateResource = RENDER_GRAPH_INVALID_RESOURCE;
+        if (mSettings.particles > 0)
+        {
+            RenderGraphBufferImportInfo particleInfo = {};
+            // the submit waits for the compute queue here.
+            particleInfo.initialStage = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+            particleInfo.acquireFamily = indices.computeFamily.value_or(graphicsFamily);
+            particleInfo.releaseFamily = particleInfo.acquireFamily;
+            mParticleResource = mRenderGraph.ImportBuffer("particles", &particleInfo);
+            mParticleStateResource = mRenderGraph.ImportBuffer("particle state", &particleInfo);
+            mRenderGraph.Use(mainPass, mParticleResource, RENDER_GRAPH_ACCESS_VERTEX_READ);
+            mRenderGraph.Use(mainPass, mParticleStateResource, RENDER_GRAPH_ACCESS_INDIRECT_READ);
+        }
+
+        // the overlay goes over whatever main left in the swapchain, so msaa and the pre-pass never see it.
+        uint32_t hudPass = mRenderGraph.AddPass("hud", [this](VkCommandBuffer commandBuffer, const RenderGraph& graph)
+        {
+            recordHudPass(commandBuffer);
+        });
+        mRenderGraph.Use(hudPass, mSwapchainResource, RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT);
+
+        RenderGraphCompileInfo compileInfo = {};
+        compileInfo.physicalDevice = mPhysicalDevice;
+        compileInfo.device = mDevice;
+        compileInfo.queueFamily = graphicsFamily;
+        mRenderGraph.Compile(&compileInfo);
+    }
+
+    /*
+    Before anything allocates device memory, so every allocation is accounted for.
+    */
+    void initMemoryBudget()
+    {
+        MemoryBudgetInfo memoryBudgetInfo = {};
+        memoryBudgetInfo.physicalDevice = mPhysicalDevice;
+        memoryBudgetInfo.useBudgetExtension = mMemoryBudgetSupported;
+        memoryBudgetInfo.warningThreshold = MEMORY_BUDGET_WARNING_THRESHOLD;
+        memoryBudgetInfo.reportInterval = mSettings.memoryReportInterval;
+        memoryBudget.Initialize(&memoryBudgetInfo);
+    }
+
+    void createDeletionQueue()
+    {
+        DeletionQueueInfo deletionQueueInfo = {};
+        deletionQueueInfo.device = mDevice;
+        mDeletionQueue.Initialize(&deletionQueueInfo);
+    }
+
     void createCommandPool()
     {
         QueueFamilyIndices queueFamilyIndices = findQueueFamilies(mPhysicalDevice);
         VkCommandPoolCreateInfo poolInfo = {};
         poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-        poolInfo.flags = 0; // optional
+        // command buffers are re-recorded every frame, so each one needs to be individually resettable.
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
         if (vkCreateCommandPool(mDevice, &poolInfo, nullptr, &mCommandPool))
         {
@@ -694,151 +1535,1380 @@ private:
         logger.debug("Command pool created.");
     }
 
-    void createVertexBuffer()
+    void createTransferQueue()
+    {
+        QueueFamilyIndices indices = findQueueFamilies(mPhysicalDevice);
+
+        TransferQueueInfo transferQueueInfo = {};
+        transferQueueInfo.physicalDevice = mPhysicalDevice;
+        transferQueueInfo.device = mDevice;
+        transferQueueInfo.transferQueue = mTransferQueue;
+        transferQueueInfo.transferFamily = indices.transferFamily.value_or(indices.graphicsFamily.value());
+        transferQueueInfo.graphicsFamily = indices.graphicsFamily.value();
+        transferQueueInfo.useTimelineSemaphore = mTimelineSemaphoresSupported;
+        transferQueueInfo.stagingSize = TRANSFER_STAGING_SIZE;
+        mTransfer.Initialize(&transferQueueInfo);
+    }
+
+    void createAsyncCompute()
     {
-        VkBufferCreateInfo bufferInfo = {};
-        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        bufferInfo.size = sizeof(vertices[0]) * vertices.size();
-        bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        QueueFamilyIndices indices = findQueueFamilies(mPhysicalDevice);
+
+        AsyncComputeInfo asyncComputeInfo = {};
+        asyncComputeInfo.device = mDevice;
+        asyncComputeInfo.computeQueue = mComputeQueue;
+        asyncComputeInfo.computeFamily = indices.computeFamily.value_or(indices.graphicsFamily.value());
+        asyncComputeInfo.graphicsFamily = indices.graphicsFamily.value();
+        asyncComputeInfo.frameCount = mFramesInFlight;
+        asyncComputeInfo.useTimelineSemaphore = mTimelineSemaphoresSupported;
+        mAsyncCompute.Initialize(&asyncComputeInfo);
+    }
+
+    /*
+    Register work to run on the async compute queue every frame.
+    record is called with the compute command buffer; consumerStage is the first
+    graphics stage that reads what it produces, which is where the graphics submit waits.
+    */
+    void addComputeJob(std::function<void(VkCommandBuffer)> record, VkPipelineStageFlags consumerStage)
+    {
+        mComputeJobs.push_back({ record, consumerStage });
+    }
 
-        if (vkCreateBuffer(mDevice, &bufferInfo, nullptr, &mVertexBuffer) != VK_SUCCESS)
+    void createParticles()
+    {
+        if (mSettings.particles == 0)
         {
-            logger.throw_error("failed to create vertex buffer.");
+            return;
         }
-        
-        VkMemoryRequirements memRequirements;
-        vkGetBufferMemoryRequirements(mDevice, mVertexBuffer, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        // the pipeline worker owns mShaderLoad, so this one is read here.
+        std::vector<char> computeShaderCode = readFile("Shader/particle_comp.spv");
+
+        // emitting a steady stream that, at an average life of 3 seconds, just about fills the buffer.
+        ParticleSystemInfo particleSystemInfo = {};
+        particleSystemInfo.physicalDevice = mPhysicalDevice;
+        particleSystemInfo.device = mDevice;
+        particleSystemInfo.maxParticles = mSettings.particles;
+        particleSystemInfo.emitPerSecond = mSettings.particles / 3.0f;
+        particleSystemInfo.pComputeShaderCode = &computeShaderCode;
+        mParticles.Initialize(&particleSystemInfo);
+        mParticleTime = std::chrono::steady_clock::now();
+
+        // the compute queue's side of the particle buffers. the source is what the previous frame drew,
+        // handed back by the graphics queue; the destination and state go over for this frame's draw.
+        uint32_t graphicsFamily = mAsyncCompute.GetQueueFamilies()[0];
+        RenderGraphBufferImportInfo sourceInfo = {};
+        // the submit waits for the previous frame's graphics work before any of this.
+        sourceInfo.initialStage = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        sourceInfo.acquireFamily = graphicsFamily;
+        sourceInfo.releaseFamily = VK_QUEUE_FAMILY_IGNORED;
+        RenderGraphBufferImportInfo destinationInfo = sourceInfo;
+        destinationInfo.acquireFamily = VK_QUEUE_FAMILY_IGNORED;
+        destinationInfo.releaseFamily = graphicsFamily;
+        RenderGraphBufferImportInfo stateInfo = sourceInfo;
+        stateInfo.releaseFamily = graphicsFamily;
+        mSimulateSourceResource = mComputeGraph.ImportBuffer("particle source", &sourceInfo);
+        mSimulateDestinationResource = mComputeGraph.ImportBuffer("particle destination", &destinationInfo);
+        mSimulateStateResource = mComputeGraph.ImportBuffer("particle state", &stateInfo);
+
+        uint32_t clearPass = mComputeGraph.AddPass("particle clear", [this](VkCommandBuffer commandBuffer, const RenderGraph& graph)
+        {
+            mParticles.Clear(commandBuffer);
+        });
+        mComputeGraph.Use(clearPass, mSimulateStateResource, RENDER_GRAPH_ACCESS_TRANSFER_DST);
 
-        if (vkAllocateMemory(mDevice, &allocInfo, nullptr, &mVertexBufferMemory) != VK_SUCCESS)
+        uint32_t preparePass = mComputeGraph.AddPass("particle prepare", [this](VkCommandBuffer commandBuffer, const RenderGraph& graph)
         {
-            logger.throw_error("failed to allocate vertex buffer memory.");
-        }
+            auto now = std::chrono::steady_clock::now();
+            float deltaSeconds = std::chrono::duration<float>(now - mParticleTime).count();
+            mParticleTime = now;
+            mParticles.Prepare(commandBuffer, deltaSeconds, std::chrono::duration<float>(now - mStartTime).count());
+        });
+        mComputeGraph.Use(preparePass, mSimulateStateResource, RENDER_GRAPH_ACCESS_STORAGE_WRITE);
+
+        uint32_t simulatePass = mComputeGraph.AddPass("particle simulate", [this](VkCommandBuffer commandBuffer, const RenderGraph& graph)
+        {
+            mParticles.Simulate(commandBuffer);
+        });
+        mComputeGraph.Use(simulatePass, mSimulateStateResource, RENDER_GRAPH_ACCESS_INDIRECT_READ);
+        mComputeGraph.Use(simulatePass, mSimulateStateResource, RENDER_GRAPH_ACCESS_STORAGE_WRITE);
+        mComputeGraph.Use(simulatePass, mSimulateSourceResource, RENDER_GRAPH_ACCESS_STORAGE_READ);
+        mComputeGraph.Use(simulatePass, mSimulateDestinationResource, RENDER_GRAPH_ACCESS_STORAGE_WRITE);
+
+        RenderGraphCompileInfo compileInfo = {};
+        compileInfo.physicalDevice = mPhysicalDevice;
+        compileInfo.device = mDevice;
+        compileInfo.queueFamily = mAsyncCompute.GetQueueFamilies()[1];
+        mComputeGraph.Compile(&compileInfo);
+
+        // the simulation overlaps the cpu's recording and whatever the graphics queue still has in flight;
+        // only the particle draw's stages wait for it.
+        addComputeJob([this](VkCommandBuffer commandBuffer)
+        {
+            // nothing has been handed back before the first frame.
+            mComputeGraph.SetImportedBuffer(mSimulateSourceResource, mParticles.GetSourceBuffer(), mParticlesSimulated);
+            mComputeGraph.SetImportedBuffer(mSimulateDestinationResource, mParticles.GetDestinationBuffer());
+            mComputeGraph.SetImportedBuffer(mSimulateStateResource, mParticles.GetStateBuffer(), mParticlesSimulated);
+            mComputeGraph.Execute(commandBuffer);
+            mParticlesSimulated = true;
+        }, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+    }
 
-        vkBindBufferMemory(mDevice, mVertexBuffer, mVertexBufferMemory, 0);
+    void createVertexBuffer()
+    {
+        VkDeviceSize size = sizeof(vertices[0]) * vertices.size();
+        createDeviceLocalBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, mVertexBuffer, mVertexBufferMemory);
 
-        void* data;
-        vkMapMemory(mDevice, mVertexBufferMemory, 0, bufferInfo.size, 0, &data);
-        memcpy(data, vertices.data(), (size_t)bufferInfo.size);
-        vkUnmapMemory(mDevice, mVertexBufferMemory);
+        // every frame draws it, starting with the first.
+        mTransfer.Require(mTransfer.UploadBuffer(mVertexBuffer, 0, vertices.data(), size, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT));
+        mCapture.UploadBuffer(mVertexBuffer, 0, vertices.data(), size);
+        mTransfer.Flush();
 
         logger.debug("Vertex Buffer created.");
     }
 
-    void createCommandBuffers()
+    /*
+    Mesh 0 is the triangle in the vertex buffer, and the scene starts out with one entity drawing it.
+    */
+    void createScene()
     {
-        mCommandBuffers.resize(mSwapchainFramebuffers.size());
+        EntityStoreInfo entityStoreInfo = {};
+        entityStoreInfo.initialCapacity = SCENE_INITIAL_CAPACITY;
+        mScene.Initialize(&entityStoreInfo);
 
-        VkCommandBufferAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.commandPool = mCommandPool;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = (uint32_t)mCommandBuffers.size();
+        TransformHierarchyInfo transformHierarchyInfo = {};
+        transformHierarchyInfo.initialCapacity = SCENE_INITIAL_CAPACITY;
+        mHierarchy.Initialize(&transformHierarchyInfo);
 
-        if (vkAllocateCommandBuffers(mDevice, &allocInfo, mCommandBuffers.data()) != VK_SUCCESS)
-        {
+        CullingInfo cullingInfo = {};
+        mCuller.Initialize(&cullingInfo);
+
+        mMeshes.push_back({ mVertexBuffer, 0, static_cast<uint32_t>(vertices.size()) });
+        createRenderable(makeTransform(glm::vec3(0.0f, 0.0f, 0.5f)), TRANSFORM_NODE_NONE, 0, 0);
+
+        logger.debug("Scene created.");
+    }
+
+    static TransformComponent makeTransform(const glm::vec3& position, float scale = 1.0f, float angle = 0.0f)
+    {
+        TransformComponent transform;
+        transform.position = position;
+        transform.scale = glm::vec3(scale);
+        transform.rotation = glm::angleAxis(angle, glm::vec3(0.0f, 0.0f, 1.0f));
+        return transform;
+    }
+
+    TransformNode createRenderable(const TransformComponent& local, TransformNode parent, uint32_t mesh, uint32_t material)
+    {
+        Entity entity = mScene.Create(RENDERABLE_COMPONENTS);
+        // the triangle fits in a sphere of radius 0.5 around the origin, and so does anything else we draw for now.
+        mScene.Get<BoundsComponent>(entity)->sphere = glm::vec4(0.0f, 0.0f, 0.0f, 0.5f);
+        mScene.Get<MeshComponent>(entity)->mesh = mesh;
+        mScene.Get<MaterialComponent>(entity)->material = material;
+        return mHierarchy.Insert(local, parent, entity);
+    }
+
+    /*
+    Runs the scene systems for this frame. Everything is cpu side, so it doesn't need the frame slot.
+    */
+    void updateScene()
+    {
+        PROFILE_FUNCTION();
+        UpdateTransforms(mScene);
+        UpdateHierarchy(mHierarchy, mScene);
+        CullEntities(mScene, mCuller, ExtractFrustum(mViewProj), mVisible);
+        BuildDrawList(mScene, mVisible, mDrawList);
+
+        // sprites are immediate mode: whatever is added this frame is drawn this frame.
+        mSprites.Clear();
+        if (mBenchmarkScene == BENCHMARK_SCENE_SPRITES)
+        {
+            addBenchmarkSprites();
+        }
+    }
+
+    void createDeviceLocalBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& memory)
+    {
+        // exclusive to one family at a time; the transfer queue hands ownership to graphics once the copy is done.
+        CreateBuffer(mPhysicalDevice, mDevice, size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEMORY_CATEGORY_GEOMETRY, &buffer, &memory);
+        mCapture.CreateBuffer(buffer, size, usage);
+    }
+
+    void createDescriptorSetLayout()
+    {
+        // binding 0: per-frame uniforms. binding 1: per-instance world matrices.
+        // both are dynamic so a single descriptor set can point anywhere in the upload ring;
+        // the offset is supplied at bind time instead of writing new descriptors every frame.
+        // binding 2: the hud's glyph atlas, which never changes.
+        std::array<VkDescriptorSetLayoutBinding, 3> bindings = {};
+
+        bindings[0].binding = 0;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        bindings[0].descriptorCount = 1;
+        bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        bindings[0].pImmutableSamplers = nullptr; // optional
+
+        bindings[1].binding = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+        bindings[1].descriptorCount = 1;
+        bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        bindings[1].pImmutableSamplers = nullptr; // optional
+
+        bindings[2].binding = 2;
+        bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[2].descriptorCount = 1;
+        bindings[2].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        bindings[2].pImmutableSamplers = nullptr; // optional
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
+
+        if (vkCreateDescriptorSetLayout(mDevice, &layoutInfo, nullptr, &mDescriptorSetLayout) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create descriptor set layout.");
+        }
+
+        logger.debug("Descriptor set layout created.");
+    }
+
+    void createUploadRing()
+    {
+        UploadRingInfo uploadRingInfo = {};
+        uploadRingInfo.physicalDevice = mPhysicalDevice;
+        uploadRingInfo.device = mDevice;
+        uploadRingInfo.frameSize = UPLOAD_RING_FRAME_SIZE;
+        uploadRingInfo.frameCount = mFramesInFlight;
+        uploadRingInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        mUploadRing.Initialize(&uploadRingInfo);
+    }
+
+    void createSpriteBatch()
+    {
+        // a ring of its own: sprite vertices are megabytes a frame, and only ever bound as vertex input.
+        UploadRingInfo uploadRingInfo = {};
+        uploadRingInfo.physicalDevice = mPhysicalDevice;
+        uploadRingInfo.device = mDevice;
+        uploadRingInfo.frameSize = static_cast<VkDeviceSize>(SPRITE_MAX_PER_FRAME) * SPRITE_VERTEX_COUNT * sizeof(SpriteVertex) +
+            static_cast<VkDeviceSize>(HUD_MAX_QUADS) * HUD_VERTEX_COUNT * sizeof(HudVertex) + 2 * sizeof(glm::vec4);
+        uploadRingInfo.frameCount = mFramesInFlight;
+        uploadRingInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+        mSpriteRing.Initialize(&uploadRingInfo);
+        mCapture.CreateBuffer(mSpriteRing.GetBuffer(), mSpriteRing.GetFrameSize() * mFramesInFlight, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+
+        SpriteBatchInfo spriteBatchInfo = {};
+        spriteBatchInfo.maxSprites = SPRITE_MAX_PER_FRAME;
+        mSprites.Initialize(&spriteBatchInfo);
+
+        logger.debug("Sprite batch created (%u sprites per frame).", SPRITE_MAX_PER_FRAME);
+    }
+
+    void createHud()
+    {
+        HudInfo hudInfo = {};
+        hudInfo.physicalDevice = mPhysicalDevice;
+        hudInfo.device = mDevice;
+        hudInfo.pTransfer = &mTransfer;
+        hudInfo.maxQuads = HUD_MAX_QUADS;
+        hudInfo.historyLength = HUD_HISTORY_FRAMES;
+        hudInfo.visible = mSettings.hud;
+        mHud.Initialize(&hudInfo);
+        // the descriptor set points at the atlas from the first frame, so that frame has to acquire it.
+        mTransfer.Require(mHud.GetAtlasUploadValue());
+    }
+
+    static const char* getPresentModeName(VkPresentModeKHR presentMode)
+    {
+        switch (presentMode)
+        {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:
+            return "IMMEDIATE";
+        case VK_PRESENT_MODE_MAILBOX_KHR:
+            return "MAILBOX";
+        case VK_PRESENT_MODE_FIFO_KHR:
+            return "FIFO";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+            return "FIFO RELAXED";
+        default:
+            return "OTHER";
+        }
+    }
+
+    /*
+    The overlay reads last frame's draw and triangle counts; this frame's aren't recorded yet.
+    Its vertices aren't captured, since recordHudPass() isn't and the replayer would never read them.
+    */
+    void buildHud()
+    {
+        HudStats stats = {};
+        stats.cpuMs = mLastCpuMs;
+        stats.gpuMs = mGpuFrameMs;
+        stats.draws = mFrameDrawCount;
+        stats.triangles = mFrameTriangleCount;
+        memoryBudget.GetDeviceLocalUsage(&stats.memoryUsed, &stats.memoryBudget);
+        stats.presentMode = getPresentModeName(mPresentMode);
+        stats.extent = mSwapchainExtent;
+        mHud.Build(mSpriteRing, stats);
+    }
+
+    void createDescriptorPool()
+    {
+        std::array<VkDescriptorPoolSize, 3> poolSizes = {};
+        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        poolSizes[0].descriptorCount = 1;
+        poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+        poolSizes[1].descriptorCount = 1;
+        poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        poolSizes[2].descriptorCount = 1;
+
+        VkDescriptorPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+        poolInfo.maxSets = 1;
+
+        if (vkCreateDescriptorPool(mDevice, &poolInfo, nullptr, &mDescriptorPool) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create descriptor pool.");
+        }
+
+        logger.debug("Descriptor pool created.");
+    }
+
+    void createDescriptorSet()
+    {
+        VkDescriptorSetAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = mDescriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &mDescriptorSetLayout;
+
+        if (vkAllocateDescriptorSets(mDevice, &allocInfo, &mDescriptorSet) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to allocate descriptor set.");
+        }
+
+        // both bindings point at the start of the ring. the real offsets come from vkCmdBindDescriptorSets.
+        VkDescriptorBufferInfo uniformInfo = {};
+        uniformInfo.buffer = mUploadRing.GetBuffer();
+        uniformInfo.offset = 0;
+        uniformInfo.range = sizeof(FrameUniforms);
+
+        VkDescriptorBufferInfo storageInfo = {};
+        storageInfo.buffer = mUploadRing.GetBuffer();
+        storageInfo.offset = 0;
+        storageInfo.range = INSTANCE_STORAGE_RANGE;
+
+        VkDescriptorImageInfo atlasInfo = {};
+        atlasInfo.sampler = mHud.GetAtlasSampler();
+        atlasInfo.imageView = mHud.GetAtlasView();
+        atlasInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        std::array<VkWriteDescriptorSet, 3> writes = {};
+        writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[0].dstSet = mDescriptorSet;
+        writes[0].dstBinding = 0;
+        writes[0].dstArrayElement = 0;
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        writes[0].descriptorCount = 1;
+        writes[0].pBufferInfo = &uniformInfo;
+
+        writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[1].dstSet = mDescriptorSet;
+        writes[1].dstBinding = 1;
+        writes[1].dstArrayElement = 0;
+        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+        writes[1].descriptorCount = 1;
+        writes[1].pBufferInfo = &storageInfo;
+
+        writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[2].dstSet = mDescriptorSet;
+        writes[2].dstBinding = 2;
+        writes[2].dstArrayElement = 0;
+        writes[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[2].descriptorCount = 1;
+        writes[2].pImageInfo = &atlasInfo;
+
+        vkUpdateDescriptorSets(mDevice, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+        logger.debug("Descriptor set created.");
+    }
+
+    void createCommandBuffers()
+    {
+        // one command buffer per frame in flight (not per swapchain image).
+        // they're re-recorded every frame so per-frame data can land in the upload ring.
+        mCommandBuffers.resize(mFramesInFlight);
+
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = mCommandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = (uint32_t)mCommandBuffers.size();
+
+        if (vkAllocateCommandBuffers(mDevice, &allocInfo, mCommandBuffers.data()) != VK_SUCCESS)
+        {
             logger.throw_error("failed to allocate command buffers.");
         }
 
-        for (size_t i = 0, count = mCommandBuffers.size(); i < count; ++i)
+        logger.debug("Command buffers created.");
+    }
+
+    void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+    {
+        PROFILE_FUNCTION();
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        beginInfo.pInheritanceInfo = nullptr; // optional
+
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to begin recording a command buffer.");
+        }
+        mCapture.BeginFrame();
+        mFrameDrawCount = 0;
+        mFrameTriangleCount = 0;
+
+        // the profiler's frame zone brackets everything the frame records; it's also the gpu frame time.
+        profiler.BeginGpuFrame(commandBuffer, static_cast<uint32_t>(mCurrentFrame));
+
+        // take ownership of anything the transfer queue finished handing over. the submit waits on the returned value.
+        {
+            PROFILE_GPU_ZONE(commandBuffer, "upload acquire");
+            mUploadWaitValue = mTransfer.RecordAcquireBarriers(commandBuffer, &mUploadWaitStages);
+        }
+
+        // per-frame uniforms go through the ring. only the space is reserved here;
+        // the contents are written by writeLateFrameData() right before submit.
+        UploadAllocation frameAllocation = mUploadRing.AllocateUniform(sizeof(FrameUniforms));
+        mFrameUniforms = static_cast<FrameUniforms*>(frameAllocation.pData);
+
+        UploadAllocation instanceAllocation = writeInstanceData();
+
+        mFrameDynamicOffsets[0] = static_cast<uint32_t>(frameAllocation.offset);
+        mFrameDynamicOffsets[1] = static_cast<uint32_t>(instanceAllocation.offset);
+
+        mCurrentImageIndex = imageIndex;
+        mRenderGraph.SetImportedImage(mSwapchainResource, mSwapchainImages[imageIndex], mSwapchainImageViews[imageIndex]);
+        if (mSettings.particles > 0)
+        {
+            // the simulation already swapped, so the source is what it just wrote.
+            mRenderGraph.SetImportedBuffer(mParticleResource, mParticles.GetSourceBuffer());
+            mRenderGraph.SetImportedBuffer(mParticleStateResource, mParticles.GetStateBuffer());
+        }
+        mRenderGraph.Execute(commandBuffer);
+
+        profiler.EndGpuFrame(commandBuffer);
+
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to record a command buffer.");
+        }
+    }
+
+    /*
+    Fill in per-frame data whose space was reserved during recording. Called as late as possible,
+    just before the submit, so time (and later camera/input) is as fresh as it can be.
+    The ring is host coherent and the gpu can't read it before the submit, so a plain write is enough.
+    */
+    void writeLateFrameData()
+    {
+        auto now = std::chrono::steady_clock::now();
+        FrameUniforms frameUniforms = {};
+        frameUniforms.viewProj = mViewProj;
+        frameUniforms.time.x = std::chrono::duration<float>(now - mStartTime).count();
+        frameUniforms.time.y = std::chrono::duration<float>(now - mLastFrameTime).count();
+        frameUniforms.time.z = static_cast<float>(mFrameNumber);
+        mLastFrameTime = now;
+        memcpy(mFrameUniforms, &frameUniforms, sizeof(frameUniforms));
+        mCapture.FrameData(&frameUniforms, sizeof(frameUniforms));
+    }
+
+    /*
+    The world matrix of every instance this frame draws, read by shader.vert at gl_InstanceIndex.
+    Draw list instances are laid out batch by batch, so a batch's firstInstance is its first matrix.
+    Scenes that draw their geometry as is get a single identity for instance 0.
+    */
+    UploadAllocation writeInstanceData()
+    {
+        PROFILE_FUNCTION();
+        uint32_t instanceCount = 1;
+        mFrameDroppedInstances = 0;
+        if (mBenchmarkScene == BENCHMARK_SCENE_INSTANCING)
+        {
+            instanceCount = static_cast<uint32_t>(mBenchmarkInstanceMatrices.size());
+        }
+        else if (mBenchmarkScene != BENCHMARK_SCENE_SMALL_DRAWS && mBenchmarkScene != BENCHMARK_SCENE_LARGE_VERTEX_BUFFER)
+        {
+            uint32_t drawListInstances = static_cast<uint32_t>(mDrawList.instances.size());
+            instanceCount = (std::max)(1u, (std::min)(drawListInstances, MAX_DRAW_INSTANCES));
+            if (drawListInstances > MAX_DRAW_INSTANCES)
+            {
+                mFrameDroppedInstances = drawListInstances - MAX_DRAW_INSTANCES;
+                if (!mInstanceLimitWarned)
+                {
+                    logger.warn("%u instances to draw, but only %u world matrices fit in a frame. The rest aren't drawn.", drawListInstances, MAX_DRAW_INSTANCES);
+                    mInstanceLimitWarned = true;
+                }
+            }
+        }
+
+        VkDeviceSize size = instanceCount * sizeof(glm::mat4);
+        UploadAllocation allocation = mUploadRing.AllocateStorage(size);
+        glm::mat4* pMatrices = static_cast<glm::mat4*>(allocation.pData);
+        if (mBenchmarkScene == BENCHMARK_SCENE_INSTANCING)
+        {
+            memcpy(pMatrices, mBenchmarkInstanceMatrices.data(), size);
+        }
+        else if (mBenchmarkScene == BENCHMARK_SCENE_SMALL_DRAWS || mBenchmarkScene == BENCHMARK_SCENE_LARGE_VERTEX_BUFFER || mDrawList.instances.empty())
+        {
+            pMatrices[0] = glm::mat4(1.0f);
+        }
+        else
+        {
+            for (uint32_t i = 0; i < instanceCount; ++i)
+            {
+                const DrawInstance& instance = mDrawList.instances[i];
+                pMatrices[i] = mScene.GetArchetype(instance.archetype).Get<WorldMatrixComponent>()[instance.row].matrix;
+            }
+        }
+        mCapture.InstanceData(allocation.pData, static_cast<uint32_t>(size));
+        return allocation;
+    }
+
+    void recordMainPass(VkCommandBuffer commandBuffer)
+    {
+        std::array<VkClearValue, 2> clearValues = {};
+        clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
+        clearValues[1].depthStencil = { 1.0f, 0 };
+
+        if (mUseDynamicRendering)
+        {
+            VkRenderingAttachmentInfoKHR colorAttachment = {};
+            colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+            colorAttachment.imageView = mRenderGraph.GetImageView(mSwapchainResource);
+            colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            colorAttachment.resolveMode = VK_RESOLVE_MODE_NONE;
+            colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+            colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+            colorAttachment.clearValue = clearValues[0];
+            if (mMsaaColorResource != RENDER_GRAPH_INVALID_RESOURCE)
+            {
+                // render into the samples, resolve into the swapchain when rendering ends, drop the samples.
+                colorAttachment.imageView = mRenderGraph.GetImageView(mMsaaColorResource);
+                colorAttachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+                colorAttachment.resolveImageView = mRenderGraph.GetImageView(mSwapchainResource);
+                colorAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+                colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            }
+
+            VkRenderingAttachmentInfoKHR depthAttachment = {};
+            depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+            depthAttachment.imageView = mRenderGraph.GetImageView(mDepthResource);
+            depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+            depthAttachment.resolveMode = VK_RESOLVE_MODE_NONE;
+            depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+            depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            depthAttachment.clearValue = clearValues[1];
+
+            VkRenderingInfoKHR renderingInfo = {};
+            renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+            renderingInfo.renderArea.offset = { 0, 0 };
+            renderingInfo.renderArea.extent = mSwapchainExtent;
+            renderingInfo.layerCount = 1;
+            renderingInfo.colorAttachmentCount = 1;
+            renderingInfo.pColorAttachments = &colorAttachment;
+            renderingInfo.pDepthAttachment = &depthAttachment;
+            // a combined format has to be bound as both or the pipeline's stencil format won't match.
+            renderingInfo.pStencilAttachment = hasStencilComponent(mDepthFormat) ? &depthAttachment : nullptr;
+
+            vkCmdBeginRenderingKHR(commandBuffer, &renderingInfo);
+        }
+        else
+        {
+            beginMainRenderPass(commandBuffer, static_cast<uint32_t>(clearValues.size()), clearValues.data());
+        }
+
+        FrameCapturePass capturePass = {};
+        capturePass.extent = mSwapchainExtent;
+        memcpy(capturePass.clearColor, clearValues[0].color.float32, sizeof(capturePass.clearColor));
+        capturePass.clearDepth = clearValues[1].depthStencil.depth;
+        capturePass.colorFormat = mSwapchainImageFormat;
+        capturePass.depthFormat = mDepthFormat;
+        capturePass.samples = mMsaaSamples;
+        mCapture.BeginPass(capturePass);
+
+        setViewportAndScissor(commandBuffer);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1, &mDescriptorSet, 2, mFrameDynamicOffsets);
+
+        VkBuffer vertexBuffers[] = { mVertexBuffer };
+        VkDeviceSize offsets[] = { 0 };
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+        mCapture.BindVertexBuffer(mVertexBuffer, 0);
+
+        if (mSettings.depthPrepass)
+        {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mDepthPrepassPipeline);
+            mCapture.BindPipeline(mDepthPrepassPipeline);
+            recordSceneDraws(commandBuffer);
+        }
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mGraphicsPipeline);
+        mCapture.BindPipeline(mGraphicsPipeline);
+        recordSceneDraws(commandBuffer);
+        // on top of the scene, and not part of the pre-pass.
+        recordParticles(commandBuffer);
+        recordSprites(commandBuffer);
+        mCapture.EndPass();
+
+        if (mUseDynamicRendering)
+        {
+            vkCmdEndRenderingKHR(commandBuffer);
+        }
+        else
+        {
+            vkCmdEndRenderPass(commandBuffer);
+        }
+    }
+
+    /*
+    Every draw in the scene. Called once per pass over the geometry (depth pre-pass, shading),
+    so it must not bind pipelines itself.
+    */
+    void recordSceneDraws(VkCommandBuffer commandBuffer)
+    {
+        switch (mBenchmarkScene)
+        {
+        case BENCHMARK_SCENE_SMALL_DRAWS:
+            for (uint32_t i = 0; i < BENCHMARK_SMALL_DRAW_COUNT; ++i)
+            {
+                recordDraw(commandBuffer, static_cast<uint32_t>(vertices.size()), 1);
+            }
+            break;
+        case BENCHMARK_SCENE_INSTANCING:
+            recordDraw(commandBuffer, static_cast<uint32_t>(vertices.size()), BENCHMARK_INSTANCE_COUNT);
+            break;
+        case BENCHMARK_SCENE_LARGE_VERTEX_BUFFER:
+        {
+            VkDeviceSize offset = 0;
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mBenchmarkVertexBuffer, &offset);
+            mCapture.BindVertexBuffer(mBenchmarkVertexBuffer, offset);
+            recordDraw(commandBuffer, mBenchmarkVertexCount, 1);
+            break;
+        }
+        default:
+            recordDrawList(commandBuffer);
+            break;
+        }
+    }
+
+    /*
+    One instanced draw per batch. The main pass has already bound mesh 0's vertex buffer.
+    Instances past MAX_DRAW_INSTANCES have no world matrix (see writeInstanceData()) and are dropped;
+    mFrameDroppedInstances counts them.
+    */
+    void recordDrawList(VkCommandBuffer commandBuffer)
+    {
+        VkBuffer boundBuffer = mVertexBuffer;
+        for (const auto& batch : mDrawList.batches)
+        {
+            if (batch.firstInstance >= MAX_DRAW_INSTANCES)
+            {
+                continue;
+            }
+            const SceneMesh& mesh = mMeshes[batch.mesh];
+            if (mesh.buffer != boundBuffer)
+            {
+                VkDeviceSize offset = 0;
+                vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mesh.buffer, &offset);
+                mCapture.BindVertexBuffer(mesh.buffer, offset);
+                boundBuffer = mesh.buffer;
+            }
+            uint32_t instanceCount = (std::min)(batch.instanceCount, MAX_DRAW_INSTANCES - batch.firstInstance);
+            recordDraw(commandBuffer, mesh.vertexCount, instanceCount, mesh.firstVertex, batch.firstInstance);
+        }
+    }
+
+    /*
+    One indirect draw whose instance count the particle simulation wrote. It isn't captured:
+    the replayer has no compute, so it would have nothing to draw.
+    */
+    void recordParticles(VkCommandBuffer commandBuffer)
+    {
+        if (mSettings.particles == 0)
+        {
+            return;
+        }
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mParticlePipeline);
+        mParticles.Draw(commandBuffer);
+        ++mFrameDrawCount;
+    }
+
+    /*
+    One draw per run of sprites sharing layer, pipeline and texture. Only one sprite pipeline exists
+    and nothing is textured yet, so in practice a pipeline is bound once and texture runs just split draws.
+    */
+    void recordSprites(VkCommandBuffer commandBuffer)
+    {
+        const std::vector<SpriteDraw>& draws = mSprites.GetDraws();
+        if (draws.empty())
+        {
+            return;
+        }
+
+        VkBuffer buffer = mSprites.GetVertexBuffer();
+        VkDeviceSize offset = mSprites.GetVertexOffset();
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &buffer, &offset);
+        mCapture.BindVertexBuffer(buffer, offset);
+
+        VkPipeline boundPipeline = VK_NULL_HANDLE;
+        for (const auto& draw : draws)
+        {
+            VkPipeline pipeline = mSpritePipeline;
+            if (pipeline != boundPipeline)
+            {
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                mCapture.BindPipeline(pipeline);
+                boundPipeline = pipeline;
+            }
+            recordDraw(commandBuffer, draw.vertexCount, 1, draw.firstVertex);
+        }
+    }
+
+    /*
+    The whole overlay is one draw in a pass of its own after main, so nothing covers it. It isn't
+    captured: the replayer only knows passes that clear color and depth.
+    */
+    void recordHudPass(VkCommandBuffer commandBuffer)
+    {
+        if (mHud.GetVertexCount() == 0)
+        {
+            return;
+        }
+
+        if (mUseDynamicRendering)
+        {
+            VkRenderingAttachmentInfoKHR colorAttachment = {};
+            colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+            colorAttachment.imageView = mRenderGraph.GetImageView(mSwapchainResource);
+            colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            colorAttachment.resolveMode = VK_RESOLVE_MODE_NONE;
+            colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+            colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+            VkRenderingInfoKHR renderingInfo = {};
+            renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+            renderingInfo.renderArea.offset = { 0, 0 };
+            renderingInfo.renderArea.extent = mSwapchainExtent;
+            renderingInfo.layerCount = 1;
+            renderingInfo.colorAttachmentCount = 1;
+            renderingInfo.pColorAttachments = &colorAttachment;
+
+            vkCmdBeginRenderingKHR(commandBuffer, &renderingInfo);
+        }
+        else
+        {
+            VkRenderPassBeginInfo renderPassInfo = {};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = mHudRenderPass;
+            renderPassInfo.framebuffer = mHudFramebuffers[mCurrentImageIndex];
+            renderPassInfo.renderArea.offset = { 0, 0 };
+            renderPassInfo.renderArea.extent = mSwapchainExtent;
+
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        }
+
+        setViewportAndScissor(commandBuffer);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1, &mDescriptorSet, 2, mFrameDynamicOffsets);
+
+        VkBuffer buffer = mHud.GetVertexBuffer();
+        VkDeviceSize offset = mHud.GetVertexOffset();
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &buffer, &offset);
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mHudPipeline);
+        vkCmdDraw(commandBuffer, mHud.GetVertexCount(), 1, 0, 0);
+        ++mFrameDrawCount;
+        mFrameTriangleCount += mHud.GetVertexCount() / 3;
+
+        if (mUseDynamicRendering)
+        {
+            vkCmdEndRenderingKHR(commandBuffer);
+        }
+        else
+        {
+            vkCmdEndRenderPass(commandBuffer);
+        }
+    }
+
+    void setViewportAndScissor(VkCommandBuffer commandBuffer)
+    {
+        VkViewport viewport = {};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = (float)mSwapchainExtent.width;
+        viewport.height = (float)mSwapchainExtent.height;
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+        VkRect2D scissor = {};
+        scissor.offset = { 0, 0 };
+        scissor.extent = mSwapchainExtent;
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    }
+
+    void recordDraw(VkCommandBuffer commandBuffer, uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex = 0, uint32_t firstInstance = 0)
+    {
+        ++mFrameDrawCount;
+        mFrameTriangleCount += static_cast<uint64_t>(vertexCount / 3) * instanceCount;
+        vkCmdDraw(commandBuffer, vertexCount, instanceCount, firstVertex, firstInstance);
+        mCapture.Draw(vertexCount, instanceCount, firstVertex, firstInstance);
+    }
+
+    void beginMainRenderPass(VkCommandBuffer commandBuffer, uint32_t clearValueCount, const VkClearValue* pClearValues)
+    {
+        VkRenderPassBeginInfo renderPassInfo = {};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = mRenderPass;
+        renderPassInfo.framebuffer = mSwapchainFramebuffers[mCurrentImageIndex];
+        renderPassInfo.renderArea.offset = { 0, 0 };
+        renderPassInfo.renderArea.extent = mSwapchainExtent;
+        renderPassInfo.clearValueCount = clearValueCount;
+        renderPassInfo.pClearValues = pClearValues;
+
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    }
+
+    void createSyncObjects()
+    {
+        mImageAvailableSemaphore.resize(mFramesInFlight);
+        mRenderCompleteSemaphore.resize(mFramesInFlight);
+        mComputeReadySemaphore.resize(mFramesInFlight, VK_NULL_HANDLE);
+        mInFlightFences.resize(mFramesInFlight, VK_NULL_HANDLE);
+
+        if (mTimelineSemaphoresSupported)
+        {
+            // frame N signals N + 1 when it completes, so the counter value is the number of finished frames.
+            VkSemaphoreTypeCreateInfo typeInfo = {};
+            typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+            typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+            typeInfo.initialValue = 0;
+
+            VkSemaphoreCreateInfo timelineInfo = {};
+            timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            timelineInfo.pNext = &typeInfo;
+
+            if (vkCreateSemaphore(mDevice, &timelineInfo, nullptr, &mFrameTimeline) != VK_SUCCESS)
+            {
+                logger.throw_error("failed to create the frame timeline semaphore.");
+            }
+        }
+
+        VkSemaphoreCreateInfo semaphoreInfo = {};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        VkFenceCreateInfo fenceInfo = {};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+        for (size_t i = 0; i < mFramesInFlight; ++i)
+        {
+            if (vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &mImageAvailableSemaphore[i]) != VK_SUCCESS ||
+                vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &mRenderCompleteSemaphore[i]) != VK_SUCCESS)
+            {
+                logger.throw_error("failed to create a semaphore.");
+            }
+
+            if (!mTimelineSemaphoresSupported && vkCreateFence(mDevice, &fenceInfo, nullptr, &mInFlightFences[i]) != VK_SUCCESS)
+            {
+                logger.throw_error("failed to create a fence.");
+            }
+
+            // the compute queue waits on the frame timeline instead when there is one.
+            if (!mTimelineSemaphoresSupported && vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &mComputeReadySemaphore[i]) != VK_SUCCESS)
+            {
+                logger.throw_error("failed to create a semaphore.");
+            }
+        }
+
+        logger.debug("Semaphores and %s created for %u frames in flight.", mTimelineSemaphoresSupported ? "frame timeline" : "Fences", mFramesInFlight);
+    }
+
+    void initProfilerGpu()
+    {
+        QueueFamilyIndices indices = findQueueFamilies(mPhysicalDevice);
+
+        ProfilerGpuInfo profilerGpuInfo = {};
+        profilerGpuInfo.physicalDevice = mPhysicalDevice;
+        profilerGpuInfo.device = mDevice;
+        profilerGpuInfo.queue = mGraphicsQueue;
+        profilerGpuInfo.queueFamilyIndex = indices.graphicsFamily.value();
+        profilerGpuInfo.frameCount = mFramesInFlight;
+        profilerGpuInfo.maxZonesPerFrame = PROFILER_MAX_GPU_ZONES_PER_FRAME;
+        profiler.InitializeGpu(&profilerGpuInfo);
+    }
+
+    /*
+    Read back the gpu time of the frame that last used the current slot. Only valid
+    once waitForFrameSlot() has returned, which is what makes the results available without waiting.
+    */
+    void readGpuFrameTime()
+    {
+        profiler.CollectGpuFrame(static_cast<uint32_t>(mCurrentFrame));
+        mGpuFrameMs = profiler.GetGpuFrameMs();
+    }
+
+    /*
+    Block until the frame that last used the current slot has finished on the gpu,
+    then return how many frames are known to be complete (frame N counts as N + 1).
+    */
+    uint64_t waitForFrameSlot()
+    {
+        PROFILE_FUNCTION();
+        if (mTimelineSemaphoresSupported)
+        {
+            // the previous user of this slot was frame mFrameNumber - mFramesInFlight.
+            if (mFrameNumber >= mFramesInFlight)
+            {
+                uint64_t waitValue = mFrameNumber + 1 - mFramesInFlight;
+                VkSemaphoreWaitInfo waitInfo = {};
+                waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+                waitInfo.semaphoreCount = 1;
+                waitInfo.pSemaphores = &mFrameTimeline;
+                waitInfo.pValues = &waitValue;
+                vkWaitSemaphores(mDevice, &waitInfo, (std::numeric_limits<uint64_t>::max)());
+            }
+
+            // usually further along than what we waited for.
+            uint64_t completed = 0;
+            vkGetSemaphoreCounterValue(mDevice, mFrameTimeline, &completed);
+            return completed;
+        }
+
+        vkWaitForFences(mDevice, 1, &mInFlightFences[mCurrentFrame], VK_TRUE, (std::numeric_limits<uint64_t>::max)());
+
+        // every slot's fence has been waited on since its last submit, so every frame
+        // up to mFramesInFlight ago is known to be done.
+        return mFrameNumber + 1 >= mFramesInFlight ? mFrameNumber + 1 - mFramesInFlight : 0;
+    }
+
+    void mainLoop()
+    {
+        if (mSettings.benchmark)
+        {
+            beginBenchmark();
+        }
+
+        while (!glfwWindowShouldClose(pWindow) && !mInput.IsActionPressed('EXIT'))
+        {
+            PROFILE_ZONE("frame");
+            {
+                PROFILE_ZONE("events");
+                glfwPollEvents();
+                // update input after glfwPollEvents so we have fresh input data.
+                mInput.Update();
+            }
+            if (enableValidationLayers)
+            {
+                if (mInput.IsActionJustPressed('VSEV'))
+                {
+                    logger.debug("Validation messages: %s.", ValidationFilter::GetSeverityName(mValidationFilter.CycleSeverity()));
+                }
+                mValidationFilter.Update();
+            }
+            if (mInput.IsActionJustPressed('MEMR'))
+            {
+                memoryBudget.Report();
+            }
+            if (mInput.IsActionJustPressed('HUD_'))
+            {
+                mHud.Toggle();
+            }
+            if (mInput.IsActionJustPressed('VCOL'))
+            {
+                // both settings were prebuilt, so this is a lookup rather than a compile.
+                mVertexColor = !mVertexColor;
+                mGraphicsPipeline = mPipelineVariants.Get(getShadingVariant());
+                logger.debug("Vertex colors: %s.", mVertexColor ? "on" : "off");
+            }
+            memoryBudget.Update();
+
+            auto frameStart = std::chrono::steady_clock::now();
+            uint64_t frameNumber = mFrameNumber;
+            updateScene();
+            drawFrame();
+            // a frame that only recreated the swapchain didn't render anything.
+            if (mFrameNumber != frameNumber)
+            {
+                double frameMs = std::chrono::duration<double, std::milli>(frameStart - mPreviousFrameStart).count();
+                double cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count() - mFrameWaitMs;
+                mPreviousFrameStart = frameStart;
+                mLastCpuMs = cpuMs;
+                mHud.AddFrameTime(frameMs);
+                if (mSettings.benchmark)
+                {
+                    updateBenchmark(frameMs, cpuMs);
+                }
+            }
+        }
+
+        // operations in drawFrame() are asynchronous so we could still be drawing when we exit.
+        // to avoid issues, wait for the logical device to finish operations before exiting.
+        vkDeviceWaitIdle(mDevice);
+
+        if (mSettings.benchmark)
+        {
+            endBenchmark();
+        }
+    }
+
+    void beginBenchmark()
+    {
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(mPhysicalDevice, &deviceProperties);
+
+        BenchmarkInfo benchmarkInfo = {};
+        benchmarkInfo.outputPath = mSettings.benchmarkOutput;
+        benchmarkInfo.config = {
+            { "version", std::to_string(VERSION_MAJOR) + "." + std::to_string(VERSION_MINOR) + "." + std::to_string(VERSION_PATCH) },
+            { "device", deviceProperties.deviceName },
+            { "deviceType", std::to_string(static_cast<int>(deviceProperties.deviceType)) },
+            { "apiVersion", std::to_string(VK_VERSION_MAJOR(deviceProperties.apiVersion)) + "." + std::to_string(VK_VERSION_MINOR(deviceProperties.apiVersion)) + "." + std::to_string(VK_VERSION_PATCH(deviceProperties.apiVersion)) },
+            { "driverVersion", std::to_string(deviceProperties.driverVersion) },
+            { "framesPerScene", std::to_string(mSettings.benchmarkFrames) },
+            { "warmupFrames", std::to_string(BENCHMARK_WARMUP_FRAMES) },
+            { "framesInFlight", std::to_string(mFramesInFlight) },
+            { "msaaSamples", std::to_string(static_cast<int>(mMsaaSamples)) },
+            { "depthPrepass", mSettings.depthPrepass ? "true" : "false" },
+            { "colorLevels", std::to_string(mSettings.colorLevels) },
+            { "dynamicRendering", mUseDynamicRendering ? "true" : "false" },
+            { "pipelineLibrary", mUsePipelineLibrary ? "true" : "false" },
+            { "particles", std::to_string(mSettings.particles) },
+            { "timelineSemaphores", mTimelineSemaphoresSupported ? "true" : "false" },
+            { "memoryBudget", mMemoryBudgetSupported ? "true" : "false" },
+            { "gpuTimestamps", profiler.HasGpuTimestamps() ? "true" : "false" }
+        };
+        mBenchmark.Initialize(&benchmarkInfo);
+
+        mPreviousFrameStart = std::chrono::steady_clock::now();
+        beginBenchmarkScene(BENCHMARK_SCENE_SMALL_DRAWS);
+    }
+
+    void beginBenchmarkScene(BenchmarkScene scene)
+    {
+        logger.debug("Benchmark scene '%s' (%u + %u frames).", benchmarkSceneNames[scene], BENCHMARK_WARMUP_FRAMES, mSettings.benchmarkFrames);
+        if (scene == BENCHMARK_SCENE_INSTANCING)
+        {
+            createBenchmarkInstances();
+        }
+        if (scene == BENCHMARK_SCENE_LARGE_VERTEX_BUFFER)
+        {
+            createBenchmarkVertexBuffer();
+        }
+        if (scene == BENCHMARK_SCENE_ENTITIES)
+        {
+            createBenchmarkEntities();
+        }
+        if (scene == BENCHMARK_SCENE_SPRITES)
+        {
+            createBenchmarkSprites();
+        }
+        mBenchmarkScene = scene;
+        mBenchmarkSceneFrame = 0;
+        mBenchmarkSceneRecreates = mSwapchainRecreateCount;
+        mBenchmark.BeginScene(benchmarkSceneNames[scene]);
+    }
+
+    void endBenchmarkScene()
+    {
+        uint64_t drawsPerFrame = 1;
+        uint64_t trianglesPerFrame = 1;
+        switch (mBenchmarkScene)
+        {
+        case BENCHMARK_SCENE_SMALL_DRAWS:
+            drawsPerFrame = BENCHMARK_SMALL_DRAW_COUNT;
+            trianglesPerFrame = BENCHMARK_SMALL_DRAW_COUNT;
+            break;
+        case BENCHMARK_SCENE_INSTANCING:
+            trianglesPerFrame = BENCHMARK_INSTANCE_COUNT;
+            break;
+        case BENCHMARK_SCENE_LARGE_VERTEX_BUFFER:
+            trianglesPerFrame = mBenchmarkVertexCount / 3;
+            break;
+        case BENCHMARK_SCENE_ENTITIES:
+            drawsPerFrame = mDrawList.batches.size();
+            trianglesPerFrame = mDrawList.instances.size();
+            break;
+        default:
+            break;
+        }
+        // the pre-pass draws everything a second time.
+        if (mSettings.depthPrepass)
+        {
+            drawsPerFrame *= 2;
+            trianglesPerFrame *= 2;
+        }
+        // sprites only go through the shading pass.
+        drawsPerFrame += mSprites.GetDraws().size();
+        trianglesPerFrame += static_cast<uint64_t>(mSprites.GetSpriteCount()) * 2;
+
+        PROCESS_MEMORY_COUNTERS memoryCounters = {};
+        memoryCounters.cb = sizeof(memoryCounters);
+        GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters));
+
+        mBenchmark.EndScene({
+            { "drawsPerFrame", drawsPerFrame },
+            { "trianglesPerFrame", trianglesPerFrame },
+            { "swapchainRecreates", mSwapchainRecreateCount - mBenchmarkSceneRecreates },
+            { "vertexBufferBytes", mBenchmarkScene == BENCHMARK_SCENE_LARGE_VERTEX_BUFFER ? mBenchmarkVertexCount * sizeof(Vertex) : vertices.size() * sizeof(Vertex) },
+            { "uploadRingBytes", mUploadRing.GetFrameSize() * mFramesInFlight },
+            { "processWorkingSetBytes", memoryCounters.WorkingSetSize },
+            { "processPeakWorkingSetBytes", memoryCounters.PeakWorkingSetSize },
+            { "processPagefileBytes", memoryCounters.PagefileUsage },
+            { "deviceLocalPeakBytes", memoryBudget.GetPeakDeviceLocalBytes() },
+            { "entities", mScene.GetEntityCount() },
+            { "visibleEntities", mVisible.visibleCount },
+            { "droppedInstancesPerFrame", mFrameDroppedInstances },
+            { "transformsUpdated", mHierarchy.GetUpdatedCount() },
+            { "sprites", mSprites.GetSpriteCount() },
+            { "spriteVertexBytes", mSprites.GetVertexBytes() }
+        });
+
+        if (mBenchmarkScene == BENCHMARK_SCENE_INSTANCING)
+        {
+            mBenchmarkInstanceMatrices.clear();
+        }
+        if (mBenchmarkScene == BENCHMARK_SCENE_LARGE_VERTEX_BUFFER)
+        {
+            mCapture.DestroyBuffer(mBenchmarkVertexBuffer);
+            mDeletionQueue.DestroyBuffer(mBenchmarkVertexBuffer);
+            mDeletionQueue.FreeMemory(mBenchmarkVertexBufferMemory);
+            mBenchmarkVertexBuffer = VK_NULL_HANDLE;
+            mBenchmarkVertexBufferMemory = VK_NULL_HANDLE;
+            mBenchmarkVertexCount = 0;
+        }
+        if (mBenchmarkScene == BENCHMARK_SCENE_ENTITIES)
+        {
+            for (Entity entity : mBenchmarkEntities)
+            {
+                mScene.Destroy(entity);
+            }
+            mBenchmarkEntities.clear();
+            for (TransformNode group : mBenchmarkGroups)
+            {
+                mHierarchy.Remove(group);
+            }
+            mBenchmarkGroups.clear();
+        }
+        if (mBenchmarkScene == BENCHMARK_SCENE_SPRITES)
+        {
+            mBenchmarkSprites.clear();
+        }
+        if (mBenchmarkScene == BENCHMARK_SCENE_RESIZE_STORM)
+        {
+            glfwSetWindowSize(pWindow, WINDOW_WIDTH, WINDOW_HEIGHT);
+        }
+        mBenchmarkScene = BENCHMARK_SCENE_NONE;
+    }
+
+    /*
+    Called once per rendered frame. Frames are only recorded after the scene's warm-up,
+    and the gpu time is the latest one read back, which belongs to a frame a few frames older.
+    */
+    void updateBenchmark(double frameMs, double cpuMs)
+    {
+        ++mBenchmarkSceneFrame;
+        if (mBenchmarkSceneFrame > BENCHMARK_WARMUP_FRAMES)
+        {
+            BenchmarkFrame frame = {};
+            frame.frameMs = frameMs;
+            frame.cpuMs = cpuMs;
+            frame.gpuMs = mGpuFrameMs;
+            mBenchmark.AddFrame(frame);
+        }
+
+        if (mBenchmarkScene == BENCHMARK_SCENE_ENTITIES)
+        {
+            // a fixed step per frame, so every run moves the same amount.
+            for (uint32_t i = 0; i < BENCHMARK_MOVING_GROUPS && i < mBenchmarkGroups.size(); ++i)
+            {
+                TransformComponent local = mHierarchy.GetLocal(mBenchmarkGroups[i]);
+                local.rotation = glm::angleAxis(0.01f, glm::vec3(0.0f, 0.0f, 1.0f)) * local.rotation;
+                mHierarchy.SetLocal(mBenchmarkGroups[i], local);
+            }
+        }
+
+        if (mBenchmarkScene == BENCHMARK_SCENE_RESIZE_STORM && mBenchmarkSceneFrame % BENCHMARK_RESIZE_INTERVAL == 0)
+        {
+            // alternate between two fixed sizes so every run resizes the same way.
+            bool shrink = (mBenchmarkSceneFrame / BENCHMARK_RESIZE_INTERVAL) % 2 == 1;
+            glfwSetWindowSize(pWindow, shrink ? WINDOW_WIDTH * 3 / 4 : WINDOW_WIDTH, shrink ? WINDOW_HEIGHT * 3 / 4 : WINDOW_HEIGHT);
+        }
+
+        if (mBenchmarkSceneFrame < BENCHMARK_WARMUP_FRAMES + mSettings.benchmarkFrames)
+        {
+            return;
+        }
+
+        BenchmarkScene next = static_cast<BenchmarkScene>(mBenchmarkScene + 1);
+        endBenchmarkScene();
+        if (next < BENCHMARK_SCENE_COUNT)
+        {
+            beginBenchmarkScene(next);
+        }
+        else
+        {
+            glfwSetWindowShouldClose(pWindow, GLFW_TRUE);
+        }
+    }
+
+    void endBenchmark()
+    {
+        if (mBenchmarkScene != BENCHMARK_SCENE_NONE)
+        {
+            // closed early; keep what was measured so far.
+            logger.warn("Benchmark interrupted during '%s'.", benchmarkSceneNames[mBenchmarkScene]);
+            endBenchmarkScene();
+        }
+        mBenchmark.Shutdown();
+    }
+
+    void createBenchmarkVertexBuffer()
+    {
+        // one small triangle per grid cell, in clip space. colors only depend on the cell so every run uploads the same bytes.
+        std::vector<Vertex> gridVertices;
+        gridVertices.reserve(BENCHMARK_GRID_SIZE * BENCHMARK_GRID_SIZE * 3);
+        float cell = 2.0f / BENCHMARK_GRID_SIZE;
+        for (uint32_t y = 0; y < BENCHMARK_GRID_SIZE; ++y)
         {
-            VkCommandBufferBeginInfo beginInfo = {};
-            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-            beginInfo.pInheritanceInfo = nullptr; // optional
-
-            if (vkBeginCommandBuffer(mCommandBuffers[i], &beginInfo) != VK_SUCCESS)
+            for (uint32_t x = 0; x < BENCHMARK_GRID_SIZE; ++x)
             {
-                logger.throw_error("failed to begin recording a command buffer.");
+                float left = -1.0f + x * cell;
+                float top = -1.0f + y * cell;
+                glm::vec3 color(static_cast<float>(x) / BENCHMARK_GRID_SIZE, static_cast<float>(y) / BENCHMARK_GRID_SIZE, 0.5f);
+                gridVertices.push_back({ { left + cell * 0.5f, top }, color });
+                gridVertices.push_back({ { left + cell, top + cell }, color });
+                gridVertices.push_back({ { left, top + cell }, color });
             }
+        }
 
-            VkRenderPassBeginInfo renderPassInfo = {};
-            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            renderPassInfo.renderPass = mRenderPass;
-            renderPassInfo.framebuffer = mSwapchainFramebuffers[i];
-            renderPassInfo.renderArea.offset = { 0, 0 };
-            renderPassInfo.renderArea.extent = mSwapchainExtent;
-
-            VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
-            renderPassInfo.clearValueCount = 1;
-            renderPassInfo.pClearValues = &clearColor;
-
-            vkCmdBeginRenderPass(mCommandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        VkDeviceSize size = sizeof(Vertex) * gridVertices.size();
+        createDeviceLocalBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, mBenchmarkVertexBuffer, mBenchmarkVertexBufferMemory);
+        // the scene's first frame draws it.
+        mTransfer.Require(mTransfer.UploadBuffer(mBenchmarkVertexBuffer, 0, gridVertices.data(), size, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT));
+        mCapture.UploadBuffer(mBenchmarkVertexBuffer, 0, gridVertices.data(), size);
+        mBenchmarkVertexCount = static_cast<uint32_t>(gridVertices.size());
 
-            vkCmdBindPipeline(mCommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, mGraphicsPipeline);
+        logger.debug("Benchmark vertex buffer created (%u vertices, %.1f MB).", mBenchmarkVertexCount, size / (1024.0 * 1024.0));
+    }
 
-            VkBuffer vertexBuffers[] = { mVertexBuffer };
-            VkDeviceSize offsets[] = { 0 };
-            vkCmdBindVertexBuffers(mCommandBuffers[i], 0, 1, vertexBuffers, offsets);
+    /*
+    The instancing scene's triangles, one per cell of a square grid over the view. They're uploaded
+    every frame like the draw list's, but built once here.
+    */
+    void createBenchmarkInstances()
+    {
+        uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(BENCHMARK_INSTANCE_COUNT))));
+        float cell = 2.0f / columns;
+        mBenchmarkInstanceMatrices.resize(BENCHMARK_INSTANCE_COUNT);
+        for (uint32_t i = 0; i < BENCHMARK_INSTANCE_COUNT; ++i)
+        {
+            glm::mat4 matrix(1.0f);
+            matrix[0].x = cell;
+            matrix[1].y = cell;
+            matrix[3] = glm::vec4(-1.0f + (i % columns + 0.5f) * cell, -1.0f + (i / columns + 0.5f) * cell, 0.5f, 1.0f);
+            mBenchmarkInstanceMatrices[i] = matrix;
+        }
 
-            vkCmdDraw(mCommandBuffers[i], static_cast<uint32_t>(vertices.size()), 1, 0, 0);
-            vkCmdEndRenderPass(mCommandBuffers[i]);
+        logger.debug("Benchmark instances created (%u in a %u wide grid).", BENCHMARK_INSTANCE_COUNT, columns);
+    }
 
-            if (vkEndCommandBuffer(mCommandBuffers[i]) != VK_SUCCESS)
+    void createBenchmarkEntities()
+    {
+        BenchmarkRandom random(0x9e3779b9);
+
+        uint32_t groupCount = BENCHMARK_ENTITY_COUNT / BENCHMARK_ENTITY_GROUP_SIZE;
+        mScene.Reserve(RENDERABLE_COMPONENTS, BENCHMARK_ENTITY_COUNT);
+        mHierarchy.Reserve(BENCHMARK_ENTITY_COUNT + groupCount);
+        mBenchmarkEntities.reserve(BENCHMARK_ENTITY_COUNT);
+        mBenchmarkGroups.reserve(groupCount);
+        for (uint32_t group = 0; group < groupCount; ++group)
+        {
+            // each group is a pivot plus its children right after it, so building only ever appends.
+            glm::vec3 center(random() * 3.0f - 1.5f, random() * 3.0f - 1.5f, random() * 0.5f + 0.25f);
+            TransformNode pivot = mHierarchy.Insert(makeTransform(center), TRANSFORM_NODE_NONE, NULL_ENTITY);
+            mBenchmarkGroups.push_back(pivot);
+            for (uint32_t i = 0; i < BENCHMARK_ENTITY_GROUP_SIZE; ++i)
             {
-                logger.throw_error("failed to record a command buffer.");
+                glm::vec3 offset(random() - 0.5f, random() - 0.5f, random() * 0.5f - 0.25f);
+                TransformNode node = createRenderable(makeTransform(offset, 0.05f, random() * 6.2831853f), pivot, 0, (group * BENCHMARK_ENTITY_GROUP_SIZE + i) % BENCHMARK_ENTITY_MATERIALS);
+                mBenchmarkEntities.push_back(mHierarchy.GetEntity(node));
             }
         }
 
-        logger.debug("Command buffers created.");
+        logger.debug("Benchmark entities created (%u in %u groups, %u moving).", BENCHMARK_ENTITY_COUNT, groupCount, BENCHMARK_MOVING_GROUPS);
     }
 
-    void createSyncObjects()
+    void createBenchmarkSprites()
     {
-        mImageAvailableSemaphore.resize(MAX_FRAMES_IN_FLIGHT);
-        mRenderCompleteSemaphore.resize(MAX_FRAMES_IN_FLIGHT);
-        mInFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-
-        VkSemaphoreCreateInfo semaphoreInfo = {};
-        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-        VkFenceCreateInfo fenceInfo = {};
-        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        BenchmarkRandom random(0x85ebca6b);
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+        mBenchmarkSprites.resize(BENCHMARK_SPRITE_COUNT);
+        for (uint32_t i = 0; i < BENCHMARK_SPRITE_COUNT; ++i)
         {
-            if (vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &mImageAvailableSemaphore[i]) != VK_SUCCESS ||
-                vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &mRenderCompleteSemaphore[i]) != VK_SUCCESS)
-            {
-                logger.throw_error("failed to create a semaphore.");
-            }
-
-            if (vkCreateFence(mDevice, &fenceInfo, nullptr, &mInFlightFences[i]) != VK_SUCCESS)
-            {
-                logger.throw_error("failed to create a fence.");
-            }
+            Sprite& sprite = mBenchmarkSprites[i];
+            sprite.position = glm::vec2(random() * 2.0f - 1.0f, random() * 2.0f - 1.0f);
+            sprite.halfSize = glm::vec2(0.004f + random() * 0.004f);
+            sprite.rotation = random() * 6.2831853f;
+            sprite.color = glm::vec3(random(), random(), random());
+            // interleaved keys, the worst case for submission order: every neighbour differs.
+            sprite.layer = i % BENCHMARK_SPRITE_LAYERS;
+            sprite.pipeline = 0;
+            sprite.texture = i % BENCHMARK_SPRITE_TEXTURES;
         }
 
-        logger.debug("Semaphores and Fences created.");
+        logger.debug("Benchmark sprites created (%u).", BENCHMARK_SPRITE_COUNT);
     }
 
-    void mainLoop()
+    /*
+    Every sprite moves every frame: each drifts on its own small circle and spins.
+    Driven by the scene frame number so every run produces the same frames.
+    */
+    void addBenchmarkSprites()
     {
-        while (!glfwWindowShouldClose(pWindow) && !mInput.IsActionPressed('EXIT'))
+        PROFILE_FUNCTION();
+        float t = mBenchmarkSceneFrame * 0.02f;
+        for (const Sprite& base : mBenchmarkSprites)
         {
-            glfwPollEvents();
-            // update input after glfwPollEvents so we have fresh input data.
-            mInput.Update();
-            drawFrame();
+            Sprite sprite = base;
+            float phase = base.rotation;
+            sprite.position += glm::vec2(std::cos(t + phase), std::sin(t + phase)) * 0.05f;
+            sprite.rotation += t;
+            mSprites.Add(sprite);
         }
-
-        // operations in drawFrame() are asynchronous so we could still be drawing when we exit.
-        // to avoid issues, wait for the logical device to finish operations before exiting.
-        vkDeviceWaitIdle(mDevice);
     }
 
     void drawFrame()
     {
-        vkWaitForFences(mDevice, 1, &mInFlightFences[mCurrentFrame], VK_TRUE, (std::numeric_limits<uint64_t>::max)());
+        PROFILE_FUNCTION();
+        // time spent blocked on the gpu or the presentation engine, so the benchmark can tell it apart from cpu work.
+        auto waitStart = std::chrono::steady_clock::now();
+        uint64_t completedFrames = waitForFrameSlot();
+        mFrameWaitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+        readGpuFrameTime();
+        mDeletionQueue.Collect(completedFrames);
+        mDeletionQueue.SetFrameValue(mFrameNumber + 1);
 
         uint32_t imageIndex;
-        VkResult result = vkAcquireNextImageKHR(mDevice, mSwapchain, (std::numeric_limits<uint64_t>::max)(), mImageAvailableSemaphore[mCurrentFrame], VK_NULL_HANDLE, &imageIndex);
+        VkResult result;
+        waitStart = std::chrono::steady_clock::now();
+        {
+            PROFILE_ZONE("acquire");
+            result = vkAcquireNextImageKHR(mDevice, mSwapchain, (std::numeric_limits<uint64_t>::max)(), mImageAvailableSemaphore[mCurrentFrame], VK_NULL_HANDLE, &imageIndex);
+        }
+        mFrameWaitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
 
         if (result == VK_ERROR_OUT_OF_DATE_KHR)
         {
@@ -850,32 +2920,126 @@ private:
             logger.throw_error("failed to acquire swapchain image.");
         }
 
+        // push any uploads queued since last frame and drop finished staging memory. recording only
+        // acquires the uploads that are done or required, so this frame doesn't wait on the rest.
+        mTransfer.Flush();
+        mTransfer.Update();
+
+        // kick compute first so it runs while this frame is recorded. jobs overwrite what the previous
+        // frame's draws read, so it still starts after that frame's graphics submit.
+        VkPipelineStageFlags computeConsumerStages = 0;
+        uint64_t computeWaitValue = 0;
+        if (!mComputeJobs.empty())
+        {
+            VkCommandBuffer computeCommandBuffer = mAsyncCompute.BeginFrame(static_cast<uint32_t>(mCurrentFrame));
+            for (const auto& job : mComputeJobs)
+            {
+                job.record(computeCommandBuffer);
+                computeConsumerStages |= job.consumerStage;
+            }
+
+            std::vector<ComputeWait> computeWaits;
+            if (mTimelineSemaphoresSupported && mFrameNumber > 0)
+            {
+                computeWaits.push_back({ mFrameTimeline, mFrameNumber, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT });
+            }
+            else if (mComputeReadyPending != VK_NULL_HANDLE)
+            {
+                computeWaits.push_back({ mComputeReadyPending, 0, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT });
+                mComputeReadyPending = VK_NULL_HANDLE;
+            }
+            computeWaitValue = mAsyncCompute.Submit(computeWaits);
+        }
+
+        // the slot wait above guarantees the gpu is done with this frame's command buffer and ring region.
+        mUploadRing.BeginFrame(static_cast<uint32_t>(mCurrentFrame));
+        mSpriteRing.BeginFrame(static_cast<uint32_t>(mCurrentFrame));
+        mSprites.Build(mSpriteRing);
+        if (mSprites.GetVertexBytes() > 0)
+        {
+            mCapture.UploadBuffer(mSprites.GetVertexBuffer(), mSprites.GetVertexOffset(), mSprites.GetVertexData(), mSprites.GetVertexBytes());
+        }
+        buildHud();
+        vkResetCommandBuffer(mCommandBuffers[mCurrentFrame], 0);
+        recordCommandBuffer(mCommandBuffers[mCurrentFrame], imageIndex);
+
         VkSubmitInfo submitInfo = {};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-        VkSemaphore waitSemaphores[] = { mImageAvailableSemaphore[mCurrentFrame] };
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
+        // timeline values are ignored for binary semaphores, so those just get 0.
+        std::vector<VkSemaphore> waitSemaphores = { mImageAvailableSemaphore[mCurrentFrame] };
+        std::vector<VkPipelineStageFlags> waitStages = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+        std::vector<uint64_t> waitValues = { 0 };
+        bool waitsOnTimeline = false;
+        // the transfer timeline wait is only added when this frame acquired fresh uploads.
+        if (mUploadWaitValue > 0)
+        {
+            waitSemaphores.push_back(mTransfer.GetTimelineSemaphore());
+            waitStages.push_back(mUploadWaitStages);
+            waitValues.push_back(mUploadWaitValue);
+            waitsOnTimeline = true;
+        }
+        if (mAsyncCompute.HasPendingSignal())
+        {
+            waitSemaphores.push_back(mAsyncCompute.GetSignalSemaphore());
+            waitStages.push_back(computeConsumerStages);
+            waitValues.push_back(computeWaitValue);
+            waitsOnTimeline |= mTimelineSemaphoresSupported;
+            mAsyncCompute.ConsumePendingSignal();
+        }
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+        submitInfo.pWaitSemaphores = waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = waitStages.data();
         submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &mCommandBuffers[imageIndex];
-
-        VkSemaphore signalSemaphores[] = {mRenderCompleteSemaphore[mCurrentFrame] };
-        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pCommandBuffers = &mCommandBuffers[mCurrentFrame];
+
+        // present can only wait on binary semaphores, so render complete stays binary.
+        // with timelines, the frame counter is signalled alongside it and replaces the fence.
+        // without them, the next compute submit needs a binary semaphore of its own to wait on.
+        VkSemaphore signalSemaphores[] = { mRenderCompleteSemaphore[mCurrentFrame], mTimelineSemaphoresSupported ? mFrameTimeline : mComputeReadySemaphore[mCurrentFrame] };
+        uint64_t signalValues[] = { 0, mFrameNumber + 1 };
+        bool signalsComputeReady = !mTimelineSemaphoresSupported && !mComputeJobs.empty();
+        submitInfo.signalSemaphoreCount = mTimelineSemaphoresSupported || signalsComputeReady ? 2 : 1;
         submitInfo.pSignalSemaphores = signalSemaphores;
+        waitsOnTimeline |= mTimelineSemaphoresSupported;
+        if (signalsComputeReady)
+        {
+            mComputeReadyPending = mComputeReadySemaphore[mCurrentFrame];
+        }
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = submitInfo.waitSemaphoreCount;
+        timelineInfo.pWaitSemaphoreValues = waitValues.data();
+        timelineInfo.signalSemaphoreValueCount = submitInfo.signalSemaphoreCount;
+        timelineInfo.pSignalSemaphoreValues = signalValues;
+        if (waitsOnTimeline)
+        {
+            submitInfo.pNext = &timelineInfo;
+        }
+
+        writeLateFrameData();
 
-        vkResetFences(mDevice, 1, &mInFlightFences[mCurrentFrame]);
+        VkFence submitFence = VK_NULL_HANDLE;
+        if (!mTimelineSemaphoresSupported)
+        {
+            submitFence = mInFlightFences[mCurrentFrame];
+            vkResetFences(mDevice, 1, &submitFence);
+        }
 
-        if (vkQueueSubmit(mGraphicsQueue, 1, &submitInfo, mInFlightFences[mCurrentFrame]) != VK_SUCCESS)
         {
-            logger.throw_error("failed to submit draw command buffer!");
+            PROFILE_ZONE("submit");
+            if (vkQueueSubmit(mGraphicsQueue, 1, &submitInfo, submitFence) != VK_SUCCESS)
+            {
+                logger.throw_error("failed to submit draw command buffer!");
+            }
         }
+        mCapture.EndFrame();
 
         VkPresentInfoKHR presentInfo = {};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
         presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = signalSemaphores;
+        presentInfo.pWaitSemaphores = &mRenderCompleteSemaphore[mCurrentFrame];
 
         VkSwapchainKHR swapChains[] = { mSwapchain };
         presentInfo.swapchainCount = 1;
@@ -883,7 +3047,12 @@ private:
         presentInfo.pImageIndices = &imageIndex;
         presentInfo.pResults = nullptr; // optional
 
-        result = vkQueuePresentKHR(mPresentationQueue, &presentInfo);
+        waitStart = std::chrono::steady_clock::now();
+        {
+            PROFILE_ZONE("present");
+            result = vkQueuePresentKHR(mPresentationQueue, &presentInfo);
+        }
+        mFrameWaitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
         if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || mFramebuffersResized)
         {
             mFramebuffersResized = false;
@@ -894,46 +3063,118 @@ private:
             logger.throw_error("failed to present swap chain image.");
         }
 
-        mCurrentFrame = (mCurrentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        if (mFrameNumber == 0)
+        {
+            logger.debug("Time to first frame: %.2f ms.", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mStartTime).count());
+        }
+
+        mCurrentFrame = (mCurrentFrame + 1) % mFramesInFlight;
+        ++mFrameNumber;
     }
 
+    /*
+    Retire everything that depends on the swapchain. The swapchain itself stays alive
+    so the next createSwapChain() can pass it as oldSwapchain.
+    */
     void cleanupSwapChain()
     {
+        mRenderGraph.Reset(&mDeletionQueue);
+
         for (size_t i = 0, size = mSwapchainFramebuffers.size(); i < size; ++i)
         {
-            vkDestroyFramebuffer(mDevice, mSwapchainFramebuffers[i], nullptr);
+            mDeletionQueue.DestroyFramebuffer(mSwapchainFramebuffers[i]);
         }
-        vkFreeCommandBuffers(mDevice, mCommandPool, static_cast<uint32_t>(mCommandBuffers.size()), mCommandBuffers.data());
-        vkDestroyPipeline(mDevice, mGraphicsPipeline, nullptr);
-        vkDestroyPipelineLayout(mDevice, mPipelineLayout, nullptr);
-        vkDestroyRenderPass(mDevice, mRenderPass, nullptr);
+        mSwapchainFramebuffers.clear();
+        for (size_t i = 0, size = mHudFramebuffers.size(); i < size; ++i)
+        {
+            mDeletionQueue.DestroyFramebuffer(mHudFramebuffers[i]);
+        }
+        mHudFramebuffers.clear();
         for (size_t i = 0, size = mSwapchainImageViews.size(); i < size; ++i)
         {
-            vkDestroyImageView(mDevice, mSwapchainImageViews[i], nullptr);
+            mDeletionQueue.DestroyImageView(mSwapchainImageViews[i]);
         }
-        vkDestroySwapchainKHR(mDevice, mSwapchain, nullptr);
+        mSwapchainImageViews.clear();
+    }
+
+    void cleanupPipeline()
+    {
+        // every variant was built against the render pass and formats going away here.
+        mPipelineVariants.Clear();
+        mPipelineLibrary.Clear();
+        mGraphicsPipeline = VK_NULL_HANDLE;
+        mDepthPrepassPipeline = VK_NULL_HANDLE;
+        mSpritePipeline = VK_NULL_HANDLE;
+        mHudPipeline = VK_NULL_HANDLE;
+        mParticlePipeline = VK_NULL_HANDLE;
+        // pipelines don't reference their modules once created, so these can go right away.
+        vkDestroyShaderModule(mDevice, mVertShaderModule, nullptr);
+        vkDestroyShaderModule(mDevice, mFragShaderModule, nullptr);
+        vkDestroyShaderModule(mDevice, mSpriteVertShaderModule, nullptr);
+        vkDestroyShaderModule(mDevice, mHudVertShaderModule, nullptr);
+        vkDestroyShaderModule(mDevice, mHudFragShaderModule, nullptr);
+        mVertShaderModule = VK_NULL_HANDLE;
+        mFragShaderModule = VK_NULL_HANDLE;
+        mSpriteVertShaderModule = VK_NULL_HANDLE;
+        mHudVertShaderModule = VK_NULL_HANDLE;
+        mHudFragShaderModule = VK_NULL_HANDLE;
+        vkDestroyShaderModule(mDevice, mParticleVertShaderModule, nullptr);
+        mParticleVertShaderModule = VK_NULL_HANDLE;
+        mDeletionQueue.DestroyPipelineLayout(mPipelineLayout);
+        mDeletionQueue.DestroyRenderPass(mRenderPass);
+        mDeletionQueue.DestroyRenderPass(mHudRenderPass);
     }
 
     void cleanup()
     {
         mInput.Shutdown();
+        mCapture.Shutdown();
+        mScene.Shutdown();
+        mHierarchy.Shutdown();
+        mCuller.Shutdown();
 
         cleanupSwapChain();
+        cleanupPipeline();
+        logger.debug("Pipeline variants: %u first used after startup.", mPipelineVariants.GetMissCount());
+        mPipelineVariants.Shutdown();
+        mPipelineLibrary.Shutdown();
+        vkDestroySwapchainKHR(mDevice, mSwapchain, nullptr);
+        // mainLoop() already waited for the device, so everything still queued can go.
+        mDeletionQueue.Shutdown();
+
+        vkFreeCommandBuffers(mDevice, mCommandPool, static_cast<uint32_t>(mCommandBuffers.size()), mCommandBuffers.data());
+        vkDestroyDescriptorPool(mDevice, mDescriptorPool, nullptr);
+        vkDestroyDescriptorSetLayout(mDevice, mDescriptorSetLayout, nullptr);
+        mUploadRing.Shutdown();
+        mSprites.Shutdown();
+        mHud.Shutdown();
+        mParticles.Shutdown();
+        mComputeGraph.Reset();
+        mSpriteRing.Shutdown();
+        mTransfer.Shutdown();
+        mAsyncCompute.Shutdown();
 
         vkDestroyBuffer(mDevice, mVertexBuffer, nullptr);
+        memoryBudget.TrackFree(mVertexBufferMemory);
         vkFreeMemory(mDevice, mVertexBufferMemory, nullptr);
+        profiler.ShutdownGpu();
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+        for (size_t i = 0; i < mFramesInFlight; ++i)
         {
             vkDestroySemaphore(mDevice, mImageAvailableSemaphore[i], nullptr);
             vkDestroySemaphore(mDevice, mRenderCompleteSemaphore[i], nullptr);
             vkDestroyFence(mDevice, mInFlightFences[i], nullptr);
+            vkDestroySemaphore(mDevice, mComputeReadySemaphore[i], nullptr);
         }
+        vkDestroySemaphore(mDevice, mFrameTimeline, nullptr);
         vkDestroyCommandPool(mDevice, mCommandPool, nullptr);
+        // everything is freed by now, so whatever is still tracked leaked.
+        memoryBudget.Shutdown();
         vkDestroyDevice(mDevice, nullptr);
         if (enableValidationLayers)
         {
             DestroyDebugUtilsMessengerEXT(mInstance, mCallback, nullptr);
+            mValidationFilter.Shutdown();
         }
         vkDestroySurfaceKHR(mInstance, mSurface, nullptr);
         vkDestroyInstance(mInstance, nullptr);
@@ -1013,7 +3254,8 @@ private:
 
     static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData)
     {
-        logger.validation("[Validation Layer] %s", pCallbackData->pMessage);
+        // this runs on whichever thread made the vulkan call; the filter is thread safe.
+        static_cast<ValidationFilter*>(pUserData)->Submit(messageSeverity, messageType, pCallbackData);
         return VK_FALSE;
     }
 
@@ -1093,13 +3335,8 @@ private:
             return 0;
         }
 
-        VkPhysicalDeviceFeatures deviceFeatures;
-        vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
-        if (!deviceFeatures.geometryShader)
-        {
-            return 0;
-        }
-        
+        // no optional features are required, so software implementations (lavapipe, swiftshader) qualify too.
+        // they only win when nothing else is available.
         int score = 0;
 
         VkPhysicalDeviceProperties deviceProperties;
@@ -1124,6 +3361,9 @@ private:
         std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
         vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
+        // without a compute-only family, async compute (the particle simulation) goes to a queue of the
+        // graphics family, so a graphics family that can also dispatch wins. vulkan guarantees there is one.
+        bool graphicsCanCompute = false;
         int i = 0;
         for (const auto& queueFamily : queueFamilies)
         {
@@ -1131,25 +3371,163 @@ private:
             vkGetPhysicalDeviceSurfaceSupportKHR(device, i, mSurface, &presentSupport);
             if (queueFamily.queueCount > 0)
             {
-                if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+                bool canCompute = (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+                if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT && (!indices.graphicsFamily.has_value() || (canCompute && !graphicsCanCompute)))
                 {
                     indices.graphicsFamily = i;
+                    graphicsCanCompute = canCompute;
                 }
-                if (presentSupport)
+                if (presentSupport && !indices.presentFamily.has_value())
                 {
                     indices.presentFamily = i;
                 }
+                // a family that can transfer but not draw or dispatch is backed by the copy engines,
+                // which is exactly what we want streaming to run on.
+                if (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT
+                    && !(queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+                    && !indices.transferFamily.has_value())
+                {
+                    indices.transferFamily = i;
+                }
+                if (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT
+                    && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+                    && !indices.computeFamily.has_value())
+                {
+                    indices.computeFamily = i;
+                }
             }
 
-            if (indices.isComplete())
+            // keep going even once we're complete; the optional families can come later.
+            ++i;
+        }
+
+        return indices;
+    }
+
+    bool checkDeviceExtensionSupport(VkPhysicalDevice device, const char* extensionName)
+    {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+        for (const auto& extension : availableExtensions)
+        {
+            if (strcmp(extension.extensionName, extensionName) == 0)
             {
-                break;
+                return true;
             }
+        }
+        return false;
+    }
 
-            ++i;
+    bool checkDynamicRenderingSupport(VkPhysicalDevice device)
+    {
+        if (!checkDeviceExtensionSupport(device, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME))
+        {
+            return false;
         }
 
-        return indices;
+        VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = {};
+        dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+
+        VkPhysicalDeviceFeatures2 features2 = {};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &dynamicRenderingFeatures;
+        vkGetPhysicalDeviceFeatures2(device, &features2);
+
+        return dynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+    }
+
+    bool checkGraphicsPipelineLibrarySupport(VkPhysicalDevice device)
+    {
+        if (!checkDeviceExtensionSupport(device, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) ||
+            !checkDeviceExtensionSupport(device, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME))
+        {
+            return false;
+        }
+
+        VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures = {};
+        pipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+
+        VkPhysicalDeviceFeatures2 features2 = {};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &pipelineLibraryFeatures;
+        vkGetPhysicalDeviceFeatures2(device, &features2);
+
+        return pipelineLibraryFeatures.graphicsPipelineLibrary == VK_TRUE;
+    }
+
+    bool checkTimelineSemaphoreSupport(VkPhysicalDevice device)
+    {
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(device, &deviceProperties);
+        if (deviceProperties.apiVersion < VK_API_VERSION_1_2)
+        {
+            return false;
+        }
+
+        VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+        vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+        VkPhysicalDeviceFeatures2 features2 = {};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &vulkan12Features;
+        vkGetPhysicalDeviceFeatures2(device, &features2);
+
+        return vulkan12Features.timelineSemaphore == VK_TRUE;
+    }
+
+    VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
+    {
+        for (VkFormat format : candidates)
+        {
+            VkFormatProperties properties;
+            vkGetPhysicalDeviceFormatProperties(mPhysicalDevice, format, &properties);
+            VkFormatFeatureFlags supported = tiling == VK_IMAGE_TILING_LINEAR ? properties.linearTilingFeatures : properties.optimalTilingFeatures;
+            if ((supported & features) == features)
+            {
+                return format;
+            }
+        }
+
+        logger.throw_error("failed to find a supported format.");
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    VkFormat findDepthFormat()
+    {
+        // depth-only formats first; nothing uses stencil yet.
+        return findSupportedFormat(
+            { VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D32_SFLOAT_S8_UINT },
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    }
+
+    /*
+    Highest sample count that is <= requested and usable for both our color and depth attachments.
+    */
+    VkSampleCountFlagBits chooseMsaaSamples(uint32_t requested)
+    {
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(mPhysicalDevice, &deviceProperties);
+        VkSampleCountFlags supported = deviceProperties.limits.framebufferColorSampleCounts & deviceProperties.limits.framebufferDepthSampleCounts;
+
+        const VkSampleCountFlagBits candidates[] = { VK_SAMPLE_COUNT_8_BIT, VK_SAMPLE_COUNT_4_BIT, VK_SAMPLE_COUNT_2_BIT };
+        for (VkSampleCountFlagBits samples : candidates)
+        {
+            if (samples <= requested && (supported & samples))
+            {
+                return samples;
+            }
+        }
+        return VK_SAMPLE_COUNT_1_BIT;
+    }
+
+    static bool hasStencilComponent(VkFormat format)
+    {
+        return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D16_UNORM_S8_UINT;
     }
 
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device)
@@ -1214,69 +3592,382 @@ private:
         game->mFramebuffersResized = true;
     }
 
-    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
-    {
-        VkPhysicalDeviceMemoryProperties memProperties;
-        vkGetPhysicalDeviceMemoryProperties(mPhysicalDevice, &memProperties);
-
-        for (uint32_t i = 0, count = memProperties.memoryTypeCount; i < count; ++i)
-        {
-            if (typeFilter & (1 << i) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
-            {
-                logger.debug("Found suitable memory type.");
-                return i;
-            }
-        }
-
-        logger.throw_error("failed to find suitable memory type.");
-        return 0;
-    }
-
 /*************************
 * VARIABLES
 ***************************/
+    GameSettings mSettings;
     Input mInput;
 
     GLFWwindow* pWindow;
     VkInstance mInstance;
     VkDebugUtilsMessengerEXT mCallback;
+    ValidationFilter mValidationFilter;
     VkPhysicalDevice mPhysicalDevice = VK_NULL_HANDLE;
     VkDevice mDevice;
     VkQueue mGraphicsQueue;
     VkSurfaceKHR mSurface;
     VkQueue mPresentationQueue;
-
-    VkSwapchainKHR mSwapchain;
+    VkQueue mTransferQueue;
+    VkQueue mComputeQueue;
+    bool mTimelineSemaphoresSupported = false;
+    bool mUseDynamicRendering = false;
+    bool mUsePipelineLibrary = false;
+    bool mMemoryBudgetSupported = false;
+
+    VkSwapchainKHR mSwapchain = VK_NULL_HANDLE;
     std::vector<VkImage> mSwapchainImages;
     VkFormat mSwapchainImageFormat;
     VkExtent2D mSwapchainExtent;
+    VkPresentModeKHR mPresentMode = VK_PRESENT_MODE_FIFO_KHR;
     std::vector<VkImageView> mSwapchainImageViews;
     std::vector<VkFramebuffer> mSwapchainFramebuffers;
+    std::vector<VkFramebuffer> mHudFramebuffers;
 
     VkRenderPass mRenderPass;
+    VkRenderPass mHudRenderPass = VK_NULL_HANDLE;
+    VkDescriptorSetLayout mDescriptorSetLayout;
     VkPipelineLayout mPipelineLayout;
-    VkPipeline mGraphicsPipeline;
+    // the variants in use right now, owned by mPipelineVariants.
+    VkPipeline mGraphicsPipeline = VK_NULL_HANDLE;
+    VkPipeline mDepthPrepassPipeline = VK_NULL_HANDLE;
+    VkPipeline mSpritePipeline = VK_NULL_HANDLE;
+    VkPipeline mHudPipeline = VK_NULL_HANDLE;
+    PipelineVariants mPipelineVariants;
+    // only initialized when mUsePipelineLibrary; variants are created monolithically otherwise.
+    PipelineLibrary mPipelineLibrary;
+    VkShaderModule mVertShaderModule = VK_NULL_HANDLE;
+    VkShaderModule mFragShaderModule = VK_NULL_HANDLE;
+    VkShaderModule mSpriteVertShaderModule = VK_NULL_HANDLE;
+    VkShaderModule mHudVertShaderModule = VK_NULL_HANDLE;
+    VkShaderModule mHudFragShaderModule = VK_NULL_HANDLE;
+    VkShaderModule mParticleVertShaderModule = VK_NULL_HANDLE;
+    VkPipeline mParticlePipeline = VK_NULL_HANDLE;
+    // only initialized with --particles.
+    ParticleSystem mParticles;
+    std::chrono::steady_clock::time_point mParticleTime;
+    // the simulation's passes, recorded into the async compute command buffer.
+    RenderGraph mComputeGraph;
+    RenderGraphResource mSimulateSourceResource = RENDER_GRAPH_INVALID_RESOURCE;
+    RenderGraphResource mSimulateDestinationResource = RENDER_GRAPH_INVALID_RESOURCE;
+    RenderGraphResource mSimulateStateResource = RENDER_GRAPH_INVALID_RESOURCE;
+    bool mParticlesSimulated = false;
+    // F5. picks the shading variant, see getShadingVariant().
+    bool mVertexColor = true;
+    VkFormat mDepthFormat = VK_FORMAT_UNDEFINED;
+    VkSampleCountFlagBits mMsaaSamples = VK_SAMPLE_COUNT_1_BIT;
+    VkFormat mRenderPassFormat = VK_FORMAT_UNDEFINED;
+    VkSampleCountFlagBits mRenderPassSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    DeletionQueue mDeletionQueue;
+    RenderGraph mRenderGraph;
+    RenderGraphResource mSwapchainResource = RENDER_GRAPH_INVALID_RESOURCE;
+    RenderGraphResource mDepthResource = RENDER_GRAPH_INVALID_RESOURCE;
+    RenderGraphResource mMsaaColorResource = RENDER_GRAPH_INVALID_RESOURCE;
+    RenderGraphResource mParticleResource = RENDER_GRAPH_INVALID_RESOURCE;
+    RenderGraphResource mParticleStateResource = RENDER_GRAPH_INVALID_RESOURCE;
+    uint32_t mCurrentImageIndex = 0;
+    uint32_t mFrameDynamicOffsets[2] = {};
+    FrameUniforms* mFrameUniforms = nullptr;
     VkCommandPool mCommandPool;
     std::vector<VkCommandBuffer> mCommandBuffers;
 
     std::vector<VkSemaphore> mImageAvailableSemaphore;
     std::vector<VkSemaphore> mRenderCompleteSemaphore;
-    std::vector<VkFence> mInFlightFences;
+    std::vector<VkFence> mInFlightFences;     // only when timeline semaphores aren't supported
+    VkSemaphore mFrameTimeline = VK_NULL_HANDLE;
+    std::vector<VkSemaphore> mComputeReadySemaphore;    // only when timeline semaphores aren't supported
+    VkSemaphore mComputeReadyPending = VK_NULL_HANDLE;  // signalled by the last graphics submit, not waited on yet
+    uint32_t mFramesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+    // frame slot: indexes everything that exists once per frame in flight. never the swapchain image index.
     size_t mCurrentFrame = 0;
+    uint64_t mFrameNumber = 0;
 
     bool mFramebuffersResized = false;
 
     VkBuffer mVertexBuffer;
     VkDeviceMemory mVertexBufferMemory;
+
+    EntityStore mScene;
+    TransformHierarchy mHierarchy;
+    Culler mCuller;
+    VisibleSet mVisible = {};
+    DrawList mDrawList;
+    std::vector<SceneMesh> mMeshes;
+    glm::mat4 mViewProj = glm::mat4(1.0f);
+
+    // gpu frame time, read from the profiler's frame zone.
+    double mGpuFrameMs = -1.0;
+    double mFrameWaitMs = 0.0;
+    std::chrono::steady_clock::time_point mPreviousFrameStart = std::chrono::steady_clock::now();
+    uint64_t mSwapchainRecreateCount = 0;
+
+    Benchmark mBenchmark;
+    FrameCapture mCapture;
+    BenchmarkScene mBenchmarkScene = BENCHMARK_SCENE_NONE;
+    uint32_t mBenchmarkSceneFrame = 0;
+    uint64_t mBenchmarkSceneRecreates = 0;
+    VkBuffer mBenchmarkVertexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory mBenchmarkVertexBufferMemory = VK_NULL_HANDLE;
+    uint32_t mBenchmarkVertexCount = 0;
+    std::vector<glm::mat4> mBenchmarkInstanceMatrices;
+    std::vector<Entity> mBenchmarkEntities;
+    std::vector<TransformNode> mBenchmarkGroups;
+    std::vector<Sprite> mBenchmarkSprites;
+
+    UploadRing mUploadRing;
+    UploadRing mSpriteRing;
+    SpriteBatch mSprites;
+    Hud mHud;
+    // draws and triangles recorded in the latest command buffer.
+    uint32_t mFrameDrawCount = 0;
+    // draw list instances past MAX_DRAW_INSTANCES in the latest frame. warned about once.
+    uint32_t mFrameDroppedInstances = 0;
+    bool mInstanceLimitWarned = false;
+    uint64_t mFrameTriangleCount = 0;
+    double mLastCpuMs = -1.0;
+    TransferQueue mTransfer;
+    uint64_t mUploadWaitValue = 0;
+    VkPipelineStageFlags mUploadWaitStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+
+    struct ComputeJob
+    {
+        std::function<void(VkCommandBuffer)> record;
+        VkPipelineStageFlags consumerStage;
+    };
+    AsyncCompute mAsyncCompute;
+    std::vector<ComputeJob> mComputeJobs;
+    VkDescriptorPool mDescriptorPool;
+    VkDescriptorSet mDescriptorSet;
+
+    std::future<void> mShaderLoad;
+    std::vector<char> mVertShaderCode;
+    std::vector<char> mSpriteVertShaderCode;
+    std::vector<char> mFragShaderCode;
+    std::vector<char> mHudVertShaderCode;
+    std::vector<char> mHudFragShaderCode;
+    std::vector<char> mParticleVertShaderCode;
+    std::vector<std::pair<std::string, double>> mStartupTimings;
+
+    std::chrono::steady_clock::time_point mStartTime = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point mLastFrameTime = mStartTime;
 };
 
-int main()
+/*
+Culls the same random spheres on each supported path, single threaded and spread over the
+workers, and reports objects culled per second. Runs without a window or device, so it
+measures only the culling itself.
+*/
+void runCullingBenchmark(const GameSettings& settings)
+{
+    // same layout as the entities benchmark scene, but with depth spread out too so every plane rejects some.
+    std::vector<glm::vec4> spheres(CULL_BENCHMARK_OBJECTS);
+    BenchmarkRandom random(0x9e3779b9);
+    for (auto& sphere : spheres)
+    {
+        sphere = glm::vec4(random() * 4.0f - 2.0f, random() * 4.0f - 2.0f, random() * 2.0f - 0.5f, 0.05f);
+    }
+    std::vector<uint32_t> visible(CULL_BENCHMARK_OBJECTS);
+    // clip space itself: x and y in -1..1, z in 0..1.
+    Frustum frustum = ExtractFrustum(glm::mat4(1.0f));
+
+    Culler culler;
+    CullingInfo cullingInfo = {};
+    culler.Initialize(&cullingInfo);
+
+    BenchmarkInfo benchmarkInfo = {};
+    benchmarkInfo.outputPath = settings.benchmarkOutput;
+    benchmarkInfo.config = {
+        { "version", std::to_string(VERSION_MAJOR) + "." + std::to_string(VERSION_MINOR) + "." + std::to_string(VERSION_PATCH) },
+        { "benchmark", "culling" },
+        { "objects", std::to_string(CULL_BENCHMARK_OBJECTS) },
+        { "runsPerScene", std::to_string(CULL_BENCHMARK_RUNS) },
+        { "workerThreads", std::to_string(culler.GetWorkerCount()) }
+    };
+    Benchmark benchmark;
+    benchmark.Initialize(&benchmarkInfo);
+
+    for (uint32_t path = 0; path < CULLING_PATH_COUNT; ++path)
+    {
+        if (!culler.IsPathSupported(static_cast<CullingPath>(path)))
+        {
+            logger.debug("Culling path %s not supported, skipped.", Culler::GetPathName(static_cast<CullingPath>(path)));
+            continue;
+        }
+        culler.SetPath(static_cast<CullingPath>(path));
+
+        for (bool parallel : { false, true })
+        {
+            culler.SetParallel(parallel);
+            std::string name = std::string(Culler::GetPathName(culler.GetPath())) + (parallel ? " threaded" : " single");
+            benchmark.BeginScene(name.c_str());
+
+            uint32_t visibleCount = 0;
+            double totalMs = 0.0;
+            for (uint32_t run = 0; run < CULL_BENCHMARK_WARMUP_RUNS + CULL_BENCHMARK_RUNS; ++run)
+            {
+                auto start = std::chrono::steady_clock::now();
+                visibleCount = culler.Cull(frustum, spheres.data(), CULL_BENCHMARK_OBJECTS, visible.data());
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                if (run >= CULL_BENCHMARK_WARMUP_RUNS)
+                {
+                    benchmark.AddFrame({ ms, ms, -1.0 });
+                    totalMs += ms;
+                }
+            }
+
+            double objectsPerSecond = CULL_BENCHMARK_OBJECTS * static_cast<double>(CULL_BENCHMARK_RUNS) / (totalMs / 1000.0);
+            benchmark.EndScene({
+                { "objects", CULL_BENCHMARK_OBJECTS },
+                { "visible", visibleCount },
+                { "objectsPerSecond", static_cast<uint64_t>(objectsPerSecond) }
+            });
+            logger.debug("Culling %s: %.1f M objects/s (%u of %u visible).", name.c_str(), objectsPerSecond / 1000000.0, visibleCount, CULL_BENCHMARK_OBJECTS);
+        }
+    }
+
+    benchmark.Shutdown();
+    culler.Shutdown();
+}
+
+GameSettings parseSettings(int argc, char* argv[])
+{
+    GameSettings settings;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--depth-prepass") == 0)
+        {
+            settings.depthPrepass = true;
+        }
+        else if (strcmp(argv[i], "--msaa") == 0 && i + 1 < argc)
+        {
+            int samples = atoi(argv[++i]);
+            if (samples != 1 && samples != 2 && samples != 4 && samples != 8)
+            {
+                logger.warn("--msaa takes 1, 2, 4 or 8 (got '%s'). MSAA disabled.", argv[i]);
+                samples = 1;
+            }
+            settings.msaaSamples = static_cast<uint32_t>(samples);
+        }
+        else if (strcmp(argv[i], "--validation-severity") == 0 && i + 1 < argc)
+        {
+            // each level includes everything more severe than it.
+            const char* level = argv[++i];
+            VkDebugUtilsMessageSeverityFlagsEXT mask = VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+            if (strcmp(level, "verbose") == 0)
+            {
+                mask |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+            }
+            else if (strcmp(level, "info") == 0)
+            {
+                mask |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+            }
+            else if (strcmp(level, "warning") == 0)
+            {
+                mask |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+            }
+            else if (strcmp(level, "error") != 0)
+            {
+                logger.warn("--validation-severity takes verbose, info, warning or error (got '%s'). Using error.", level);
+            }
+            settings.validationSeverity = mask;
+        }
+        else if (strcmp(argv[i], "--validation-repeats") == 0 && i + 1 < argc)
+        {
+            settings.validationMaxRepeats = static_cast<uint32_t>((std::max)(atoi(argv[++i]), 0));
+        }
+        else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc)
+        {
+            int frames = atoi(argv[++i]);
+            if (frames < 1 || frames > static_cast<int>(MAX_FRAMES_IN_FLIGHT))
+            {
+                logger.warn("--frames-in-flight takes 1 to %u (got '%s'). Using %u.", MAX_FRAMES_IN_FLIGHT, argv[i], DEFAULT_FRAMES_IN_FLIGHT);
+                frames = DEFAULT_FRAMES_IN_FLIGHT;
+            }
+            settings.framesInFlight = static_cast<uint32_t>(frames);
+        }
+        else if (strcmp(argv[i], "--benchmark") == 0)
+        {
+            settings.benchmark = true;
+        }
+        else if (strcmp(argv[i], "--benchmark-frames") == 0 && i + 1 < argc)
+        {
+            settings.benchmarkFrames = static_cast<uint32_t>((std::max)(atoi(argv[++i]), 1));
+        }
+        else if (strcmp(argv[i], "--benchmark-out") == 0 && i + 1 < argc)
+        {
+            settings.benchmarkOutput = argv[++i];
+        }
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+        {
+            settings.profileOutput = argv[++i];
+        }
+        else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+        {
+            settings.captureOutput = argv[++i];
+        }
+        else if (strcmp(argv[i], "--capture-frames") == 0 && i + 1 < argc)
+        {
+            settings.captureFrames = static_cast<uint32_t>((std::max)(atoi(argv[++i]), 1));
+        }
+        else if (strcmp(argv[i], "--memory-report") == 0 && i + 1 < argc)
+        {
+            settings.memoryReportInterval = static_cast<uint32_t>((std::max)(atoi(argv[++i]), 0));
+        }
+        else if (strcmp(argv[i], "--hud") == 0)
+        {
+            settings.hud = true;
+        }
+        else if (strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+        {
+            int particles = atoi(argv[++i]);
+            if (particles < 0 || static_cast<uint32_t>(particles) > PARTICLE_MAX_COUNT)
+            {
+                particles = particles < 0 ? 0 : static_cast<int>(PARTICLE_MAX_COUNT);
+                logger.warn("--particles takes 0 to %u (got '%s'). Using %d.", PARTICLE_MAX_COUNT, argv[i], particles);
+            }
+            settings.particles = static_cast<uint32_t>(particles);
+        }
+        else if (strcmp(argv[i], "--no-pipeline-library") == 0)
+        {
+            settings.pipelineLibrary = false;
+        }
+        else if (strcmp(argv[i], "--color-levels") == 0 && i + 1 < argc)
+        {
+            int levels = atoi(argv[++i]);
+            if (levels < 0 || levels > 15)
+            {
+                logger.warn("--color-levels takes 0 to 15 (got '%s'). Using 0.", argv[i]);
+                levels = 0;
+            }
+            settings.colorLevels = static_cast<uint32_t>(levels);
+        }
+        else if (strcmp(argv[i], "--cull-benchmark") == 0)
+        {
+            settings.cullBenchmark = true;
+        }
+        else
+        {
+            logger.warn("Unknown argument '%s' ignored.", argv[i]);
+        }
+    }
+    return settings;
+}
+
+int main(int argc, char* argv[])
 {
     auto exitCode = EXIT_SUCCESS;
-    Game game;
+    GameSettings settings = parseSettings(argc, argv);
+    Game game(settings);
     try
     {
-        game.run();
+        if (settings.cullBenchmark)
+        {
+            runCullingBenchmark(settings);
+        }
+        else
+        {
+            game.run();
+        }
     }
     catch (const std::exception& e)
     {
@@ -0,0 +1,1020 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "engine/benchmark.h"
+#include "engine/framecapture.h"
+#include "engine/logger.h"
+#include "engine/vkutil.h"
+#include "engine/vulkanloader.h"
+
+/*
+VulkaReplay: re-issues a capture recorded with Vulka --capture, headless, and times every frame.
+No window, no swapchain and no game logic, so a change in these numbers is a change in what the
+gpu (or driver) does with the same commands.
+
+    VulkaReplay <capture> [--loops N] [--out results.json] [--validation]
+
+Frames are replayed one at a time (submit, wait) so every frame is measured in isolation.
+Resources are created the first time through and kept for the following loops; destroy
+records are ignored and everything is released at exit.
+*/
+
+const std::vector<const char*> validationLayers = {
+    "VK_LAYER_LUNARG_standard_validation"
+};
+
+// one host visible buffer holds the frame uniforms, then the instance world matrices. the instance
+// range is the engine's, so every captured instance has its matrix.
+const VkDeviceSize FRAME_UNIFORM_RANGE = 256;
+const VkDeviceSize FRAME_INSTANCE_RANGE = FRAME_CAPTURE_INSTANCE_RANGE;
+const VkDeviceSize FRAME_DATA_BUFFER_SIZE = FRAME_UNIFORM_RANGE + FRAME_INSTANCE_RANGE;
+
+struct ReplaySettings
+{
+    std::string capturePath;
+    std::string outputPath = "replay.json";
+    uint32_t loops = 1;
+    bool validation = false;
+};
+
+class Replayer
+{
+public:
+    Replayer(const ReplaySettings& settings) : mSettings(settings) {}
+
+    void run()
+    {
+        mCapture.Open(mSettings.capturePath.c_str());
+        initVulkan();
+        replay();
+        cleanup();
+    }
+
+private:
+    struct ReplayBuffer
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+    };
+
+    struct RenderTarget
+    {
+        VkImage colorImage = VK_NULL_HANDLE;
+        VkImage depthImage = VK_NULL_HANDLE;
+        VkDeviceMemory colorMemory = VK_NULL_HANDLE;
+        VkDeviceMemory depthMemory = VK_NULL_HANDLE;
+        VkImageView colorView = VK_NULL_HANDLE;
+        VkImageView depthView = VK_NULL_HANDLE;
+        VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    };
+
+    typedef std::tuple<VkFormat, VkFormat, VkSampleCountFlagBits> RenderPassKey;
+    typedef std::tuple<VkFormat, VkFormat, VkSampleCountFlagBits, uint32_t, uint32_t> RenderTargetKey;
+
+    void initVulkan()
+    {
+        createInstance();
+        pickPhysicalDevice();
+        createLogicalDevice();
+        createCommandObjects();
+        createDescriptorObjects();
+        logger.debug("Replay device ready.");
+    }
+
+    void createInstance()
+    {
+        // no glfw here, so find the loader ourselves.
+        mVulkanLibrary = LoadLibraryA("vulkan-1.dll");
+        if (mVulkanLibrary == nullptr)
+        {
+            logger.throw_error("vulkan-1.dll not found. Is the Vulkan runtime installed?");
+        }
+        LoadVulkanGlobalFunctions((PFN_vkGetInstanceProcAddr)GetProcAddress(mVulkanLibrary, "vkGetInstanceProcAddr"));
+
+        VkApplicationInfo appInfo = {};
+        appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        appInfo.pApplicationName = "VulkaReplay";
+        appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+        appInfo.pEngineName = "No Engine";
+        appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+        appInfo.apiVersion = VK_API_VERSION_1_0;
+
+        // headless: no surface extensions at all.
+        VkInstanceCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        createInfo.pApplicationInfo = &appInfo;
+        if (mSettings.validation)
+        {
+            createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
+            createInfo.ppEnabledLayerNames = validationLayers.data();
+        }
+
+        if (vkCreateInstance(&createInfo, nullptr, &mInstance) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create instance.");
+        }
+        LoadVulkanInstanceFunctions(mInstance);
+    }
+
+    void pickPhysicalDevice()
+    {
+        uint32_t deviceCount = 0;
+        vkEnumeratePhysicalDevices(mInstance, &deviceCount, nullptr);
+        std::vector<VkPhysicalDevice> devices(deviceCount);
+        vkEnumeratePhysicalDevices(mInstance, &deviceCount, devices.data());
+
+        // any device with a graphics queue will do; discrete wins, like in the game.
+        int bestScore = -1;
+        for (const auto& device : devices)
+        {
+            uint32_t queueFamilyCount = 0;
+            vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+            std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+            vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+
+            for (uint32_t i = 0; i < queueFamilyCount; ++i)
+            {
+                if (!(queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+                {
+                    continue;
+                }
+
+                VkPhysicalDeviceProperties deviceProperties;
+                vkGetPhysicalDeviceProperties(device, &deviceProperties);
+                int score = deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU ? 1 : 0;
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    mPhysicalDevice = device;
+                    mQueueFamily = i;
+                    mTimestampValidBits = queueFamilies[i].timestampValidBits;
+                    mTimestampPeriod = deviceProperties.limits.timestampPeriod;
+                }
+                break;
+            }
+        }
+
+        if (mPhysicalDevice == VK_NULL_HANDLE)
+        {
+            logger.throw_error("failed to find a device with a graphics queue.");
+        }
+    }
+
+    void createLogicalDevice()
+    {
+        float queuePriority = 1.0f;
+        VkDeviceQueueCreateInfo queueCreateInfo = {};
+        queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueCreateInfo.queueFamilyIndex = mQueueFamily;
+        queueCreateInfo.queueCount = 1;
+        queueCreateInfo.pQueuePriorities = &queuePriority;
+
+        VkPhysicalDeviceFeatures deviceFeatures = {};
+
+        VkDeviceCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.queueCreateInfoCount = 1;
+        createInfo.pQueueCreateInfos = &queueCreateInfo;
+        createInfo.pEnabledFeatures = &deviceFeatures;
+
+        if (vkCreateDevice(mPhysicalDevice, &createInfo, nullptr, &mDevice) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create logical device.");
+        }
+        LoadVulkanDeviceFunctions(mDevice);
+        vkGetDeviceQueue(mDevice, mQueueFamily, 0, &mQueue);
+    }
+
+    void createCommandObjects()
+    {
+        VkCommandPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolInfo.queueFamilyIndex = mQueueFamily;
+        if (vkCreateCommandPool(mDevice, &poolInfo, nullptr, &mCommandPool) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create command pool.");
+        }
+
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = mCommandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(mDevice, &allocInfo, &mCommandBuffer) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to allocate command buffer.");
+        }
+
+        VkFenceCreateInfo fenceInfo = {};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkCreateFence(mDevice, &fenceInfo, nullptr, &mFence) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create fence.");
+        }
+
+        if (mTimestampValidBits != 0)
+        {
+            VkQueryPoolCreateInfo queryInfo = {};
+            queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            queryInfo.queryCount = 2;
+            if (vkCreateQueryPool(mDevice, &queryInfo, nullptr, &mQueryPool) != VK_SUCCESS)
+            {
+                logger.throw_error("failed to create timestamp query pool.");
+            }
+        }
+        else
+        {
+            logger.warn("The graphics queue doesn't support timestamps. GPU times won't be reported.");
+        }
+    }
+
+    /*
+    Same set layout as Game::createDescriptorSetLayout(), so captured shaders find their bindings.
+    */
+    void createDescriptorObjects()
+    {
+        std::array<VkDescriptorSetLayoutBinding, 2> bindings = {};
+        bindings[0].binding = 0;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        bindings[0].descriptorCount = 1;
+        bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        bindings[1].binding = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+        bindings[1].descriptorCount = 1;
+        bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
+        if (vkCreateDescriptorSetLayout(mDevice, &layoutInfo, nullptr, &mDescriptorSetLayout) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create descriptor set layout.");
+        }
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &mDescriptorSetLayout;
+        if (vkCreatePipelineLayout(mDevice, &pipelineLayoutInfo, nullptr, &mPipelineLayout) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create pipeline layout.");
+        }
+
+        std::array<VkDescriptorPoolSize, 2> poolSizes = {};
+        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        poolSizes[0].descriptorCount = 1;
+        poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+        poolSizes[1].descriptorCount = 1;
+
+        VkDescriptorPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+        poolInfo.maxSets = 1;
+        if (vkCreateDescriptorPool(mDevice, &poolInfo, nullptr, &mDescriptorPool) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create descriptor pool.");
+        }
+
+        VkDescriptorSetAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = mDescriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &mDescriptorSetLayout;
+        if (vkAllocateDescriptorSets(mDevice, &allocInfo, &mDescriptorSet) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to allocate descriptor set.");
+        }
+
+        mFrameData = createBuffer(FRAME_DATA_BUFFER_SIZE, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        vkMapMemory(mDevice, mFrameData.memory, 0, FRAME_DATA_BUFFER_SIZE, 0, &pFrameDataMapped);
+        memset(pFrameDataMapped, 0, FRAME_DATA_BUFFER_SIZE);
+
+        VkDescriptorBufferInfo uniformInfo = { mFrameData.buffer, 0, FRAME_UNIFORM_RANGE };
+        VkDescriptorBufferInfo storageInfo = { mFrameData.buffer, FRAME_UNIFORM_RANGE, FRAME_INSTANCE_RANGE };
+
+        std::array<VkWriteDescriptorSet, 2> writes = {};
+        writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[0].dstSet = mDescriptorSet;
+        writes[0].dstBinding = 0;
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        writes[0].descriptorCount = 1;
+        writes[0].pBufferInfo = &uniformInfo;
+        writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[1].dstSet = mDescriptorSet;
+        writes[1].dstBinding = 1;
+        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+        writes[1].descriptorCount = 1;
+        writes[1].pBufferInfo = &storageInfo;
+        vkUpdateDescriptorSets(mDevice, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+
+    void replay()
+    {
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(mPhysicalDevice, &deviceProperties);
+
+        BenchmarkInfo benchmarkInfo = {};
+        benchmarkInfo.outputPath = mSettings.outputPath;
+        benchmarkInfo.config = {
+            { "capture", mSettings.capturePath },
+            { "device", deviceProperties.deviceName },
+            { "driverVersion", std::to_string(deviceProperties.driverVersion) },
+            { "frames", std::to_string(mCapture.GetHeader().frameCount) },
+            { "loops", std::to_string(mSettings.loops) }
+        };
+        mBenchmark.Initialize(&benchmarkInfo);
+
+        for (uint32_t loop = 0; loop < mSettings.loops; ++loop)
+        {
+            std::string sceneName = "loop " + std::to_string(loop);
+            mBenchmark.BeginScene(sceneName.c_str());
+            mCapture.Rewind();
+            mLoopFrameCount = 0;
+
+            FrameCaptureRecord record;
+            while (mCapture.Next(record))
+            {
+                replayRecord(record, loop == 0);
+            }
+
+            mBenchmark.EndScene({ { "draws", mDrawCount }, { "skippedCommands", mSkippedCount } });
+            mDrawCount = 0;
+            mSkippedCount = 0;
+        }
+
+        mBenchmark.Shutdown();
+    }
+
+    void replayRecord(const FrameCaptureRecord& record, bool firstLoop)
+    {
+        switch (record.command)
+        {
+        case FRAME_CAPTURE_CREATE_BUFFER:
+            if (firstLoop)
+            {
+                auto payload = FrameCaptureReader::ReadPayload<FrameCaptureBuffer>(record);
+                mBuffers[payload.id] = createBuffer(payload.size, payload.usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            }
+            break;
+        case FRAME_CAPTURE_UPLOAD_BUFFER:
+            // uploads between frames are streamed per-frame data (sprite vertices), so every loop needs them again.
+            if (firstLoop || mLoopFrameCount > 0)
+            {
+                auto payload = FrameCaptureReader::ReadPayload<FrameCaptureUpload>(record);
+                uploadBuffer(payload, record.pData + sizeof(payload));
+            }
+            break;
+        case FRAME_CAPTURE_CREATE_PIPELINE:
+            if (firstLoop)
+            {
+                auto payload = FrameCaptureReader::ReadPayload<FrameCapturePipeline>(record);
+                const char* pCode = record.pData + sizeof(payload);
+                mPipelines[payload.id] = createPipeline(payload.desc, pCode, payload.vertexCodeSize, pCode + payload.vertexCodeSize, payload.fragmentCodeSize);
+            }
+            break;
+        case FRAME_CAPTURE_DESTROY_BUFFER:
+        case FRAME_CAPTURE_DESTROY_PIPELINE:
+            // kept alive for the next loop; released in cleanup().
+            break;
+        case FRAME_CAPTURE_BEGIN_FRAME:
+            ++mLoopFrameCount;
+            beginFrame();
+            break;
+        case FRAME_CAPTURE_FRAME_DATA:
+            memcpy(pFrameDataMapped, record.pData, (std::min)(static_cast<VkDeviceSize>(record.size), FRAME_UNIFORM_RANGE));
+            break;
+        case FRAME_CAPTURE_INSTANCE_DATA:
+            memcpy(static_cast<char*>(pFrameDataMapped) + FRAME_UNIFORM_RANGE, record.pData, (std::min)(static_cast<VkDeviceSize>(record.size), FRAME_INSTANCE_RANGE));
+            break;
+        case FRAME_CAPTURE_BEGIN_PASS:
+            beginPass(FrameCaptureReader::ReadPayload<FrameCapturePass>(record));
+            break;
+        case FRAME_CAPTURE_BIND_PIPELINE:
+        {
+            auto payload = FrameCaptureReader::ReadPayload<FrameCaptureObject>(record);
+            auto it = mPipelines.find(payload.id);
+            if (it == mPipelines.end())
+            {
+                ++mSkippedCount;
+                break;
+            }
+            vkCmdBindPipeline(mCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, it->second);
+            break;
+        }
+        case FRAME_CAPTURE_BIND_VERTEX_BUFFER:
+        {
+            auto payload = FrameCaptureReader::ReadPayload<FrameCaptureBind>(record);
+            auto it = mBuffers.find(payload.id);
+            if (it == mBuffers.end())
+            {
+                ++mSkippedCount;
+                break;
+            }
+            vkCmdBindVertexBuffers(mCommandBuffer, 0, 1, &it->second.buffer, &payload.offset);
+            break;
+        }
+        case FRAME_CAPTURE_DRAW:
+        {
+            auto payload = FrameCaptureReader::ReadPayload<FrameCaptureDraw>(record);
+            vkCmdDraw(mCommandBuffer, payload.vertexCount, payload.instanceCount, payload.firstVertex, payload.firstInstance);
+            ++mDrawCount;
+            break;
+        }
+        case FRAME_CAPTURE_END_PASS:
+            vkCmdEndRenderPass(mCommandBuffer);
+            break;
+        case FRAME_CAPTURE_END_FRAME:
+            endFrame();
+            break;
+        default:
+            logger.warn("Unknown capture command %u skipped.", static_cast<uint32_t>(record.command));
+            ++mSkippedCount;
+            break;
+        }
+    }
+
+    void beginFrame()
+    {
+        mFrameStart = std::chrono::steady_clock::now();
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkResetCommandBuffer(mCommandBuffer, 0);
+        vkBeginCommandBuffer(mCommandBuffer, &beginInfo);
+
+        if (mQueryPool != VK_NULL_HANDLE)
+        {
+            vkCmdResetQueryPool(mCommandBuffer, mQueryPool, 0, 2);
+            vkCmdWriteTimestamp(mCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, mQueryPool, 0);
+        }
+    }
+
+    void beginPass(const FrameCapturePass& pass)
+    {
+        VkRenderPass renderPass = getRenderPass(pass.colorFormat, pass.depthFormat, pass.samples);
+        const RenderTarget& target = getRenderTarget(pass);
+
+        std::array<VkClearValue, 2> clearValues = {};
+        memcpy(clearValues[0].color.float32, pass.clearColor, sizeof(pass.clearColor));
+        clearValues[1].depthStencil = { pass.clearDepth, 0 };
+
+        VkRenderPassBeginInfo renderPassInfo = {};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = renderPass;
+        renderPassInfo.framebuffer = target.framebuffer;
+        renderPassInfo.renderArea.extent = pass.extent;
+        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+        renderPassInfo.pClearValues = clearValues.data();
+        vkCmdBeginRenderPass(mCommandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+        VkViewport viewport = { 0.0f, 0.0f, (float)pass.extent.width, (float)pass.extent.height, 0.0f, 1.0f };
+        vkCmdSetViewport(mCommandBuffer, 0, 1, &viewport);
+        VkRect2D scissor = { { 0, 0 }, pass.extent };
+        vkCmdSetScissor(mCommandBuffer, 0, 1, &scissor);
+
+        uint32_t dynamicOffsets[2] = { 0, 0 };
+        vkCmdBindDescriptorSets(mCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1, &mDescriptorSet, 2, dynamicOffsets);
+    }
+
+    void endFrame()
+    {
+        if (mQueryPool != VK_NULL_HANDLE)
+        {
+            vkCmdWriteTimestamp(mCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mQueryPool, 1);
+        }
+        vkEndCommandBuffer(mCommandBuffer);
+
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &mCommandBuffer;
+        if (vkQueueSubmit(mQueue, 1, &submitInfo, mFence) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to submit a replayed frame.");
+        }
+        auto submitted = std::chrono::steady_clock::now();
+
+        vkWaitForFences(mDevice, 1, &mFence, VK_TRUE, (std::numeric_limits<uint64_t>::max)());
+        vkResetFences(mDevice, 1, &mFence);
+        auto completed = std::chrono::steady_clock::now();
+
+        BenchmarkFrame frame = {};
+        frame.frameMs = std::chrono::duration<double, std::milli>(completed - mFrameStart).count();
+        frame.cpuMs = std::chrono::duration<double, std::milli>(submitted - mFrameStart).count();
+        frame.gpuMs = -1.0;
+        if (mQueryPool != VK_NULL_HANDLE)
+        {
+            uint64_t timestamps[2] = {};
+            if (vkGetQueryPoolResults(mDevice, mQueryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+            {
+                uint64_t mask = mTimestampValidBits >= 64 ? ~0ull : (1ull << mTimestampValidBits) - 1;
+                frame.gpuMs = static_cast<double>(((timestamps[1] & mask) - (timestamps[0] & mask)) & mask) * mTimestampPeriod / 1000000.0;
+            }
+        }
+        mBenchmark.AddFrame(frame);
+    }
+
+    ReplayBuffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+    {
+        ReplayBuffer buffer;
+
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = usage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (vkCreateBuffer(mDevice, &bufferInfo, nullptr, &buffer.buffer) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create a replay buffer.");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(mDevice, buffer.buffer, &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = FindMemoryType(mPhysicalDevice, memRequirements.memoryTypeBits, properties);
+        if (vkAllocateMemory(mDevice, &allocInfo, nullptr, &buffer.memory) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to allocate replay buffer memory.");
+        }
+        vkBindBufferMemory(mDevice, buffer.buffer, buffer.memory, 0);
+
+        return buffer;
+    }
+
+    /*
+    Setup work, not part of any measured frame: staged and waited for on the spot.
+    */
+    void uploadBuffer(const FrameCaptureUpload& upload, const char* pData)
+    {
+        auto it = mBuffers.find(upload.id);
+        if (it == mBuffers.end())
+        {
+            ++mSkippedCount;
+            return;
+        }
+
+        ReplayBuffer staging = createBuffer(upload.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        void* pMapped = nullptr;
+        vkMapMemory(mDevice, staging.memory, 0, upload.size, 0, &pMapped);
+        memcpy(pMapped, pData, static_cast<size_t>(upload.size));
+        vkUnmapMemory(mDevice, staging.memory);
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = mCommandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        VkCommandBuffer commandBuffer;
+        vkAllocateCommandBuffers(mDevice, &allocInfo, &commandBuffer);
+
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        VkBufferCopy region = { 0, upload.offset, upload.size };
+        vkCmdCopyBuffer(commandBuffer, staging.buffer, it->second.buffer, 1, &region);
+        vkEndCommandBuffer(commandBuffer);
+
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+        vkQueueSubmit(mQueue, 1, &submitInfo, VK_NULL_HANDLE);
+        vkQueueWaitIdle(mQueue);
+
+        vkFreeCommandBuffers(mDevice, mCommandPool, 1, &commandBuffer);
+        vkDestroyBuffer(mDevice, staging.buffer, nullptr);
+        vkFreeMemory(mDevice, staging.memory, nullptr);
+    }
+
+    /*
+    Mirrors Game::createGraphicsPipeline(); only the state in FrameCapturePipelineDesc varies.
+    */
+    VkPipeline createPipeline(const FrameCapturePipelineDesc& desc, const char* pVertexCode, uint32_t vertexCodeSize, const char* pFragmentCode, uint32_t fragmentCodeSize)
+    {
+        VkShaderModule vertShaderModule = createShaderModule(pVertexCode, vertexCodeSize);
+        VkShaderModule fragShaderModule = fragmentCodeSize > 0 ? createShaderModule(pFragmentCode, fragmentCodeSize) : VK_NULL_HANDLE;
+
+        VkSpecializationMapEntry constantEntries[FRAME_CAPTURE_MAX_CONSTANTS];
+        uint32_t constantCount = (std::min)(desc.constantCount, FRAME_CAPTURE_MAX_CONSTANTS);
+        for (uint32_t i = 0; i < constantCount; ++i)
+        {
+            constantEntries[i].constantID = desc.constantIds[i];
+            constantEntries[i].offset = i * sizeof(uint32_t);
+            constantEntries[i].size = sizeof(uint32_t);
+        }
+        VkSpecializationInfo specializationInfo = {};
+        specializationInfo.mapEntryCount = constantCount;
+        specializationInfo.pMapEntries = constantEntries;
+        specializationInfo.dataSize = constantCount * sizeof(uint32_t);
+        specializationInfo.pData = desc.constantValues;
+
+        std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages = {};
+        shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+        shaderStages[0].module = vertShaderModule;
+        shaderStages[0].pName = "main";
+        shaderStages[0].pSpecializationInfo = constantCount > 0 ? &specializationInfo : nullptr;
+        shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        shaderStages[1].module = fragShaderModule;
+        shaderStages[1].pName = "main";
+        shaderStages[1].pSpecializationInfo = shaderStages[0].pSpecializationInfo;
+
+        VkVertexInputBindingDescription bindingDescription = {};
+        bindingDescription.binding = 0;
+        bindingDescription.stride = desc.vertexStride;
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        vertexInputInfo.vertexBindingDescriptionCount = 1;
+        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+        vertexInputInfo.vertexAttributeDescriptionCount = (std::min)(desc.attributeCount, FRAME_CAPTURE_MAX_ATTRIBUTES);
+        vertexInputInfo.pVertexAttributeDescriptions = desc.attributes;
+
+        VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo = {};
+        inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssemblyInfo.topology = desc.topology;
+
+        std::array<VkDynamicState, 2> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+        VkPipelineDynamicStateCreateInfo dynamicStateInfo = {};
+        dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+        dynamicStateInfo.pDynamicStates = dynamicStates.data();
+
+        VkPipelineViewportStateCreateInfo viewportStateInfo = {};
+        viewportStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewportStateInfo.viewportCount = 1;
+        viewportStateInfo.scissorCount = 1;
+
+        VkPipelineRasterizationStateCreateInfo rasterizerInfo = {};
+        rasterizerInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizerInfo.polygonMode = VK_POLYGON_MODE_FILL;
+        rasterizerInfo.lineWidth = 1.0f;
+        rasterizerInfo.cullMode = desc.cullMode;
+        rasterizerInfo.frontFace = desc.frontFace;
+
+        VkPipelineMultisampleStateCreateInfo multisamplingInfo = {};
+        multisamplingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisamplingInfo.rasterizationSamples = desc.samples;
+        multisamplingInfo.minSampleShading = 1.0f;
+
+        VkPipelineDepthStencilStateCreateInfo depthStencilInfo = {};
+        depthStencilInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depthStencilInfo.depthTestEnable = desc.depthTest;
+        depthStencilInfo.depthWriteEnable = desc.depthWrite;
+        depthStencilInfo.depthCompareOp = desc.depthCompareOp;
+
+        VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+        colorBlendAttachment.colorWriteMask = desc.colorWriteMask;
+
+        VkPipelineColorBlendStateCreateInfo colorBlendInfo = {};
+        colorBlendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlendInfo.attachmentCount = 1;
+        colorBlendInfo.pAttachments = &colorBlendAttachment;
+
+        VkGraphicsPipelineCreateInfo pipelineInfo = {};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipelineInfo.stageCount = fragShaderModule != VK_NULL_HANDLE ? 2 : 1;
+        pipelineInfo.pStages = shaderStages.data();
+        pipelineInfo.pVertexInputState = &vertexInputInfo;
+        pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
+        pipelineInfo.pViewportState = &viewportStateInfo;
+        pipelineInfo.pRasterizationState = &rasterizerInfo;
+        pipelineInfo.pMultisampleState = &multisamplingInfo;
+        pipelineInfo.pDepthStencilState = &depthStencilInfo;
+        pipelineInfo.pColorBlendState = &colorBlendInfo;
+        pipelineInfo.pDynamicState = &dynamicStateInfo;
+        pipelineInfo.layout = mPipelineLayout;
+        pipelineInfo.renderPass = getRenderPass(desc.colorFormat, desc.depthFormat, desc.samples);
+        pipelineInfo.subpass = 0;
+
+        VkPipeline pipeline;
+        if (vkCreateGraphicsPipelines(mDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create a replay pipeline.");
+        }
+
+        vkDestroyShaderModule(mDevice, vertShaderModule, nullptr);
+        vkDestroyShaderModule(mDevice, fragShaderModule, nullptr);
+        return pipeline;
+    }
+
+    VkShaderModule createShaderModule(const char* pCode, uint32_t codeSize)
+    {
+        // the capture buffer has no alignment guarantee, so copy into something uint32 aligned.
+        std::vector<uint32_t> code((codeSize + 3) / 4);
+        memcpy(code.data(), pCode, codeSize);
+
+        VkShaderModuleCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = codeSize;
+        createInfo.pCode = code.data();
+
+        VkShaderModule shaderModule;
+        if (vkCreateShaderModule(mDevice, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create a replay shader module.");
+        }
+        return shaderModule;
+    }
+
+    /*
+    One color and one depth attachment, both cleared. The game's msaa resolve target isn't
+    needed here since nothing is presented; compatibility only depends on formats and samples.
+    */
+    VkRenderPass getRenderPass(VkFormat colorFormat, VkFormat depthFormat, VkSampleCountFlagBits samples)
+    {
+        RenderPassKey key = std::make_tuple(colorFormat, depthFormat, samples);
+        auto it = mRenderPasses.find(key);
+        if (it != mRenderPasses.end())
+        {
+            return it->second;
+        }
+
+        std::array<VkAttachmentDescription, 2> attachments = {};
+        attachments[0].format = colorFormat;
+        attachments[0].samples = samples;
+        attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        attachments[1].format = depthFormat;
+        attachments[1].samples = samples;
+        attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentReference colorReference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+        VkAttachmentReference depthReference = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+        VkSubpassDescription subpass = {};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &colorReference;
+        subpass.pDepthStencilAttachment = &depthReference;
+
+        // frames are fenced one by one, but the attachments are still reused: order against the last frame's writes.
+        VkSubpassDependency dependency = {};
+        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependency.dstSubpass = 0;
+        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        VkRenderPassCreateInfo renderPassInfo = {};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = 1;
+        renderPassInfo.pDependencies = &dependency;
+
+        VkRenderPass renderPass;
+        if (vkCreateRenderPass(mDevice, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create a replay render pass.");
+        }
+        mRenderPasses[key] = renderPass;
+        return renderPass;
+    }
+
+    const RenderTarget& getRenderTarget(const FrameCapturePass& pass)
+    {
+        RenderTargetKey key = std::make_tuple(pass.colorFormat, pass.depthFormat, pass.samples, pass.extent.width, pass.extent.height);
+        auto it = mRenderTargets.find(key);
+        if (it != mRenderTargets.end())
+        {
+            return it->second;
+        }
+
+        bool hasStencil = pass.depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || pass.depthFormat == VK_FORMAT_D24_UNORM_S8_UINT;
+
+        RenderTarget target;
+        createImage(pass.extent, pass.colorFormat, pass.samples, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
+            target.colorImage, target.colorMemory, target.colorView);
+        createImage(pass.extent, pass.depthFormat, pass.samples, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+            VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencil ? VK_IMAGE_ASPECT_STENCIL_BIT : 0), target.depthImage, target.depthMemory, target.depthView);
+
+        std::array<VkImageView, 2> views = { target.colorView, target.depthView };
+        VkFramebufferCreateInfo framebufferInfo = {};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = getRenderPass(pass.colorFormat, pass.depthFormat, pass.samples);
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+        framebufferInfo.pAttachments = views.data();
+        framebufferInfo.width = pass.extent.width;
+        framebufferInfo.height = pass.extent.height;
+        framebufferInfo.layers = 1;
+        if (vkCreateFramebuffer(mDevice, &framebufferInfo, nullptr, &target.framebuffer) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create a replay framebuffer.");
+        }
+
+        logger.debug("Replay render target %ux%u created.", pass.extent.width, pass.extent.height);
+        return mRenderTargets[key] = target;
+    }
+
+    void createImage(VkExtent2D extent, VkFormat format, VkSampleCountFlagBits samples, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+        VkImage& image, VkDeviceMemory& memory, VkImageView& view)
+    {
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = format;
+        imageInfo.extent = { extent.width, extent.height, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = samples;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = usage;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        if (vkCreateImage(mDevice, &imageInfo, nullptr, &image) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create a replay image.");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(mDevice, image, &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = FindMemoryType(mPhysicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        if (vkAllocateMemory(mDevice, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to allocate replay image memory.");
+        }
+        vkBindImageMemory(mDevice, image, memory, 0);
+
+        VkImageViewCreateInfo viewInfo = {};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange = { aspect, 0, 1, 0, 1 };
+        if (vkCreateImageView(mDevice, &viewInfo, nullptr, &view) != VK_SUCCESS)
+        {
+            logger.throw_error("failed to create a replay image view.");
+        }
+    }
+
+    void cleanup()
+    {
+        vkDeviceWaitIdle(mDevice);
+
+        for (auto& pipeline : mPipelines)
+        {
+            vkDestroyPipeline(mDevice, pipeline.second, nullptr);
+        }
+        for (auto& buffer : mBuffers)
+        {
+            vkDestroyBuffer(mDevice, buffer.second.buffer, nullptr);
+            vkFreeMemory(mDevice, buffer.second.memory, nullptr);
+        }
+        for (auto& target : mRenderTargets)
+        {
+            vkDestroyFramebuffer(mDevice, target.second.framebuffer, nullptr);
+            vkDestroyImageView(mDevice, target.second.colorView, nullptr);
+            vkDestroyImageView(mDevice, target.second.depthView, nullptr);
+            vkDestroyImage(mDevice, target.second.colorImage, nullptr);
+            vkDestroyImage(mDevice, target.second.depthImage, nullptr);
+            vkFreeMemory(mDevice, target.second.colorMemory, nullptr);
+            vkFreeMemory(mDevice, target.second.depthMemory, nullptr);
+        }
+        for (auto& renderPass : mRenderPasses)
+        {
+            vkDestroyRenderPass(mDevice, renderPass.second, nullptr);
+        }
+
+        vkDestroyBuffer(mDevice, mFrameData.buffer, nullptr);
+        vkFreeMemory(mDevice, mFrameData.memory, nullptr);
+        vkDestroyDescriptorPool(mDevice, mDescriptorPool, nullptr);
+        vkDestroyPipelineLayout(mDevice, mPipelineLayout, nullptr);
+        vkDestroyDescriptorSetLayout(mDevice, mDescriptorSetLayout, nullptr);
+        vkDestroyQueryPool(mDevice, mQueryPool, nullptr);
+        vkDestroyFence(mDevice, mFence, nullptr);
+        vkDestroyCommandPool(mDevice, mCommandPool, nullptr);
+        vkDestroyDevice(mDevice, nullptr);
+        vkDestroyInstance(mInstance, nullptr);
+        FreeLibrary(mVulkanLibrary);
+
+        logger.debug("Replay cleanup complete.");
+    }
+
+    ReplaySettings mSettings;
+    FrameCaptureReader mCapture;
+    Benchmark mBenchmark;
+
+    HMODULE mVulkanLibrary = nullptr;
+    VkInstance mInstance = VK_NULL_HANDLE;
+    VkPhysicalDevice mPhysicalDevice = VK_NULL_HANDLE;
+    VkDevice mDevice = VK_NULL_HANDLE;
+    VkQueue mQueue = VK_NULL_HANDLE;
+    uint32_t mQueueFamily = 0;
+
+    VkCommandPool mCommandPool = VK_NULL_HANDLE;
+    VkCommandBuffer mCommandBuffer = VK_NULL_HANDLE;
+    VkFence mFence = VK_NULL_HANDLE;
+    VkQueryPool mQueryPool = VK_NULL_HANDLE;
+    uint32_t mTimestampValidBits = 0;
+    float mTimestampPeriod = 1.0f;
+
+    VkDescriptorSetLayout mDescriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
+    VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet mDescriptorSet = VK_NULL_HANDLE;
+    ReplayBuffer mFrameData;
+    void* pFrameDataMapped = nullptr;
+
+    // capture ids to replay objects.
+    std::unordered_map<uint32_t, ReplayBuffer> mBuffers;
+    std::unordered_map<uint32_t, VkPipeline> mPipelines;
+    std::map<RenderPassKey, VkRenderPass> mRenderPasses;
+    std::map<RenderTargetKey, RenderTarget> mRenderTargets;
+
+    std::chrono::steady_clock::time_point mFrameStart;
+    uint64_t mDrawCount = 0;
+    uint64_t mSkippedCount = 0;
+    uint64_t mLoopFrameCount = 0;
+};
+
+ReplaySettings parseSettings(int argc, char* argv[])
+{
+    ReplaySettings settings;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--loops") == 0 && i + 1 < argc)
+        {
+            settings.loops = static_cast<uint32_t>((std::max)(atoi(argv[++i]), 1));
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+        {
+            settings.outputPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--validation") == 0)
+        {
+            settings.validation = true;
+        }
+        else if (settings.capturePath.empty() && argv[i][0] != '-')
+        {
+            settings.capturePath = argv[i];
+        }
+        else
+        {
+            logger.warn("Unknown argument '%s' ignored.", argv[i]);
+        }
+    }
+    return settings;
+}
+
+int main(int argc, char* argv[])
+{
+    ReplaySettings settings = parseSettings(argc, argv);
+    if (settings.capturePath.empty())
+    {
+        logger.error("usage: VulkaReplay <capture> [--loops N] [--out results.json] [--validation]");
+        return EXIT_FAILURE;
+    }
+
+    // no pause on exit: this runs unattended on build machines.
+    try
+    {
+        Replayer replayer(settings);
+        replayer.run();
+    }
+    catch (const std::exception& e)
+    {
+        logger.error(e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}